@@ -0,0 +1,101 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Alocador linear ("arena") para dados temporários de um quadro.
+//
+// Uma arena é um bloco de memória com um deslocamento: cada alocação apenas
+// avança o deslocamento, e Arena_Reset() libera tudo de uma vez, voltando-o
+// para zero. Nada é liberado individualmente, então os objetos alocados nela
+// não podem depender de destrutores.
+//
+// Se o bloco encher durante um quadro, as alocações seguintes usam blocos
+// extras do heap e o próximo Arena_Reset() troca o bloco por um maior, com
+// espaço para o maior uso visto. Assim, depois dos primeiros quadros, a arena
+// não aloca mais nada.
+//
+// Não é segura para uso simultâneo por várias threads: quem aloca é a thread
+// que descreve o quadro. Tarefas paralelas recebem arrays já alocados.
+
+struct ArenaOverflow;
+
+struct Arena
+{
+    char*          memory;
+    size_t         capacity;
+    size_t         used;
+    size_t         peak;      // Maior uso em um quadro, incluindo os blocos extras
+    ArenaOverflow* overflow;  // Blocos extras do quadro atual (lista ligada)
+    size_t         overflow_bytes;
+};
+
+void Arena_Init(Arena* arena, size_t capacity);
+
+// Retorna "size" bytes alinhados a "alignment" (uma potência de dois), válidos até o próximo Arena_Reset().
+void* Arena_Allocate(Arena* arena, size_t size, size_t alignment);
+
+// Libera todas as alocações e, se o bloco encheu, o troca por um maior.
+void Arena_Reset(Arena* arena);
+
+void Arena_Shutdown(Arena* arena);
+
+// Array de "count" elementos de T, construídos com o construtor padrão.
+template <class T>
+T* Arena_AllocateArray(Arena* arena, size_t count)
+{
+    T* array = (T*)Arena_Allocate(arena, count * sizeof(T), alignof(T));
+    for (size_t i = 0; i < count; ++i)
+        new (&array[i]) T();
+    return array;
+}
+
+// Adaptador para usar a arena nos contêineres da STL, como em ArenaVector.
+// "deallocate" não faz nada: a memória volta para a arena em Arena_Reset(),
+// depois do que o contêiner não pode mais ser usado.
+template <class T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+
+    // Atribuir ou trocar contêineres também troca a arena usada por eles.
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    Arena* arena;
+
+    ArenaAllocator() : arena(NULL) {}  // Sem arena: o contêiner precisa receber uma antes de alocar
+    ArenaAllocator(Arena* arena) : arena(arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count)
+    {
+        return (T*)Arena_Allocate(arena, count * sizeof(T), alignof(T));
+    }
+    void deallocate(T*, size_t)
+    {
+    }
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena != b.arena;
+}
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif // _ARENA_H
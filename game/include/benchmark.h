@@ -0,0 +1,102 @@
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+#include "level.h"
+#include "memtrack.h"
+#include "gputimer.h"
+
+// Modo benchmark (opção --benchmark).
+//
+// A partida começa sem esperar o ENTER e a câmera percorre uma curva fixa
+// (Catmull-Rom) que sai da origem e passa pelo centro de todas as moedas do
+// nível, em um número fixo de quadros. Cada quadro avança exatamente um passo
+// da simulação, de forma que toda execução desenha a mesma sequência de
+// quadros. Ao final são impressos os tempos de CPU e GPU por quadro (média,
+// p50, p95, p99 e máximo), o número de draw calls e de triângulos e o tempo de
+// carregamento, além do tempo de CPU gasto em cada sistema (simulação,
+// carregamento de setores, colisões e submissão dos desenhos) e da latência
+// entre a leitura da posição da câmera e a troca de buffers.
+//
+// O modo stress (opção --stress) repete o benchmark em rodadas sobre níveis
+// gerados com cada vez mais asteroides (veja "include/stress.h"), imprimindo
+// uma linha da tabela por rodada.
+
+// Número de quadros iniciais descartados das estatísticas (compilação de shaders pelo driver, primeiros acessos à memória, ...).
+#define BENCHMARK_WARMUP_FRAMES 30
+
+// Quantos quadros esperamos antes de ler o resultado de uma consulta de tempo da GPU, para não bloquear a CPU.
+#define BENCHMARK_QUERY_LATENCY 4
+
+// Contadores do quadro atual, incrementados a cada draw call e a cada troca de programa, de estado ou de "uniform"
+// compartilhado entre os objetos (a matriz de modelagem e a caixa envolvente de cada objeto não contam).
+struct RenderCounters
+{
+    uint32_t draw_calls;
+    uint64_t triangles;
+    uint32_t state_changes;
+};
+extern RenderCounters g_RenderCounters;
+
+struct BenchmarkFrame
+{
+    double   frame_ms;    // Intervalo entre o início deste quadro e o do próximo
+    double   cpu_ms;      // Trabalho da CPU no quadro, até a troca de buffers
+    double   gpu_ms;      // Tempo de execução dos comandos do quadro na GPU
+    double   gpu_pass_ms[GPUPASS_COUNT];  // Parte do tempo de GPU gasta em cada passo (veja "include/gputimer.h")
+    bool     gpu_passes_valid;            // Falso se as consultas dos passos não ficaram prontas a tempo
+    uint32_t draw_calls;
+    uint64_t triangles;
+
+    // Tempos de CPU por sistema, preenchidos pelo laço principal.
+    double   simulation_ms;     // Todos os passos de simulação do quadro
+    double   streaming_ms;      // LevelStreamer_Update(), dentro da simulação
+    double   collisions_ms;     // Testes de colisão, dentro da simulação
+    double   render_ms;         // Submissão dos desenhos da cena e do texto
+    double   latency_ms;        // Da leitura da entrada (a curva da câmera) até a volta da troca de buffers
+    uint32_t active_asteroids;  // Asteroides dos setores ativos
+    uint32_t heap_allocations;  // Chamadas de "operator new" desde o quadro anterior, em todas as threads
+
+    // Apenas no modo de instrumentação: alocações (incluindo malloc) e bytes desde o quadro anterior, e o pico de bytes em uso.
+    uint64_t heap_bytes;
+    int64_t  heap_peak_bytes;
+    uint32_t heap_tag_allocations[MEMTAG_COUNT];
+    uint64_t heap_tag_bytes[MEMTAG_COUNT];
+};
+
+struct Benchmark
+{
+    int                         num_frames;
+    double                      load_seconds;  // Do início do programa até o primeiro quadro
+    std::vector<glm::vec3>      path;          // Pontos de controle da curva percorrida pela câmera
+    std::vector<BenchmarkFrame> frames;
+    double                      frame_start;   // Instante (glfwGetTime()) do início do quadro atual
+
+    GLuint queries[BENCHMARK_QUERY_LATENCY];   // Consultas GL_TIME_ELAPSED, reutilizadas em anel
+};
+
+// Prepara o benchmark de "num_frames" quadros sobre o nível dado. Requer um contexto OpenGL.
+void Benchmark_Init(Benchmark* benchmark, const Level* level, int num_frames);
+
+// Posição e direção da câmera no quadro "frame".
+void Benchmark_Camera(const Benchmark* benchmark, int frame, glm::vec3* position, glm::vec3* direction);
+
+// Delimitam os comandos OpenGL de um quadro, medidos na GPU. "now" é o
+// instante do início do quadro e "cpu_ms" o trabalho da CPU até a troca de buffers.
+void Benchmark_BeginFrame(Benchmark* benchmark, int frame, double now);
+void Benchmark_EndFrame(Benchmark* benchmark, int frame, double cpu_ms);
+
+// Chamada no início do quadro seguinte ao último: lê as consultas pendentes e imprime o relatório.
+void Benchmark_Report(Benchmark* benchmark, double now);
+
+// Equivalentes para o modo stress: o cabeçalho da tabela e a linha de uma
+// rodada com "num_asteroids" asteroides no nível.
+void Benchmark_PrintStressHeader();
+void Benchmark_ReportStressRound(Benchmark* benchmark, double now, uint32_t num_asteroids);
+
+#endif // _BENCHMARK_H
@@ -22,9 +22,17 @@ struct BoundingCircle
     glm::vec3 normal;
 };
 
+// Pirâmide de visão da câmera: seis planos (a, b, c, d), com a normal apontando para dentro.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
 bool checkSphereSphereCollision(BoundingSphere sphere1, BoundingSphere sphere2);
 bool checkSphereCircleCollision(BoundingSphere sphere, BoundingCircle circle);
 bool checkSphereCubeCollision(BoundingSphere sphere, BoundingCube cube);
+Frustum extractFrustum(glm::mat4 projection_view);
+bool checkSphereFrustumCollision(BoundingSphere sphere, const Frustum& frustum);
 glm::vec3 getCubeCenter(BoundingCube cube);
 float getCubeSide(BoundingCube cube);
 
@@ -0,0 +1,58 @@
+#ifndef _FRAMEPACER_H
+#define _FRAMEPACER_H
+
+#include <GLFW/glfw3.h>
+
+// Ritmo dos quadros: sincronização vertical, limite de quadros por segundo e
+// espera por eventos quando nada muda na tela.
+//
+// O limite (opção --max-fps) é cumprido dormindo até pouco antes do instante
+// do próximo quadro e esperando ativamente o restante: o sleep do sistema
+// operacional costuma acordar atrasado, e a margem de espera ativa acompanha
+// o maior atraso observado recentemente. Os instantes dos quadros são
+// múltiplos do período, de forma que os atrasos não se acumulam.
+//
+// Na tela de início ou com a janela sem foco, os quadros são desenhados
+// apenas quando chega um evento (teclado, mouse, ...) ou, sem eventos,
+// PACER_IDLE_FPS vezes por segundo. Com a janela minimizada nada é desenhado:
+// esperamos sem limite até ela voltar. A simulação não avança durante essa
+// espera (veja MAX_FRAME_TIME em main.cpp).
+//
+// As funções que usam a janela devem ser chamadas pela thread principal, como a GLFW exige.
+
+#define PACER_IDLE_FPS      10      // Quadros por segundo na tela de início ou sem foco, sem eventos
+#define PACER_MIN_SPIN      0.0005  // Margem mínima (segundos) de espera ativa antes do instante do quadro
+#define PACER_MAX_SPIN      0.004   // E máxima: acima dela, preferimos acordar atrasados a ocupar a CPU
+
+enum VsyncMode
+{
+    VSYNC_OFF = 0,
+    VSYNC_ON,        // Um quadro por atualização do monitor
+    VSYNC_ADAPTIVE   // Como VSYNC_ON, mas um quadro atrasado é apresentado imediatamente (com "tearing")
+};
+
+struct FramePacer
+{
+    double period;          // Segundos entre dois quadros (0 = sem limite)
+    double next_frame;      // Instante (FramePacer_Now()) do início do próximo quadro
+    double oversleep;       // Maior atraso recente do sleep, que define a margem de espera ativa
+    bool   throttle_idle;   // Espera por eventos na tela de início, sem foco ou minimizado
+};
+
+// Instante atual, em segundos, do relógio usado pelo FramePacer.
+double FramePacer_Now();
+
+// Configura a sincronização vertical do contexto atual. Sem suporte do driver ao modo adaptativo, usa VSYNC_ON.
+// Retorna o modo usado.
+VsyncMode FramePacer_SetVsync(VsyncMode mode);
+
+// "max_fps" é o limite de quadros por segundo (0 = sem limite).
+void FramePacer_Init(FramePacer* pacer, int max_fps, bool throttle_idle);
+void FramePacer_Shutdown(FramePacer* pacer);
+
+// Chamada no fim de cada quadro: espera o instante do próximo e trata os eventos da janela ("window" pode ser
+// NULL, sem janela), chamando as funções de callback da GLFW. "title_screen" indica que a partida ainda não
+// começou. Retorna os segundos passados esperando.
+double FramePacer_Wait(FramePacer* pacer, GLFWwindow* window, bool title_screen);
+
+#endif // _FRAMEPACER_H
@@ -0,0 +1,75 @@
+#ifndef _GLDEBUG_H
+#define _GLDEBUG_H
+
+#include <glad/glad.h>
+
+// Relatório de erros do OpenGL pelo próprio driver (opção --gl-debug).
+//
+// Com a extensão GL_KHR_debug (ou OpenGL 4.3), o driver chama uma função
+// nossa (glDebugMessageCallback) a cada erro ou aviso, no momento da chamada
+// OpenGL que o causou: ao contrário de glGetError(), nada precisa ser
+// consultado depois de cada chamada, e o driver não é obrigado a sincronizar
+// com a GPU. As mensagens abaixo da gravidade pedida são descartadas pelo
+// próprio driver (glDebugMessageControl), e cada mensagem é impressa no
+// máximo GLDEBUG_MAX_REPEATS vezes.
+//
+// Os objetos do jogo (buffers, texturas, programas, ...) recebem nomes
+// (GL_LABEL) e os passos do desenho são marcados com grupos (GL_DEBUG_GROUP),
+// que aparecem nas mensagens e em ferramentas como o RenderDoc e o apitrace.
+//
+// Compilando com -DGLDEBUG_DISABLE (alvo Release do Code::Blocks ou
+// "make GLDEBUG=0") as macros abaixo e glCheckError() (veja "utils.h") não
+// geram código algum. Sem a opção --gl-debug, elas apenas testam se o
+// relatório está ligado.
+
+#define GLDEBUG_MAX_REPEATS  5    // Vezes que uma mesma mensagem é impressa
+#define GLDEBUG_MAX_MESSAGES 256  // Mensagens diferentes contadas; as demais são sempre impressas
+
+enum GlDebugLevel
+{
+    GLDEBUG_OFF = 0,
+    GLDEBUG_HIGH,          // Apenas erros e comportamento indefinido
+    GLDEBUG_MEDIUM,        // E avisos de desempenho e de uso de funções obsoletas
+    GLDEBUG_LOW,           // E avisos menores (por exemplo, sobre portabilidade)
+    GLDEBUG_NOTIFICATION   // E todas as mensagens informativas do driver
+};
+
+// Requer um contexto OpenGL, criado como contexto de depuração (GLFW_OPENGL_DEBUG_CONTEXT) para que o driver
+// gere todas as mensagens. "load" é a função usada para carregar as funções da extensão (a mesma passada à glad).
+// Retorna false se o driver não tiver GL_KHR_debug.
+bool GlDebug_Init(GlDebugLevel level, GLADloadproc load);
+
+// Nome do objeto "name" do tipo "identifier" (GL_BUFFER, GL_TEXTURE, GL_PROGRAM, ...). O objeto já deve ter sido
+// criado (ligado ao menos uma vez, no caso dos nomes de glGen*()).
+void GlDebug_Label(GLenum identifier, GLuint name, const char* label);
+
+void GlDebug_PushGroup(const char* name);
+void GlDebug_PopGroup();
+
+// Marca um grupo até o fim do escopo atual.
+struct GlDebugGroup
+{
+    GlDebugGroup(const char* name) { GlDebug_PushGroup(name); }
+    ~GlDebugGroup() { GlDebug_PopGroup(); }
+};
+
+// Identificadores de glObjectLabel() que não fazem parte da glad do projeto (OpenGL 3.3).
+#define GL_BUFFER  0x82E0
+#define GL_PROGRAM 0x82E2
+
+#define GLDEBUG_CONCAT2(a, b) a##b
+#define GLDEBUG_CONCAT(a, b) GLDEBUG_CONCAT2(a, b)
+
+#ifndef GLDEBUG_DISABLE
+#define GL_LABEL(identifier, name, label) GlDebug_Label(identifier, name, label)
+#define GL_DEBUG_GROUP(name)              GlDebugGroup GLDEBUG_CONCAT(gl_debug_group_, __LINE__)(name)
+#define GL_DEBUG_PUSH(name)               GlDebug_PushGroup(name)
+#define GL_DEBUG_POP()                    GlDebug_PopGroup()
+#else
+#define GL_LABEL(identifier, name, label) ((void)0)
+#define GL_DEBUG_GROUP(name)              ((void)0)
+#define GL_DEBUG_PUSH(name)               ((void)0)
+#define GL_DEBUG_POP()                    ((void)0)
+#endif
+
+#endif // _GLDEBUG_H
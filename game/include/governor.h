@@ -0,0 +1,52 @@
+#ifndef _GOVERNOR_H
+#define _GOVERNOR_H
+
+#include <cstdint>
+
+// Controle da qualidade do desenho para manter um tempo de quadro alvo (opção --target-frame-ms).
+//
+// A cada GOVERNOR_WINDOW quadros comparamos a média dos tempos de quadro com
+// o alvo. Acima de GOVERNOR_HIGH vezes o alvo, a qualidade desce um degrau;
+// abaixo de GOVERNOR_LOW vezes o alvo, sobe um degrau. Os degraus, na ordem
+// em que a qualidade desce:
+//
+//   1. a escala da resolução da cena, até GOVERNOR_MIN_SCALE, proporcional
+//      à raiz da razão entre o alvo e o tempo medido (o custo de preencher os
+//      pixels é proporcional à área);
+//   2. o "LOD bias": em cada nível, asteroides cuja projeção na tela tem
+//      menos de lod_bias * GOVERNOR_LOD_PIXELS pixels de raio não são
+//      desenhados (há apenas um nível de detalhe do modelo);
+//   3. os efeitos: com "effects" em 0 a esfera do céu, que cobre a tela
+//      inteira, não é desenhada.
+//
+// A qualidade sobe na ordem inversa. A janela e a faixa entre GOVERNOR_LOW e
+// GOVERNOR_HIGH evitam que a qualidade oscile a cada quadro.
+
+#define GOVERNOR_WINDOW        15     // Quadros entre duas decisões
+#define GOVERNOR_HIGH          1.10   // Acima de 110% do alvo, a qualidade desce
+#define GOVERNOR_LOW           0.80   // Abaixo de 80%, sobe
+#define GOVERNOR_MIN_SCALE     0.5f
+#define GOVERNOR_SCALE_STEP    0.0625f  // A escala é arredondada para múltiplos de 1/16
+#define GOVERNOR_MAX_LOD_BIAS  4
+#define GOVERNOR_LOD_PIXELS    1.0f
+#define GOVERNOR_MAX_EFFECTS   1
+
+struct FrameGovernor
+{
+    double   target_ms;         // 0 desliga o controle: a qualidade fica fixa
+    double   window_ms;         // Soma dos tempos da janela atual
+    int      window_frames;
+
+    float    resolution_scale;  // Fração da largura e da altura do framebuffer usada pela cena
+    int      lod_bias;          // 0 a GOVERNOR_MAX_LOD_BIAS
+    int      effects;           // 0 a GOVERNOR_MAX_EFFECTS
+    uint32_t changes;           // Mudanças de qualidade até agora
+};
+
+// "resolution_scale" é a escala inicial (ou fixa, sem alvo).
+void Governor_Init(FrameGovernor* governor, double target_ms, float resolution_scale);
+
+// Informa o tempo de um quadro. Retorna true se a qualidade mudou.
+bool Governor_Update(FrameGovernor* governor, double frame_ms);
+
+#endif // _GOVERNOR_H
@@ -0,0 +1,92 @@
+#ifndef _GPUTIMER_H
+#define _GPUTIMER_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Tempo de GPU de cada passo do desenho de um quadro.
+//
+// GpuTimer_Mark() grava o instante em que a GPU chega a um ponto dos comandos
+// (glQueryCounter com GL_TIMESTAMP) e indica o passo que começa ali; o tempo
+// de um passo é a diferença até a marca seguinte. Um passo pode aparecer mais
+// de uma vez no quadro, e os seus intervalos são somados. Usamos marcas em vez
+// de pares glBeginQuery/glEndQuery(GL_TIME_ELAPSED) porque estes não podem ser
+// aninhados, e o benchmark já mede o quadro inteiro com GL_TIME_ELAPSED.
+//
+// As consultas de GPUTIMER_LATENCY quadros são reutilizadas em anel. Os
+// resultados de um quadro são lidos quando o seu lugar no anel volta a ser
+// usado, sem esperar pela GPU: se ainda não estiverem prontos, o quadro é
+// descartado (GpuTimer::dropped_frames).
+//
+// Para colocar as marcas no trace do profiler, a diferença entre os relógios
+// da GPU e da CPU é medida com glGetInteger64v(GL_TIMESTAMP), que espera a GPU
+// processar os comandos já enviados. Por isso ela é medida apenas em
+// GpuTimer_Init() e a cada GPUTIMER_CALIBRATE_FRAMES quadros (os relógios se
+// afastam muito lentamente), e não a cada quadro.
+//
+// Todas as funções exigem o contexto OpenGL (são chamadas pela thread que desenha).
+
+#define GPUTIMER_LATENCY   4   // Quadros entre a gravação e a leitura das consultas
+#define GPUTIMER_MAX_MARKS 32  // Marcas por quadro; as excedentes são ignoradas
+#define GPUTIMER_CALIBRATE_FRAMES 600  // Quadros entre as medidas da diferença entre os relógios da GPU e da CPU
+
+enum GpuPass
+{
+    GPUPASS_SKY = 0,   // Esfera do fundo
+    GPUPASS_COINS,
+    GPUPASS_ASTEROIDS,  // Asteroides dos setores, do grupo e o meteoro
+    GPUPASS_SHIP,
+    GPUPASS_ROCKET,
+    GPUPASS_TEXT,
+    GPUPASS_COUNT,
+    GPUPASS_NONE = GPUPASS_COUNT  // Marca de fim do quadro
+};
+
+struct GpuTimerFrame
+{
+    GLuint  queries[GPUTIMER_MAX_MARKS];
+    uint8_t passes[GPUTIMER_MAX_MARKS];
+    int     num_marks;
+    int     tag;          // Valor dado a GpuTimer_BeginFrame(), devolvido com o resultado
+    int64_t cpu_offset;   // Soma-se a um instante da GPU para obter o instante da CPU (Profiler_Now())
+    bool    pending;      // Gravado e ainda não lido
+};
+
+// Tempos de um quadro já lidos.
+struct GpuTimerResult
+{
+    int      tag;
+    double   pass_ms[GPUPASS_COUNT];
+    int      num_marks;
+    uint8_t  passes[GPUTIMER_MAX_MARKS];
+    uint64_t cpu_times[GPUTIMER_MAX_MARKS];  // Instante de cada marca, convertido para o relógio da CPU
+};
+
+struct GpuTimer
+{
+    GpuTimerFrame frames[GPUTIMER_LATENCY];
+    int           current;         // Quadro do anel sendo gravado (-1 fora de um quadro)
+    int           next;            // Próximo quadro do anel
+    uint64_t      dropped_frames;  // Quadros cujos resultados não estavam prontos a tempo
+    int64_t       cpu_offset;      // Última diferença medida entre os relógios (veja GpuTimerFrame::cpu_offset)
+    uint32_t      calibrate_in;    // Quadros até a próxima medida
+};
+
+void GpuTimer_Init(GpuTimer* timer);
+void GpuTimer_Shutdown(GpuTimer* timer);
+
+const char* GpuTimer_PassName(GpuPass pass);
+
+// Começa a gravar um quadro. Se o lugar dele no anel tinha um quadro pronto, retorna true e o copia para "resolved".
+bool GpuTimer_BeginFrame(GpuTimer* timer, int tag, GpuTimerResult* resolved);
+
+// Começa o passo "pass" (ou termina o quadro, com GPUPASS_NONE).
+void GpuTimer_Mark(GpuTimer* timer, GpuPass pass);
+
+void GpuTimer_EndFrame(GpuTimer* timer);
+
+// Espera e lê todos os quadros pendentes, do mais antigo ao mais novo, chamando "callback" para cada um.
+void GpuTimer_Finish(GpuTimer* timer, void (*callback)(const GpuTimerResult& result, void* data), void* data);
+
+#endif // _GPUTIMER_H
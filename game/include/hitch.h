@@ -0,0 +1,78 @@
+#ifndef _HITCH_H
+#define _HITCH_H
+
+#include <cstdint>
+
+// Gravador de quadros lentos ("hitches").
+//
+// Sempre ativo: guarda em memória um resumo de cada um dos últimos
+// HITCH_HISTORY quadros (tempos, contadores de desenho, alocações e o estado
+// da simulação, incluindo a posição na gravação de entrada), enquanto o
+// profiler (veja "include/profiler.h") guarda os marcadores de tempo.
+//
+// Quando um quadro passa do orçamento (opção --hitch-ms), esperamos mais
+// HITCH_FRAMES_AFTER quadros e gravamos dois arquivos com o quadro no nome:
+//
+//     hitch_<quadro>.json   trace do profiler dos quadros em volta do lento
+//     hitch_<quadro>.txt    tabela com o resumo de cada um desses quadros
+//
+// O passo da simulação e o número de eventos de entrada de cada quadro
+// permitem reproduzir a partida até o quadro lento (--record e --replay), e o
+// checksum permite conferir a reprodução (--checksums).
+//
+// As gravações são limitadas a uma a cada "min_interval" segundos e a
+// "max_snapshots" por execução. O quadro em que uma gravação é feita não é
+// considerado, já que ele mesmo fica mais lento.
+
+#define HITCH_HISTORY       600  // Quadros guardados (10 segundos a 60 quadros por segundo)
+#define HITCH_FRAMES_BEFORE 60   // Quadros antes do lento incluídos na gravação
+#define HITCH_FRAMES_AFTER  10   // E depois dele
+#define HITCH_WARMUP_FRAMES 30   // Quadros iniciais ignorados (compilação de shaders pelo driver, primeiros acessos à memória, ...)
+
+struct HitchFrame
+{
+    uint32_t frame;
+    double   frame_ms;          // Intervalo entre o início deste quadro e o do próximo, sem a espera do FramePacer
+    double   simulation_ms;     // Todos os passos de simulação do quadro
+    double   build_ms;          // Descrição do quadro pela thread principal
+
+    // Preenchidos quando o pacote do quadro volta à thread principal (veja RenderFramePacket() em main.cpp).
+    bool     rendered;
+    uint32_t draw_calls;
+    uint64_t triangles;
+    uint32_t state_changes;
+
+    uint32_t heap_allocations;  // Chamadas de "operator new" desde o quadro anterior
+    uint64_t tick;              // Passo da simulação ao fim do quadro
+    uint32_t input_events;      // Eventos de entrada gravados (ou reproduzidos) até este quadro
+    uint64_t checksum;          // Simulation_Checksum() ao fim do quadro
+};
+
+struct HitchRecorder
+{
+    HitchFrame frames[HITCH_HISTORY];
+    uint32_t   num_frames;      // Quadros registrados; o quadro "f" fica em frames[f % HITCH_HISTORY]
+
+    double     budget_ms;       // Orçamento de um quadro (0 desliga as gravações)
+    double     min_interval;    // Segundos entre duas gravações
+    int        max_snapshots;
+    int        num_snapshots;
+    double     last_snapshot;   // Instante da última gravação
+    int64_t    pending;         // Quadro lento esperando os quadros seguintes (-1 se nenhum)
+    int64_t    ignored;         // Quadro em que a última gravação foi feita
+    char       directory[256];
+};
+
+void Hitch_Init(HitchRecorder* recorder, const char* directory, double budget_ms, double min_interval, int max_snapshots);
+
+// Registra o quadro "frame", que deve ser o seguinte ao último registrado, e retorna o seu resumo para ser preenchido.
+HitchFrame* Hitch_BeginFrame(HitchRecorder* recorder, uint32_t frame);
+
+// Resumo de um quadro ainda guardado, ou NULL.
+HitchFrame* Hitch_Frame(HitchRecorder* recorder, uint32_t frame);
+
+// Informa a duração do quadro "frame", no instante "now" (segundos). Se ele passou do orçamento, ou se um quadro
+// lento já tem os quadros seguintes necessários, grava os arquivos descritos acima.
+void Hitch_EndFrame(HitchRecorder* recorder, uint32_t frame, double frame_ms, double now);
+
+#endif // _HITCH_H
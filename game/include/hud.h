@@ -0,0 +1,81 @@
+#ifndef _HUD_H
+#define _HUD_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Painel de desempenho (tecla H ou opção --hud).
+//
+// Mostra um gráfico dos tempos de CPU e de GPU dos últimos HUD_HISTORY
+// quadros, os tempos de cada sistema, os contadores de desenho (draw calls,
+// triângulos e trocas de estado), os objetos visíveis e descartados, as
+// alocações do quadro e a memória ocupada por texturas e buffers.
+//
+// Todo o painel (retângulos do gráfico e letras do texto) é montado em um
+// único vetor de vértices e desenhado com um único glDrawArrays(), depois de
+// terminadas as medições do quadro: o painel não aparece nos números que mostra.
+//
+// As funções são chamadas pela thread que desenha, que é a dona do histórico.
+
+#define HUD_HISTORY    120   // Quadros mostrados no gráfico
+#define HUD_MAX_QUADS  2048  // Retângulos por quadro; os excedentes não são desenhados
+
+// Números de um quadro, reunidos pela thread principal e por RenderFramePacket().
+struct HudFrame
+{
+    double   cpu_ms;            // Trabalho da CPU no quadro (descrição e submissão dos desenhos)
+    double   simulation_ms;     // Todos os passos de simulação do quadro
+    double   streaming_ms;      // LevelStreamer_Update(), dentro da simulação
+    double   collisions_ms;     // Testes de colisão, dentro da simulação
+    double   build_ms;          // Descrição do quadro pela thread principal
+    double   render_ms;         // Submissão dos desenhos pela thread que desenha
+    double   latency_ms;        // Da leitura da entrada até a troca de buffers, no quadro anterior (opção --late-latch)
+    uint32_t draw_calls;
+    uint64_t triangles;
+    uint32_t state_changes;
+    uint32_t visible_objects;   // Objetos desenhados
+    uint32_t culled_objects;    // Asteroides descartados pela visibilidade
+    uint32_t heap_allocations;  // Chamadas de "operator new" desde o quadro anterior
+    uint64_t texture_bytes;     // Memória de textura e de buffers enviada à GPU
+    uint64_t buffer_bytes;
+    float    resolution_scale;  // Qualidade escolhida pelo controle do tempo de quadro (veja "include/governor.h")
+    int      scene_width, scene_height;
+    int      lod_bias;
+    int      effects;
+    uint32_t quality_changes;
+};
+
+struct HudVertex
+{
+    float x, y;        // NDC
+    float s, t;        // Coordenadas na textura da fonte; s < 0 para um retângulo sólido
+    float r, g, b, a;
+};
+
+struct Hud
+{
+    GLuint    program;
+    GLuint    vao;
+    GLuint    vbo;
+
+    float     cpu_ms[HUD_HISTORY];  // Históricos circulares. Os tempos de GPU chegam alguns quadros
+    float     gpu_ms[HUD_HISTORY];  // depois (veja "include/gputimer.h") e têm o seu próprio índice.
+    int       cpu_head;
+    int       gpu_head;
+
+    HudVertex vertices[6 * HUD_MAX_QUADS];
+    int       num_vertices;
+};
+
+// Cria o programa de GPU e o buffer do painel. Requer TextRendering_Init(), cuja textura da fonte é usada.
+void Hud_Init(Hud* hud);
+void Hud_Shutdown(Hud* hud);
+
+// Acrescenta ao histórico o tempo de GPU de um quadro já lido.
+void Hud_AddGpuFrame(Hud* hud, double gpu_ms);
+
+// Acrescenta "frame" ao histórico e desenha o painel sobre um framebuffer de "width" x "height" pixels.
+void Hud_Draw(Hud* hud, const HudFrame& frame, int width, int height);
+
+#endif // _HUD_H
@@ -0,0 +1,98 @@
+#ifndef _JOBS_H
+#define _JOBS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include "memtrack.h"
+
+// Sistema de tarefas ("jobs") com roubo de trabalho.
+//
+// Um conjunto fixo de threads executa tarefas curtas: cada thread tem sua
+// própria fila, retira tarefas do início dela e, quando ela esvazia, rouba
+// tarefas do fim da fila de outra thread. A thread que espera o fim de um
+// grupo de tarefas (Jobs_Wait) também as executa, então nenhuma thread fica
+// parada enquanto houver trabalho.
+//
+// Cada tarefa processa um intervalo [begin, end) de índices e pode sinalizar
+// um contador ao terminar. Um contador representa um grupo de tarefas: ele é
+// incrementado quando uma tarefa é submetida e decrementado quando ela termina.
+// Uma tarefa também pode depender de um contador: ela só entra nas filas
+// depois que todas as tarefas daquele contador terminarem.
+//
+// Usado pela simulação (colisões), pelo desenho (visibilidade e matrizes de
+// modelagem dos asteroides), pelo carregamento de texturas e modelos, pelo
+// rasterizador por software e pelo executável headless.
+
+#define JOBS_MAX_THREADS 64
+
+// Função de uma tarefa: processa os índices [begin, end) usando "data".
+typedef void (*JobFunction)(void* data, uint32_t begin, uint32_t end);
+
+struct JobCounter;
+
+struct Job
+{
+    JobFunction function;
+    void*       data;
+    uint32_t    begin, end;
+    JobCounter* counter;  // Decrementado quando a tarefa termina (pode ser NULL)
+    MemTag      tag;      // Categoria das alocações da thread que a submeteu (veja "include/memtrack.h")
+};
+
+// Grupo de tarefas. Deve existir até que Jobs_Wait() retorne.
+struct JobCounter
+{
+    std::atomic<uint32_t> pending;  // Tarefas submetidas e ainda não terminadas
+    std::vector<Job>      waiting;  // Tarefas que dependem deste contador, liberadas quando "pending" chega a zero
+
+    JobCounter() : pending(0) {}
+};
+
+// Fila de tarefas de uma thread: um buffer circular, que só cresce (dobrando de
+// tamanho) quando enche. Depois dos primeiros quadros, submeter tarefas não aloca memória.
+struct JobQueue
+{
+    std::mutex       mutex;
+    std::vector<Job> jobs;   // Buffer circular com jobs.size() posições
+    uint32_t         first;  // Posição da primeira tarefa
+    uint32_t         count;  // Tarefas na fila
+
+    JobQueue() : first(0), count(0) {}
+};
+
+struct JobSystem
+{
+    int                      num_threads;  // Incluindo a thread principal, que usa a fila 0
+    std::vector<std::thread> workers;
+    JobQueue                 queues[JOBS_MAX_THREADS];
+
+    std::mutex               mutex;        // Protege as listas de espera dos contadores e o sono das threads
+    std::condition_variable  wakeup;
+    std::atomic<uint32_t>    queued;       // Tarefas nas filas, ainda não iniciadas
+    bool                     quit;
+};
+
+// Cria num_threads - 1 threads (a thread que chama é a primeira). "num_threads" <= 0 usa uma thread por núcleo.
+void Jobs_Init(JobSystem* jobs, int num_threads);
+
+// Submete uma tarefa que processa os índices [begin, end). Se "dependency" não
+// for NULL, a tarefa só é executada depois que o contador chegar a zero.
+void Jobs_Submit(JobSystem* jobs, JobFunction function, void* data, uint32_t begin, uint32_t end, JobCounter* counter, JobCounter* dependency = NULL);
+
+// Divide os índices [0, count) em tarefas de até "grain" índices, distribuídas
+// em blocos contíguos entre as filas das threads (índices vizinhos tendem a ser
+// processados pela mesma thread). Não espera o fim das tarefas.
+void Jobs_ParallelFor(JobSystem* jobs, uint32_t count, uint32_t grain, JobFunction function, void* data, JobCounter* counter, JobCounter* dependency = NULL);
+
+// Executa tarefas até que o contador chegue a zero.
+void Jobs_Wait(JobSystem* jobs, JobCounter* counter);
+
+// Espera as threads terminarem suas tarefas e as encerra.
+void Jobs_Shutdown(JobSystem* jobs);
+
+#endif // _JOBS_H
@@ -0,0 +1,134 @@
+#ifndef _LEVEL_H
+#define _LEVEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Um nível descreve o mapa do jogo: asteroides estáticos, o grupo de
+// asteroides que se move em conjunto e as moedas que devem ser coletadas.
+//
+// Existem duas representações de um nível:
+//
+//   - Texto (".txt"): editável à mão. Cada linha começa com o tipo da
+//     entidade seguido dos seus parâmetros. Linhas vazias e comentários
+//     iniciados por '#' são ignorados. Valores podem ser escritos como
+//     frações, por exemplo "1/300".
+//
+//         asteroid  x y z  raio  escala
+//         group     x y z  velocidade
+//         member    x y z  escala
+//         coin      x y z  raio
+//         sector    comprimento
+//
+//   - Binário (".lvl"): gerado a partir do texto por Level_CompileText().
+//     É composto por um cabeçalho LevelFileHeader seguido dos vetores de
+//     registros abaixo, e é mapeado diretamente em memória por Level_Load(),
+//     de forma que os registros são lidos sem nenhuma cópia ou conversão.
+//
+// Os asteroides estáticos são agrupados em setores: fatias do eixo Z com
+// "comprimento" unidades cada (linha "sector", padrão LEVEL_SECTOR_LENGTH).
+// No binário os asteroides ficam ordenados por setor, na ordem em que são
+// encontrados ao voar no sentido -Z, e uma tabela LevelSector indica o
+// intervalo de registros de cada setor. Isso permite que apenas os setores
+// próximos da nave sejam carregados (veja "include/streaming.h").
+//
+// O formato binário usa a ordem de bytes da máquina (little-endian em x86/ARM).
+
+#define LEVEL_FILE_MAGIC    "LVL1"
+#define LEVEL_FILE_VERSION  2
+#define LEVEL_SECTOR_LENGTH 64.0f
+
+struct LevelAsteroid
+{
+    float x, y, z;  // Centro do asteroide
+    float radius;   // Raio da esfera de colisão
+    float scale;    // Escala aplicada ao modelo "asteroid"
+};
+
+struct LevelGroupMember
+{
+    float x, y, z;  // Posição relativa à origem do grupo
+    float scale;    // Escala aplicada ao modelo "asteroid"
+};
+
+struct LevelCoin
+{
+    float x, y, z;  // Centro da moeda
+    float radius;   // Raio do círculo de colisão
+};
+
+struct LevelSector
+{
+    int32_t  cell;            // Fatia floor(z / sector_length) coberta pelo setor
+    uint32_t first_asteroid;  // Índice do primeiro asteroide do setor
+    uint32_t num_asteroids;   // Número de asteroides do setor
+};
+
+struct LevelFileHeader
+{
+    char     magic[4];           // LEVEL_FILE_MAGIC
+    uint32_t version;            // LEVEL_FILE_VERSION
+    uint32_t num_asteroids;
+    uint32_t num_group_members;
+    uint32_t num_coins;
+    uint32_t num_sectors;
+    float    sector_length;      // Comprimento de cada setor no eixo Z
+    float    group_origin[3];    // Posição inicial do grupo de asteroides
+    float    group_speed;        // Velocidade do grupo no eixo X
+    uint64_t asteroids_offset;   // Deslocamentos (em bytes, a partir do início
+    uint64_t group_offset;       // do arquivo) de cada vetor de registros
+    uint64_t coins_offset;
+    uint64_t sectors_offset;
+};
+
+// Nível carregado. Os ponteiros apontam para dentro do arquivo mapeado em
+// memória e são válidos até a chamada de Level_Unload().
+struct Level
+{
+    const LevelAsteroid*    asteroids;
+    uint32_t                num_asteroids;
+    const LevelGroupMember* group;
+    uint32_t                num_group_members;
+    const LevelCoin*        coins;
+    uint32_t                num_coins;
+    const LevelSector*      sectors;            // Ordenados por "cell" decrescente
+    uint32_t                num_sectors;
+    float                   sector_length;
+    float                   group_origin[3];
+    float                   group_speed;
+
+    void*  mapping;       // Região mapeada (ou NULL)
+    size_t mapping_size;
+};
+
+// Converte um nível do formato texto para o formato binário.
+bool Level_CompileText(const char* text_filename, const char* binary_filename);
+
+// Escreve um nível no formato binário a partir dos seus registros, usado pelo
+// compilador acima e pelos níveis gerados proceduralmente (veja "include/stress.h").
+// Os asteroides são reordenados por setor dentro do próprio vetor.
+bool Level_WriteBinary(const char* binary_filename, std::vector<LevelAsteroid>& asteroids, const std::vector<LevelGroupMember>& group,
+                       const std::vector<LevelCoin>& coins, const float group_origin[3], float group_speed, float sector_length,
+                       uint32_t* num_sectors = NULL);
+
+// Mapeia em memória um nível no formato binário.
+bool Level_Load(const char* binary_filename, Level* level);
+
+// Carrega o nível binário, (re)compilando-o antes a partir do texto caso o
+// binário não exista ou seja mais antigo que o texto.
+bool Level_LoadOrCompile(const char* text_filename, const char* binary_filename, Level* level);
+
+// Nome do binário gerado ao lado do texto: a extensão do arquivo (se houver) trocada por ".lvl".
+std::string Level_BinaryFilename(const std::string& text_filename);
+
+// Desfaz o mapeamento feito por Level_Load().
+void Level_Unload(Level* level);
+
+// Informa ao sistema operacional que os registros dos asteroides
+// [first, first+count) não serão lidos tão cedo, liberando as páginas
+// correspondentes do arquivo mapeado.
+void Level_ReleaseAsteroids(const Level* level, uint32_t first, uint32_t count);
+
+#endif // _LEVEL_H
@@ -4,10 +4,12 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 // Esta função Matrix() auxilia na criação de matrizes usando a biblioteca GLM.
 // Note que em OpenGL (e GLM) as matrizes são definidas como "column-major",
@@ -82,6 +84,14 @@ glm::mat4 Matrix_Rotate_Y(float angle);
 // onde 'c' e 's' são o cosseno e o seno do ângulo de rotação, respectivamente.
 glm::mat4 Matrix_Rotate_Z(float angle);
 
+// Produto T*S de uma translação por um escalamento, montado diretamente (sem
+// multiplicar as duas matrizes).
+glm::mat4 Matrix_TranslateScale(float tx, float ty, float tz, float sx, float sy, float sz);
+
+// Produto T*R*S de uma translação, uma rotação (quatérnio unitário) e um
+// escalamento, montado diretamente. É a matriz de modelagem usual de um objeto.
+glm::mat4 Matrix_TRS(glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+
 // Função que calcula a norma Euclidiana de um vetor cujos coeficientes são
 // definidos em uma base ortonormal qualquer.
 float norm(glm::vec4 v);
@@ -92,6 +102,38 @@ float norm(glm::vec4 v);
 // eixo de rotação deve ser normalizado!
 glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis);
 
+// Mesma rotação de Matrix_Rotate(), para quem já tem o cosseno e o seno do
+// ângulo e o eixo normalizado (evita recalculá-los a cada matriz).
+glm::mat4 Matrix_Rotate_CosSin(float c, float s, glm::vec4 unit_axis);
+
+// Produto A*B de duas matrizes afins (última linha igual a [0 0 0 1], como as
+// de modelagem e a de câmera). Mais barato que o produto geral de 4x4.
+glm::mat4 Matrix_MultiplyAffine(const glm::mat4& A, const glm::mat4& B);
+
+// Transformações de vários objetos, uma por índice, em arrays separados por
+// componente ("structure of arrays"). "rotation_*" podem ser NULL (sem rotação)
+// e "scale" pode ser NULL (escala 1). A rotação é um quatérnio unitário.
+struct TransformArrays
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* scale;       // Escala uniforme
+    const float* rotation_x;
+    const float* rotation_y;
+    const float* rotation_z;
+    const float* rotation_w;
+};
+
+// Monta as matrizes de modelagem T*R*S de "count" objetos de uma vez, em
+// "models". Com SSE, quatro matrizes são calculadas por iteração.
+void Matrix_BuildModels(const TransformArrays& transforms, uint32_t count, glm::mat4* models);
+
+// Compara as matrizes de Matrix_BuildModels() calculadas com SSE às da versão
+// escalar (Matrix_TranslateScale() e Matrix_TRS()), com e sem rotação.
+// Imprime as diferenças e retorna false se alguma matriz não coincidir.
+bool Matrix_CheckBuildModels();
+
 // Produto vetorial entre dois vetores u e v definidos em um sistema de
 // coordenadas ortonormal.
 glm::vec4 crossproduct(glm::vec4 u, glm::vec4 v);
@@ -0,0 +1,84 @@
+#ifndef _MEMTRACK_H
+#define _MEMTRACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Rastreamento das alocações no heap.
+//
+// Em qualquer compilação, "operator new" é substituído por uma versão que
+// conta as chamadas (g_HeapAllocations) e que, depois de MemTrack_Arm(true),
+// aborta o programa mostrando a pilha de chamadas quando o código do jogo
+// aloca fora do carregamento. Assim uma alocação nova no laço principal é
+// encontrada no primeiro quadro em que aparece.
+//
+// No modo de instrumentação (compilado com -DMEMTRACK, "make MEMTRACK=1")
+// também são substituídas as funções malloc, calloc, realloc e free (apenas
+// com a glibc), e cada alocação é atribuída à categoria da thread que a fez:
+// contamos as alocações e os bytes de cada categoria, os bytes em uso e o seu
+// pico. As bibliotecas em C (driver OpenGL, GLFW, ...) aparecem nessas contas,
+// mas nunca abortam o programa: não temos como evitar as alocações delas.
+//
+// A categoria de uma thread é definida por MEMTRACK_SCOPE() e herdada pelas
+// tarefas que ela submete ao sistema de tarefas (veja "include/jobs.h").
+
+enum MemTag
+{
+    MEMTAG_OTHER = 0,
+    MEMTAG_LOADING,     // Carregamento de níveis, setores e recursos: pode alocar a qualquer momento
+    MEMTAG_SIMULATION,
+    MEMTAG_RENDER,
+    MEMTAG_TEXT,
+    MEMTAG_COUNT
+};
+
+struct MemTagStats
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+struct MemStats
+{
+    MemTagStats tags[MEMTAG_COUNT];
+    uint64_t    allocations;  // Soma de todas as categorias
+    uint64_t    bytes;
+    int64_t     live_bytes;   // Bytes em uso no momento
+    int64_t     peak_bytes;   // Maior valor de "live_bytes" desde MemTrack_ResetPeak()
+};
+
+// Número de chamadas de "operator new" desde o início do programa. Comparando
+// o valor antes e depois de um quadro verificamos que ele não alocou no heap.
+extern std::atomic<uint64_t> g_HeapAllocations;
+
+// Verdadeiro se o programa foi compilado no modo de instrumentação.
+bool MemTrack_Enabled();
+
+const char* MemTrack_TagName(MemTag tag);
+
+// Categoria da thread atual. MemTrack_SetTag() retorna a anterior.
+MemTag MemTrack_Tag();
+MemTag MemTrack_SetTag(MemTag tag);
+
+// Contadores acumulados desde o início do programa (zerados fora do modo de instrumentação).
+void MemTrack_Snapshot(MemStats* stats);
+void MemTrack_ResetPeak();
+
+// Com "armed", uma chamada de "operator new" fora de MEMTAG_LOADING aborta o programa.
+void MemTrack_Arm(bool armed);
+
+// Define a categoria da thread até o fim do bloco.
+struct MemTrackScope
+{
+    MemTag previous;
+
+    explicit MemTrackScope(MemTag tag) : previous(MemTrack_SetTag(tag)) {}
+    ~MemTrackScope() { MemTrack_SetTag(previous); }
+};
+
+#define MEMTRACK_CONCAT2(a, b) a##b
+#define MEMTRACK_CONCAT(a, b) MEMTRACK_CONCAT2(a, b)
+#define MEMTRACK_SCOPE(tag) MemTrackScope MEMTRACK_CONCAT(memtrack_scope_, __LINE__)(tag)
+
+#endif // _MEMTRACK_H
@@ -0,0 +1,62 @@
+#ifndef _OFFSCREEN_H
+#define _OFFSCREEN_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Renderização sem janela (opção --offscreen).
+//
+// Cria um contexto OpenGL 3.3 core através da EGL, sem nenhuma janela nem
+// servidor gráfico: com a plataforma "surfaceless" da Mesa quando disponível
+// (EGL_MESA_platform_surfaceless, que funciona inclusive com o rasterizador
+// por software llvmpipe em máquinas sem GPU), ou com o display padrão e uma
+// pbuffer. A cena é desenhada em um framebuffer object com a resolução pedida,
+// que fica ligado durante toda a execução, e cada quadro pode ser gravado em
+// disco como uma imagem PPM.
+//
+// A libEGL é carregada em tempo de execução (dlopen), de forma que o jogo não
+// passa a depender dela para compilar nem para executar com janela. No Windows
+// não há EGL: Offscreen_Init() apenas retorna false.
+
+struct Offscreen
+{
+    int    width, height;
+
+    void*  library;   // libEGL.so.1
+    void*  display;   // EGLDisplay
+    void*  config;    // EGLConfig
+    void*  surface;   // EGLSurface (pbuffer), ou NULL com EGL_KHR_surfaceless_context
+    void*  context;   // EGLContext
+
+    GLuint framebuffer;
+    GLuint color_buffer;
+    GLuint depth_buffer;
+
+    std::vector<unsigned char> pixels;  // Quadro lido por Offscreen_SaveFrame()
+};
+
+// Cria o contexto, torna-o corrente, carrega as funções OpenGL (glad) e cria
+// o framebuffer de "width" x "height" pixels. Com "debug_context", pede um
+// contexto de depuração (opção --gl-debug). Retorna false se não houver EGL
+// ou se o contexto não puder ser criado.
+bool Offscreen_Init(Offscreen* offscreen, int width, int height, bool debug_context);
+
+// Endereço de uma função do OpenGL (ou de uma extensão), como glfwGetProcAddress(). Requer Offscreen_Init().
+void* Offscreen_GetProcAddress(const char* name);
+
+// Grava o conteúdo atual do framebuffer em "filename" (formato PPM binário).
+bool Offscreen_SaveFrame(Offscreen* offscreen, const char* filename);
+
+// Equivalente à troca de buffers de uma janela: entrega os comandos do quadro à GPU.
+void Offscreen_EndFrame(Offscreen* offscreen);
+
+// Torna o contexto corrente na thread que chama (ou o libera, com "current"
+// falso), para que ele passe a ser usado por outra thread. O framebuffer
+// continua ligado: ele faz parte do estado do contexto.
+void Offscreen_MakeCurrent(Offscreen* offscreen, bool current);
+
+// Destrói o framebuffer e o contexto.
+void Offscreen_Shutdown(Offscreen* offscreen);
+
+#endif // _OFFSCREEN_H
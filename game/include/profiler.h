@@ -0,0 +1,84 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Marcadores de tempo da CPU.
+//
+// PROFILE_SCOPE("nome") mede o tempo desde a sua declaração até o fim do
+// bloco. O nome precisa ser uma string literal: guardamos apenas o ponteiro.
+// Cada thread grava os seus eventos em um buffer circular próprio, sem travas,
+// que guarda os últimos PROFILER_EVENTS_PER_THREAD eventos; a thread principal
+// marca o início de cada quadro com PROFILE_FRAME().
+//
+// Profiler_WriteTrace() escreve os eventos dos últimos quadros no formato
+// "trace event" do Chrome (JSON), que pode ser aberto em chrome://tracing ou
+// em https://ui.perfetto.dev. No jogo, a tecla P ou a opção --profile-trace
+// gravam o arquivo.
+//
+// Compilando com -DPROFILER_DISABLE (alvo Release do Code::Blocks ou
+// "make PROFILE=0") os marcadores não geram código algum.
+
+#define PROFILER_EVENTS_PER_THREAD 16384  // Potência de dois
+#define PROFILER_MAX_THREADS       64
+#define PROFILER_MAX_FRAMES        1024   // Inícios de quadro guardados
+
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t    begin;  // Nanossegundos (Profiler_Now())
+    uint64_t    end;
+};
+
+// Buffer circular de uma thread. Apenas ela escreve; "head" conta todos os eventos já gravados.
+struct ProfileThread
+{
+    ProfileEvent          events[PROFILER_EVENTS_PER_THREAD];
+    std::atomic<uint64_t> head;
+    char                  name[32];
+};
+
+// Instante atual em nanossegundos, de um relógio monotônico.
+uint64_t Profiler_Now();
+
+// Nome da thread atual no trace (por exemplo, "Tarefas 2").
+void Profiler_SetThreadName(const char* name);
+
+// Grava um evento já medido na thread atual.
+void Profiler_Record(const char* name, uint64_t begin, uint64_t end);
+
+// Trilha de eventos que não pertencem a uma thread, como os tempos da GPU (veja "include/gputimer.h").
+// Apenas uma thread por vez pode gravar em cada trilha. Retorna NULL se não houver buffer livre.
+ProfileThread* Profiler_CreateTrack(const char* name);
+void Profiler_RecordTrack(ProfileThread* track, const char* name, uint64_t begin, uint64_t end);
+
+// Marca o início do quadro "frame". Chamada apenas pela thread principal.
+void Profiler_BeginFrame(uint32_t frame);
+
+// Escreve os eventos dos últimos "num_frames" quadros (e do quadro atual) em "filename".
+bool Profiler_WriteTrace(const char* filename, uint32_t num_frames);
+
+struct ProfileScope
+{
+    const char* name;
+    uint64_t    begin;
+
+    explicit ProfileScope(const char* name) : name(name), begin(Profiler_Now()) {}
+    ~ProfileScope() { Profiler_Record(name, begin, Profiler_Now()); }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+#ifndef PROFILER_DISABLE
+#define PROFILE_SCOPE(name)       ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FRAME(frame)      Profiler_BeginFrame(frame)
+#define PROFILE_THREAD_NAME(name) Profiler_SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)       ((void)0)
+#define PROFILE_FRAME(frame)      ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif // _PROFILER_H
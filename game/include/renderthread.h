@@ -0,0 +1,62 @@
+#ifndef _RENDERTHREAD_H
+#define _RENDERTHREAD_H
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+// Thread de renderização (opção --render-thread).
+//
+// A thread principal simula o jogo e descreve cada quadro em um "pacote"
+// (câmera, lista de objetos visíveis, texto da tela), sem chamar o OpenGL. A
+// thread de renderização, dona do contexto OpenGL, desenha um pacote enquanto
+// a thread principal já simula e preenche o próximo. Os pacotes ficam em um
+// buffer duplo: a thread principal escreve sempre no pacote que não está
+// sendo desenhado, de forma que o tempo de um quadro tende ao maior entre o
+// tempo de simulação e o de desenho, e não à soma deles.
+//
+// "max_latency" é o número de quadros que a simulação pode estar à frente do
+// desenho: 1 permite a sobreposição descrita acima; com 0 a thread principal
+// espera cada pacote ser desenhado antes de continuar, como sem a thread.
+//
+// Este módulo apenas sincroniza as threads: o conteúdo dos pacotes e o
+// desenho são definidos por quem o usa (veja FramePacket em main.cpp).
+
+struct RenderThread
+{
+    std::thread             thread;
+    std::mutex              mutex;
+    std::condition_variable wakeup;  // Sinaliza a thread de renderização: novo pacote, chamada ou fim
+    std::condition_variable done;    // Sinaliza a thread principal: pacote desenhado ou chamada executada
+
+    int      max_latency;
+    int      write_packet;           // Pacote (0 ou 1) sendo preenchido pela thread principal
+    int      render_packet;          // Último pacote submetido
+    uint64_t submitted, completed;   // Pacotes submetidos e já desenhados
+
+    std::function<void(int packet)> render;
+    std::function<void()>           call;  // Função pendente de RenderThread_Call()
+    bool                            quit;
+};
+
+// Cria a thread. Ela chama "attach" ao começar (para tornar o contexto OpenGL
+// corrente), "render" para cada pacote submetido e "detach" ao terminar.
+void RenderThread_Start(RenderThread* rt, int max_latency, const std::function<void(int packet)>& render, const std::function<void()>& attach, const std::function<void()>& detach);
+
+// Pacote (0 ou 1) que a thread principal deve preencher agora.
+int RenderThread_WritePacket(const RenderThread* rt);
+
+// Entrega o pacote preenchido à thread de renderização. Espera o pacote
+// anterior terminar de ser desenhado e, com max_latency 0, também este.
+void RenderThread_Submit(RenderThread* rt);
+
+// Espera todos os pacotes submetidos serem desenhados e executa "function" na
+// thread de renderização (por exemplo, para usar o OpenGL fora dos quadros).
+void RenderThread_Call(RenderThread* rt, const std::function<void()>& function);
+
+// Espera os pacotes pendentes e encerra a thread.
+void RenderThread_Stop(RenderThread* rt);
+
+#endif // _RENDERTHREAD_H
@@ -0,0 +1,100 @@
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Gravação e reprodução determinística das partidas.
+//
+// Os eventos de teclado e mouse recebidos pela GLFW são gravados junto com o
+// passo da simulação em que foram consumidos, e o cabeçalho do arquivo guarda
+// a semente do gerador de números aleatórios e a taxa de simulação.
+// Reproduzir o arquivo entrega à simulação exatamente os mesmos eventos nos
+// mesmos passos, de forma que o estado do jogo evolui de forma idêntica à
+// partida gravada. O cabeçalho também guarda um hash do nível e o raio de
+// carregamento dos setores (--stream-radius), que mudariam a partida: uma
+// gravação só é reproduzida com os mesmos valores. Os checksums por passo (veja ParseCommandLine() em
+// main.cpp) permitem comparar duas execuções.
+//
+// Formato do arquivo (".inp"): um cabeçalho InputLogHeader seguido dos eventos.
+// Cada evento é codificado como:
+//
+//     uint8    tipo (INPUT_EVENT_*)
+//     varint   passos desde o evento anterior
+//     ...      dados do evento, conforme o tipo:
+//                KEY:          int16 tecla, uint8 ação
+//                MOUSE_BUTTON: uint8 botão, uint8 ação, double x, double y
+//                CURSOR_POS:   double x, double y
+//                END:          nada (último passo da gravação)
+
+#define INPUT_LOG_MAGIC   "INP1"
+#define INPUT_LOG_VERSION 3
+
+#define INPUT_EVENT_KEY          1
+#define INPUT_EVENT_MOUSE_BUTTON 2
+#define INPUT_EVENT_CURSOR_POS   3
+#define INPUT_EVENT_END          4
+
+struct InputEvent
+{
+    uint32_t tick;    // Último passo simulado antes do evento: ele é consumido pelo passo seguinte
+    uint8_t  type;    // INPUT_EVENT_*
+    uint8_t  action;  // GLFW_PRESS, GLFW_RELEASE ou GLFW_REPEAT
+    int16_t  code;    // Tecla ou botão do mouse
+    double   x, y;    // Posição do cursor
+};
+
+struct InputLogHeader
+{
+    char     magic[4];         // INPUT_LOG_MAGIC
+    uint32_t version;          // INPUT_LOG_VERSION
+    uint32_t seed;             // Semente do gerador de números aleatórios da simulação
+    uint32_t simulation_rate;  // Passos de simulação por segundo
+    uint64_t level_hash;       // Replay_LevelHash() do nível jogado
+    float    stream_radius;    // Raio de carregamento dos setores do nível
+};
+
+struct InputLog
+{
+    InputLogHeader header;
+
+    // Gravação em andamento (ou NULL).
+    FILE*    file;
+    uint32_t last_tick;
+    uint32_t num_events;  // Eventos gravados até agora
+
+    // Eventos lidos por Replay_Load() e o próximo a ser reproduzido.
+    std::vector<InputEvent> events;
+    size_t                  next;
+    uint32_t                end_tick;
+};
+
+struct Level;
+
+// Cria o arquivo de gravação e escreve o cabeçalho.
+bool Replay_StartRecording(InputLog* log, const char* filename, uint32_t seed, uint32_t simulation_rate,
+                           uint64_t level_hash, float stream_radius);
+
+// Acrescenta um evento à gravação.
+void Replay_RecordEvent(InputLog* log, const InputEvent& event);
+
+// Marca o último passo simulado e fecha o arquivo.
+void Replay_StopRecording(InputLog* log, uint32_t last_tick);
+
+// Lê uma gravação inteira para a memória.
+bool Replay_Load(const char* filename, InputLog* log);
+
+// Hash do conteúdo do nível: asteroides, grupo e moedas.
+uint64_t Replay_LevelHash(const Level& level);
+
+// Verifica se a gravação foi feita com o mesmo nível e o mesmo raio de carregamento dos setores; caso contrário,
+// imprime o erro e retorna false.
+bool Replay_CheckLevel(const InputLog& log, const char* filename, uint64_t level_hash, float stream_radius);
+
+// Hash FNV-1a de 64 bits, usado nos checksums do estado do jogo.
+#define REPLAY_HASH_SEED 14695981039346656037ULL
+uint64_t Replay_Hash(const void* data, size_t size, uint64_t hash = REPLAY_HASH_SEED);
+
+#endif // _REPLAY_H
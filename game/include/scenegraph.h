@@ -0,0 +1,55 @@
+#ifndef _SCENEGRAPH_H
+#define _SCENEGRAPH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "matrices.h"
+
+// Hierarquia de transformações do desenho.
+//
+// Os nós ficam em arrays planos, indexados pelo número do nó, e cada nó é
+// sempre adicionado depois do seu pai. Adicionando a hierarquia nível a nível
+// (primeiro as raízes, depois os filhos delas, ...) os arrays ficam ordenados
+// por profundidade, e uma única passada em ordem crescente de índice atualiza
+// os pais antes dos filhos.
+//
+// Cada nó guarda sua matriz local (relativa ao pai, sempre afim) e a matriz de
+// mundo já calculada. Alterar a matriz local marca o nó como "sujo"; a próxima
+// SceneGraph_Update() recalcula apenas os nós sujos e seus descendentes, a
+// partir do primeiro nó sujo. Objetos que não se movem têm sua matriz de mundo
+// calculada uma única vez.
+
+struct SceneGraph
+{
+    std::vector<int32_t>   parent;   // Índice do pai, ou -1 para as raízes
+    std::vector<glm::mat4> local;    // Transformação relativa ao pai
+    std::vector<glm::mat4> world;    // Transformação relativa ao mundo (pai->world * local)
+    std::vector<uint8_t>   dirty;    // Matriz local alterada desde a última atualização
+    std::vector<uint32_t>  updated;  // Número da última atualização que recalculou o nó
+
+    uint32_t update_serial;          // Número da atualização atual
+    uint32_t first_dirty;            // Menor índice de um nó sujo (igual ao número de nós se não houver)
+    uint32_t num_updated;            // Nós recalculados pela última atualização
+};
+
+// Esvazia o grafo.
+void SceneGraph_Init(SceneGraph* graph);
+
+// Adiciona um nó filho de "parent" (-1 para uma raiz) e retorna o seu índice.
+// O pai precisa ter sido adicionado antes.
+int32_t SceneGraph_AddNode(SceneGraph* graph, int32_t parent, const glm::mat4& local);
+
+// Altera a matriz local de um nó, marcando-o como sujo se ela for diferente da atual.
+void SceneGraph_SetLocal(SceneGraph* graph, int32_t node, const glm::mat4& local);
+
+// Recalcula as matrizes de mundo dos nós sujos e dos seus descendentes.
+void SceneGraph_Update(SceneGraph* graph);
+
+// Matriz de mundo de um nó, válida desde a última SceneGraph_Update().
+inline const glm::mat4& SceneGraph_World(const SceneGraph* graph, int32_t node)
+{
+    return graph->world[node];
+}
+
+#endif // _SCENEGRAPH_H
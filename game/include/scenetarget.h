@@ -0,0 +1,42 @@
+#ifndef _SCENETARGET_H
+#define _SCENETARGET_H
+
+#include <glad/glad.h>
+
+// Framebuffer intermediário da cena, para desenhá-la em uma resolução menor
+// que a do framebuffer de destino (veja "include/governor.h").
+//
+// SceneTarget_Begin() liga o framebuffer da cena e ajusta o viewport para
+// uma fração da resolução de destino; SceneTarget_Resolve() amplia a cena
+// para o destino (glBlitFramebuffer com filtro linear) e volta a desenhar
+// nele, em resolução nativa, o que vier depois (o texto e o painel de
+// desempenho). Com escala 1 a cena é desenhada direto no destino.
+//
+// O framebuffer da cena tem o tamanho do destino e só é recriado quando esse
+// tamanho muda: mudar a escala não aloca memória.
+
+struct SceneTarget
+{
+    GLuint framebuffer;
+    GLuint color_buffer;
+    GLuint depth_buffer;
+    int    width, height;              // Tamanho alocado
+    GLint  target_framebuffer;         // Destino, ligado quando SceneTarget_Begin() foi chamada
+    int    target_width, target_height;
+    int    scene_width, scene_height;  // Região desenhada no quadro atual
+    bool   active;                     // A cena está sendo desenhada no framebuffer intermediário
+};
+
+void SceneTarget_Init(SceneTarget* target);
+void SceneTarget_Shutdown(SceneTarget* target);
+
+// Tamanho da cena para um destino de "width" x "height" pixels na escala "scale".
+void SceneTarget_Size(int width, int height, float scale, int* scene_width, int* scene_height);
+
+// Começa a desenhar a cena. O viewport fica com o tamanho dado por SceneTarget_Size().
+void SceneTarget_Begin(SceneTarget* target, int width, int height, float scale);
+
+// Copia a cena para o destino e volta a desenhar nele, com o viewport inteiro.
+void SceneTarget_Resolve(SceneTarget* target);
+
+#endif // _SCENETARGET_H
@@ -0,0 +1,65 @@
+#ifndef _SHADERCACHE_H
+#define _SHADERCACHE_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Criação dos programas de GPU, com cache dos programas já ligados em disco.
+//
+// Todos os programas do jogo (a cena, o texto, o painel de desempenho e a
+// apresentação do rasterizador por software) são criados a partir do código
+// dos seus dois shaders por ShaderCache_SubmitProgram(). Com a extensão
+// GL_ARB_get_program_binary (ou OpenGL 4.1), o programa ligado é lido do
+// driver com glGetProgramBinary() e gravado na pasta do cache; nas execuções
+// seguintes ele é entregue ao driver com glProgramBinary(), sem compilar nada.
+//
+// Cada arquivo do cache é identificado por um hash do código dos shaders e
+// das strings do driver (fabricante, renderizador e versões do OpenGL e da
+// GLSL): um shader editado ou outro driver simplesmente não encontram o
+// arquivo. O driver ainda pode recusar um binário (por exemplo, depois de uma
+// atualização que não mudou as strings): nesse caso o programa é compilado a
+// partir do código e o arquivo é regravado.
+//
+// A criação é feita em duas etapas. ShaderCache_SubmitProgram() apenas entrega
+// ao driver o código (ou o binário) e pede a ligação, sem consultar o
+// resultado: consultar o estado de um shader logo depois de glCompileShader()
+// obriga o driver a terminar a compilação ali, um shader de cada vez. O estado
+// é consultado somente em ShaderCache_FinishAll(), quando os programas passam a
+// ser necessários; até lá, o jogo decodifica as texturas e os modelos. Com a
+// extensão GL_KHR_parallel_shader_compile (ou GL_ARB_parallel_shader_compile),
+// o driver compila em threads próprias.
+
+struct ShaderCacheStats
+{
+    uint32_t hits;       // Programas lidos do cache
+    uint32_t misses;     // Programas compilados a partir do código
+    uint32_t rejected;   // Dentre eles, binários do cache recusados pelo driver
+    double   total_ms;   // Tempo em que a thread que cria os programas ficou ocupada com eles (entrega e espera)
+};
+
+// Requer um contexto OpenGL. "load" é a função usada para carregar as funções das extensões (a mesma passada à
+// glad). Liga a compilação em paralelo, se o driver a tiver. Com "directory" NULL, ou sem suporte do driver, os
+// programas são sempre compilados. Retorna se o cache está ativo.
+bool ShaderCache_Init(const char* directory, GLADloadproc load);
+
+// Chamada quando o programa está pronto, por exemplo para definir as variáveis "uniform" dos shaders.
+typedef void (*ShaderProgramReady)(GLuint program, void* data);
+
+// Começa a criar um programa de GPU com os dois shaders dados e retorna o seu identificador, que ainda não pode
+// ser usado para desenhar nem para consultar as variáveis dos shaders. "name" identifica o programa nas mensagens
+// de erro. "ready" (pode ser NULL) é chamada com "data" por ShaderCache_FinishAll(), depois da ligação.
+GLuint ShaderCache_SubmitProgram(const char* name, const char* vertex_source, const char* fragment_source,
+                                 ShaderProgramReady ready, void* data);
+
+// Termina todos os programas pendentes: consulta o resultado da compilação e da ligação (esperando o driver, se
+// preciso), grava os binários no cache e chama as funções "ready". Erros de compilação e de ligação são impressos
+// no terminal; um programa com erros não desenha nada.
+void ShaderCache_FinishAll();
+
+const ShaderCacheStats& ShaderCache_Stats();
+
+// Imprime no terminal os programas lidos do cache e os compilados.
+void ShaderCache_Report();
+
+#endif // _SHADERCACHE_H
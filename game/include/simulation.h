@@ -0,0 +1,135 @@
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <cstdint>
+#include <vector>
+#include <unordered_set>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "level.h"
+#include "streaming.h"
+#include "replay.h"
+#include "jobs.h"
+
+// Simulação do jogo: movimento da nave, barrel roll, míssil, meteoro, grupo de
+// asteroides, colisões, coleta de moedas, vitória e derrota.
+//
+// Este módulo não usa OpenGL nem a GLFW (apenas as constantes de teclas da
+// GLFW, para interpretar os eventos gravados), de forma que é compartilhado
+// pelo jogo (main.cpp) e pelo executável "headless" (headless.cpp), que simula
+// muitas partidas em paralelo sem janela. Cada partida tem seu próprio
+// GameState, inclusive o gerador de números aleatórios que sorteia os
+// meteoros, então partidas diferentes podem ser simuladas em threads diferentes.
+
+#define CAMERA_ACCELERATION 3.0f
+#define MAX_CAMERA_SPEED 20.0f
+#define BARREL_ROLL_SPEED 3.0f
+#define TARGET_ANGLE 6.28f
+#define ROCKET_DURATION 5.0f
+#define ROCKET_SPEED 11.0f
+
+// Raio de colisão dos membros do grupo de asteroides por unidade de escala (o nível guarda apenas a escala): o
+// mesmo dos asteroides estáticos do nível padrão, com raio 0.5 e escala 1/300.
+#define GROUP_MEMBER_RADIUS_PER_SCALE 150.0f
+
+// Resultado de um passo da simulação. Ao fim de uma partida o estado não é
+// reiniciado: cabe a quem chamou Simulation_Tick() chamar Simulation_Reset().
+#define GAME_PLAYING 0
+#define GAME_WON     1
+#define GAME_LOST    2
+
+// Entrada do jogador, acumulada a partir dos eventos de teclado e mouse e consumida a cada passo da simulação.
+struct GameInput
+{
+    bool  forward;        // W pressionada
+    bool  backward;       // S pressionada
+    bool  roll_left;      // A pressionada
+    bool  roll_right;     // D pressionada
+    bool  fire;           // Espaço apertado desde o último passo
+    bool  start;          // Enter apertado desde o último passo
+    bool  toggle_camera;  // F apertada desde o último passo
+    float look_yaw;       // Movimento do mouse, em graus, acumulado desde o último passo
+    float look_pitch;
+
+    // Arrasto do mouse com o botão esquerdo, que gira a câmera. Veja Simulation_ApplyInputEvent().
+    bool   look_dragging;
+    double last_cursor_x, last_cursor_y;
+};
+
+// Estado do jogo. É alterado somente por Simulation_Tick(), que avança a simulação em passos de tempo fixos.
+struct GameState
+{
+    uint64_t  tick;                     // Número de passos simulados
+    double    time;                     // Tempo simulado, em segundos
+    uint32_t  random;                   // Estado do gerador de números aleatórios. Não é alterado por Simulation_Reset()
+
+    bool      started;                  // Partida em andamento (ENTER pressionado)
+    double    start_time;               // Instante do início da partida
+    uint32_t  next_coin;                // Próxima moeda a ser coletada
+    std::vector<bool>            coin_collected;
+    std::unordered_set<uint32_t> destroyed_asteroids;  // Asteroides estáticos destruídos pelos mísseis, identificados pelo seu índice no nível
+    std::vector<bool>            destroyed_members;    // Membros do grupo de asteroides destruídos pelos mísseis
+
+    bool      free_camera;
+    glm::vec3 camera_position;
+    glm::vec3 camera_front;
+    float     camera_yaw;               // Ângulos da câmera livre, em graus
+    float     camera_pitch;
+    float     camera_speed;
+    char      last_pressed_key;         // Última tecla de movimento: a nave segue nesse sentido por inércia
+
+    float     barrel_roll_angle;
+    bool      is_rolling;
+    int       barrel_roll_direction;
+
+    bool      rocket_active;
+    double    rocket_start_time;
+    glm::vec3 rocket_origin;
+    glm::vec3 rocket_direction;
+    glm::vec3 rocket_position;
+
+    bool      meteor_active;
+    double    meteor_start_time;
+    float     meteor_duration;
+    int       meteor_color;             // REDBALL(4) ou BLUEBALL(5), os identificadores de objeto usados pelos shaders
+    glm::vec4 meteor_control_points[4]; // Curva de Bézier percorrida pelo meteoro
+    glm::vec3 meteor_position;
+
+    float     group_offset;             // Deslocamento do grupo de asteroides no eixo X
+
+    bool      endless;                  // Sem vitória nem derrota (modo benchmark). Não é alterado por Simulation_Reset()
+};
+
+// Tempo de CPU gasto por Simulation_Tick() em cada sistema, acumulado entre os passos de um quadro (modo benchmark).
+struct SimulationStats
+{
+    double streaming_ms;
+    double collisions_ms;
+};
+
+// Prepara uma nova sessão: zera o relógio, semeia o gerador de números aleatórios e chama Simulation_Reset().
+void Simulation_Init(GameState& state, const Level& level, uint32_t seed, bool endless);
+
+// Coloca o jogo no estado inicial, aguardando o jogador apertar ENTER. O relógio da simulação não é reiniciado.
+void Simulation_Reset(GameState& state, const Level& level);
+
+// Avança a simulação em "dt" segundos. É chamada sempre com o mesmo "dt",
+// independente da taxa de quadros. Retorna GAME_PLAYING, GAME_WON ou GAME_LOST.
+// Com "jobs", os testes de colisão dos setores ativos são divididos em tarefas;
+// o resultado é o mesmo da execução em uma única thread.
+int Simulation_Tick(GameState& state, GameInput& input, const Level& level, LevelStreamer* streamer, float dt, SimulationStats* stats = NULL, JobSystem* jobs = NULL);
+
+// Aplica à entrada da simulação um evento de teclado ou mouse, recebido ao vivo ou lido de uma gravação.
+void Simulation_ApplyInputEvent(GameInput& input, const InputEvent& event);
+
+// Direção da câmera livre com a entrada mais recente, sem alterar o estado nem a entrada: a do último passo, girada
+// pelo movimento do mouse ainda não consumido por Simulation_Tick() e pelo arrasto até a posição (cursor_x, cursor_y),
+// lida do cursor depois do último evento. Usada para desenhar a câmera com a entrada lida o mais tarde possível.
+glm::vec3 Simulation_LatestCameraFront(const GameState& state, const GameInput& input, double cursor_x, double cursor_y);
+
+// Checksum de todo o estado da simulação, usado para verificar que a reprodução de uma partida é idêntica à gravação.
+uint64_t Simulation_Checksum(const GameState& state);
+
+#endif // _SIMULATION_H
@@ -0,0 +1,152 @@
+#ifndef _SOFTRENDER_H
+#define _SOFTRENDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "arena.h"
+#include "jobs.h"
+
+// Rasterizador por software (opção --renderer software).
+//
+// Implementa na CPU o mesmo pipeline de "shader_vertex.glsl" e
+// "shader_fragment.glsl": transformações, iluminação por object_id, texturas
+// sRGB, teste de profundidade e descarte de faces traseiras. O resultado é
+// copiado para uma textura e desenhado pela OpenGL, que continua sendo usada
+// apenas para apresentar o quadro e desenhar o texto.
+//
+// O quadro é desenhado em duas fases, cada uma dividida em tarefas executadas
+// pelo sistema de tarefas do jogo (veja "include/jobs.h"):
+//
+//   1. Geometria: os triângulos dos draws do quadro são divididos em lotes
+//      consecutivos. Cada lote transforma e recorta seus triângulos e os
+//      distribui em listas por ladrilho ("tile") da tela.
+//   2. Rasterização: cada ladrilho percorre as listas dos lotes em ordem, de
+//      forma que os triângulos são desenhados na mesma ordem dos draws, e
+//      testa e pinta 4 pixels de cada vez (SSE2, quando disponível).
+//
+// Cada ladrilho é escrito por uma única thread, então os buffers de cor e
+// profundidade não precisam de sincronização.
+
+#define SOFTRENDER_TILE_SIZE           64    // Lado de um ladrilho, em pixels (múltiplo de 4)
+#define SOFTRENDER_TRIANGLES_PER_BATCH 4096  // Triângulos por lote da fase de geometria
+
+// Atributos interpolados para cada fragmento (as variáveis "out" de shader_vertex.glsl).
+#define SOFTRENDER_POSITION_WORLD 0   // xyz
+#define SOFTRENDER_NORMAL         3   // xyz
+#define SOFTRENDER_TEXCOORDS      6   // uv
+#define SOFTRENDER_POSITION_MODEL 8   // xyz
+#define SOFTRENDER_COLOR_GOURAUD  11  // rgb
+#define SOFTRENDER_ATTRIBUTES     14
+
+// Malha: os mesmos vértices enviados à GPU por BuildTrianglesAndAddToVirtualScene().
+struct SoftMesh
+{
+    std::vector<float> positions;  // xyz por vértice
+    std::vector<float> normals;    // xyz por vértice
+    std::vector<float> texcoords;  // uv por vértice
+};
+
+// Textura sRGB com seus mipmaps, em RGBA8 (o canal alfa não é usado).
+struct SoftTexture
+{
+    std::vector<int>                   widths, heights;
+    std::vector<std::vector<uint32_t>> levels;
+    float                              log2_size;  // log2 da raiz da área do nível 0, usado na escolha do mipmap
+};
+
+// Um draw: equivale a glDrawElements() com os valores dos "uniforms" no momento da chamada.
+struct SoftDraw
+{
+    uint32_t  mesh;
+    uint32_t  first_vertex, num_vertices;  // Como first_index e num_indices de SceneObject: os índices dos modelos são sequenciais
+    glm::mat4 model, view, projection;
+    glm::vec4 camera_position;  // inverse(view) * origem, calculada por SoftRender_Draw()
+    int       object_id;
+    glm::vec4 bbox_min, bbox_max;
+    bool      cull;             // GL_CULL_FACE (faces traseiras, sentido anti-horário na frente)
+    bool      depth_test;       // GL_DEPTH_TEST
+};
+
+// Triângulo pronto para rasterização, em coordenadas da janela. Cada grandeza
+// interpolada é guardada como um plano relativo ao primeiro vértice (origin):
+// valor(x, y) = p[0]*(x - origin_x) + p[1]*(y - origin_y) + p[2].
+struct SoftTriangle
+{
+    float    origin_x, origin_y;
+    float    edges[3][3];                         // Função da aresta oposta a cada vértice, positiva dentro do triângulo
+    float    depth[3];                            // Profundidade em [0, 1]
+    float    inv_w[3];                            // 1/w, para a correção de perspectiva
+    float    attributes[SOFTRENDER_ATTRIBUTES][3];  // Atributo/w
+    int32_t  min_x, min_y, max_x, max_y;          // Pixels cobertos pela caixa envolvente
+    uint32_t draw;
+    uint32_t top_left;                            // Bit i: a aresta oposta ao vértice i é de topo ou da esquerda
+    float    lod;                                 // log2 do tamanho de um pixel em coordenadas de textura (uv)
+};
+
+struct SoftRenderer
+{
+    int width, height;
+    int stride;                       // Largura arredondada para múltiplo de 4
+    int tiles_x, tiles_y;
+
+    std::vector<uint32_t> color;      // RGBA8, linhas de baixo para cima, como na OpenGL. Alocados para o maior
+    std::vector<float>    depth;      // quadro já desenhado: quadros menores (veja "include/governor.h") reutilizam a memória.
+    uint32_t              clear_color;  // Cor de fundo (RGBA8), a mesma de glClearColor() em main.cpp
+
+    std::vector<SoftMesh>    meshes;
+    std::vector<SoftTexture> textures;
+    std::vector<SoftDraw>    draws;   // Draws do quadro atual
+
+    // Fase de geometria: triângulos de cada lote e, para cada lote, a lista de triângulos de cada ladrilho.
+    // As listas de um lote ficam na arena dele, esvaziada no início da sua fase de geometria.
+    std::vector<uint32_t>                  draw_offsets;  // Primeiro triângulo de cada draw, em ordem
+    uint32_t                               num_batches;
+    std::vector<Arena>                     arenas;        // Uma por lote
+    std::vector<ArenaVector<SoftTriangle>> triangles;
+    std::vector<ArenaVector<uint32_t>>     bins;          // [lote * número de ladrilhos + ladrilho]
+
+    JobSystem* jobs;
+    JobCounter geometry, raster;  // Tarefas das duas fases do quadro atual
+
+    // Apresentação do quadro com a OpenGL.
+    GLuint program, vertex_array, texture, sampler;
+    int    texture_width, texture_height;
+};
+
+// Cria os objetos OpenGL usados para apresentar o quadro. Deve ser chamada
+// com o contexto OpenGL corrente. As tarefas de cada quadro são executadas
+// pelas threads de "jobs".
+void SoftRender_Init(SoftRenderer* renderer, JobSystem* jobs);
+
+// Copia uma malha (mesmo formato dos VBOs: posições xyzw, normais xyzw e
+// coordenadas de textura uv; as duas últimas podem ser vazias). Retorna o
+// índice da malha.
+uint32_t SoftRender_AddMesh(SoftRenderer* renderer, const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<float>& texcoords);
+
+// Copia uma imagem RGB sRGB (linhas de baixo para cima, como carregada para a
+// OpenGL) e gera seus mipmaps. As texturas recebem índices 0, 1, ... na ordem
+// em que são adicionadas, como as unidades TextureImage0, 1, ... dos shaders.
+uint32_t SoftRender_AddTexture(SoftRenderer* renderer, const unsigned char* rgb, int width, int height);
+
+// Inicia um quadro de "width" x "height" pixels.
+void SoftRender_BeginFrame(SoftRenderer* renderer, int width, int height);
+
+// Acrescenta um draw ao quadro. Nada é desenhado até SoftRender_EndFrame().
+void SoftRender_Draw(SoftRenderer* renderer, const SoftDraw& draw);
+
+// Desenha todos os draws do quadro nos buffers de cor e profundidade.
+void SoftRender_EndFrame(SoftRenderer* renderer);
+
+// Copia o buffer de cor para o framebuffer OpenGL corrente.
+void SoftRender_Present(SoftRenderer* renderer);
+
+// Libera os objetos OpenGL.
+void SoftRender_Shutdown(SoftRenderer* renderer);
+
+#endif // _SOFTRENDER_H
@@ -0,0 +1,62 @@
+#ifndef _STREAMING_H
+#define _STREAMING_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include <glm/mat4x4.hpp>
+
+#include "level.h"
+
+// Carregamento incremental ("streaming") dos setores de um nível.
+//
+// Somente os setores cuja fatia do eixo Z está a menos de "radius" unidades da
+// nave ficam ativos: são eles que o jogo simula, testa colisões e desenha. Os
+// registros de um setor são lidos do arquivo mapeado por uma thread de
+// carregamento, e a cada quadro LevelStreamer_Update() ativa e aposenta no
+// máximo "max_changes" setores, de forma que a memória residente e o custo por
+// quadro dependem apenas do raio, e não do comprimento total do nível.
+
+// Setor carregado: cópia residente dos registros dos seus asteroides.
+struct StreamedSector
+{
+    uint32_t                   sector;          // Índice em level->sectors
+    uint32_t                   first_asteroid;  // Índice global do primeiro asteroide
+    std::vector<LevelAsteroid> asteroids;
+    std::vector<glm::mat4>     models;          // Matrizes de modelagem dos asteroides, calculadas pelo desenho na primeira vez que são usadas
+};
+
+struct LevelStreamer
+{
+    const Level* level;
+    float        radius;       // Distância (eixo Z) até a qual os setores ficam ativos
+    int          max_changes;  // Máximo de setores ativados/aposentados por atualização
+
+    std::vector<StreamedSector*> active;  // Setores ativos, prontos para uso
+    std::vector<uint8_t>         state;   // Estado de cada setor (veja streaming.cpp)
+
+    // Comunicação com a thread de carregamento. Se "threaded" for falso, os
+    // setores são lidos dentro da própria LevelStreamer_Update().
+    bool                         threaded;
+    std::thread                  worker;
+    std::mutex                   mutex;
+    std::condition_variable      wakeup;
+    std::deque<uint32_t>         requests;
+    std::deque<StreamedSector*>  ready;
+    bool                         quit;
+};
+
+// Inicializa o streamer e, se "threaded", cria a thread de carregamento.
+void LevelStreamer_Init(LevelStreamer* streamer, const Level* level, float radius, int max_changes, bool threaded);
+
+// Atualiza o conjunto de setores ativos em torno da coordenada Z da nave.
+void LevelStreamer_Update(LevelStreamer* streamer, float ship_z);
+
+// Encerra a thread de carregamento e libera todos os setores.
+void LevelStreamer_Shutdown(LevelStreamer* streamer);
+
+#endif // _STREAMING_H
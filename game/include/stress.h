@@ -0,0 +1,33 @@
+#ifndef _STRESS_H
+#define _STRESS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "level.h"
+#include "jobs.h"
+
+// Geração procedural de asteroides para o modo stress (opção --stress).
+//
+// Os asteroides são espalhados em um tubo em torno do caminho que liga a
+// origem às moedas do nível, com distribuição de Poisson (blue noise): nenhum
+// par fica a menos de uma distância mínima, escolhida a partir da quantidade
+// pedida. O tubo é dividido em fatias do eixo Z, geradas em paralelo em duas
+// fases (fatias pares e depois ímpares) pelo sistema de tarefas, de forma que
+// cada fatia só precisa consultar as vizinhas já terminadas. Cada fatia usa
+// seu próprio gerador de números aleatórios, então o resultado não depende do
+// número de threads.
+
+#define STRESS_TUBE_INNER_RADIUS 10.0f   // Corredor livre em torno do caminho
+#define STRESS_TUBE_OUTER_RADIUS 60.0f
+
+// Gera até "count" asteroides em torno do caminho das moedas de "level".
+// Retorna o número de asteroides gerados, que pode ser um pouco menor que o
+// pedido caso a amostragem sature.
+uint32_t Stress_GenerateAsteroids(const Level* level, uint32_t count, uint32_t seed, std::vector<LevelAsteroid>* asteroids, JobSystem* jobs);
+
+// Gera os asteroides e escreve um nível binário com eles no lugar dos
+// asteroides estáticos de "level", mantendo suas moedas e seu grupo.
+bool Stress_WriteLevel(const Level* level, uint32_t count, uint32_t seed, const char* binary_filename, uint32_t* generated, JobSystem* jobs);
+
+#endif // _STRESS_H
@@ -24,6 +24,10 @@ static GLenum glCheckError_(const char *file, int line)
     }
     return errorCode;
 }
+#ifndef GLDEBUG_DISABLE
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
+#else
+#define glCheckError() ((void)0)
+#endif
 
 #endif // _UTILS_H
@@ -0,0 +1,82 @@
+#include "arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+// Bloco extra do heap, usado quando a arena enche. Os dados vêm logo depois do cabeçalho.
+struct ArenaOverflow
+{
+    ArenaOverflow* next;
+    size_t         size;
+};
+
+static void* AllocateOrDie(size_t size)
+{
+    void* memory = malloc(size);
+    if (memory == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot allocate %zu bytes for the frame arena.\n", size);
+        std::exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+void Arena_Init(Arena* arena, size_t capacity)
+{
+    arena->memory = (char*)AllocateOrDie(capacity);
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->overflow = NULL;
+    arena->overflow_bytes = 0;
+}
+
+void* Arena_Allocate(Arena* arena, size_t size, size_t alignment)
+{
+    size_t offset = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= arena->capacity)
+    {
+        arena->used = offset + size;
+        return arena->memory + offset;
+    }
+
+    // O bloco encheu: usamos um bloco extra só para esta alocação, liberado no próximo Arena_Reset().
+    size_t header = (sizeof(ArenaOverflow) + alignment - 1) & ~(alignment - 1);
+    ArenaOverflow* block = (ArenaOverflow*)AllocateOrDie(header + size);
+    block->next = arena->overflow;
+    block->size = size;
+    arena->overflow = block;
+    arena->overflow_bytes += size + alignment;
+    return (char*)block + header;
+}
+
+void Arena_Reset(Arena* arena)
+{
+    arena->peak = std::max(arena->peak, arena->used + arena->overflow_bytes);
+
+    if (arena->overflow != NULL)
+    {
+        while (arena->overflow != NULL)
+        {
+            ArenaOverflow* next = arena->overflow->next;
+            free(arena->overflow);
+            arena->overflow = next;
+        }
+        arena->overflow_bytes = 0;
+
+        // Crescemos com folga, para que um quadro um pouco maior não volte a encher a arena.
+        free(arena->memory);
+        arena->capacity = std::max(2 * arena->capacity, arena->peak + arena->peak / 2);
+        arena->memory = (char*)AllocateOrDie(arena->capacity);
+    }
+    arena->used = 0;
+}
+
+void Arena_Shutdown(Arena* arena)
+{
+    Arena_Reset(arena);
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->capacity = 0;
+}
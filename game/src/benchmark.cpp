@@ -0,0 +1,244 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+RenderCounters g_RenderCounters = { 0, 0, 0 };
+
+void Benchmark_Init(Benchmark* benchmark, const Level* level, int num_frames)
+{
+    benchmark->num_frames = num_frames;
+    benchmark->load_seconds = 0.0;
+    benchmark->frame_start = 0.0;
+    benchmark->frames.assign(num_frames, BenchmarkFrame());
+
+    // A curva sai da posição inicial da nave e passa pelas moedas, na ordem em que devem ser coletadas.
+    benchmark->path.clear();
+    benchmark->path.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+    for (uint32_t i = 0; i < level->num_coins; ++i)
+        benchmark->path.push_back(glm::vec3(level->coins[i].x, level->coins[i].y, level->coins[i].z));
+
+    // Sem moedas, seguimos em linha reta no sentido -Z.
+    if (benchmark->path.size() < 2)
+        benchmark->path.push_back(glm::vec3(0.0f, 0.0f, -100.0f));
+
+    glGenQueries(BENCHMARK_QUERY_LATENCY, benchmark->queries);
+}
+
+void Benchmark_Camera(const Benchmark* benchmark, int frame, glm::vec3* position, glm::vec3* direction)
+{
+    const std::vector<glm::vec3>& p = benchmark->path;
+    int segments = (int)p.size() - 1;
+
+    float u = (benchmark->num_frames > 1) ? (float)frame / (benchmark->num_frames - 1) * segments : 0.0f;
+    int i = std::min((int)u, segments - 1);
+    float t = u - i;
+
+    // Catmull-Rom: a curva passa por todos os pontos; nas pontas repetimos o primeiro e o último.
+    glm::vec3 p0 = p[std::max(i - 1, 0)];
+    glm::vec3 p1 = p[i];
+    glm::vec3 p2 = p[i + 1];
+    glm::vec3 p3 = p[std::min(i + 2, segments)];
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+    *position = 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+
+    glm::vec3 tangent = 0.5f * ((-p0 + p2) + 2.0f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t + 3.0f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t2);
+    float length = glm::length(tangent);
+    *direction = (length > 1e-6f) ? tangent / length : glm::vec3(0.0f, 0.0f, -1.0f);
+}
+
+// Lê o tempo de GPU de um quadro. Se a sua consulta ainda não terminou,
+// glGetQueryObjectui64v() espera por ela.
+static void ReadQuery(Benchmark* benchmark, int frame)
+{
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(benchmark->queries[frame % BENCHMARK_QUERY_LATENCY], GL_QUERY_RESULT, &elapsed);
+    benchmark->frames[frame].gpu_ms = elapsed / 1.0e6;
+}
+
+void Benchmark_BeginFrame(Benchmark* benchmark, int frame, double now)
+{
+    if (frame > 0)
+        benchmark->frames[frame - 1].frame_ms = (now - benchmark->frame_start) * 1000.0;
+    benchmark->frame_start = now;
+
+    if (frame >= BENCHMARK_QUERY_LATENCY)
+        ReadQuery(benchmark, frame - BENCHMARK_QUERY_LATENCY);
+
+    g_RenderCounters.draw_calls = 0;
+    g_RenderCounters.triangles = 0;
+    g_RenderCounters.state_changes = 0;
+    glBeginQuery(GL_TIME_ELAPSED, benchmark->queries[frame % BENCHMARK_QUERY_LATENCY]);
+}
+
+void Benchmark_EndFrame(Benchmark* benchmark, int frame, double cpu_ms)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+
+    BenchmarkFrame& result = benchmark->frames[frame];
+    result.cpu_ms = cpu_ms;
+    result.draw_calls = g_RenderCounters.draw_calls;
+    result.triangles = g_RenderCounters.triangles;
+}
+
+static void PrintStatistics(const char* name, std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        sum += values[i];
+
+    // Percentil pelo método do posto mais próximo.
+    double p[3] = { 0.50, 0.95, 0.99 };
+    double v[3];
+    for (int k = 0; k < 3; ++k)
+        v[k] = values[std::min(n - 1, (size_t)std::max(1.0, std::ceil(p[k] * n)) - 1)];
+
+    printf("  %-10s média %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  máx %8.3f ms\n", name, sum / n, v[0], v[1], v[2], values[n - 1]);
+}
+
+static double Mean(const std::vector<double>& values)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < values.size(); ++i)
+        sum += values[i];
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+// Lê as consultas pendentes e libera os recursos do benchmark. Retorna o primeiro quadro medido.
+static int FinishFrames(Benchmark* benchmark, double now)
+{
+    int num_frames = benchmark->num_frames;
+    benchmark->frames[num_frames - 1].frame_ms = (now - benchmark->frame_start) * 1000.0;
+    for (int frame = std::max(0, num_frames - BENCHMARK_QUERY_LATENCY); frame < num_frames; ++frame)
+        ReadQuery(benchmark, frame);
+    glDeleteQueries(BENCHMARK_QUERY_LATENCY, benchmark->queries);
+
+    return std::min(BENCHMARK_WARMUP_FRAMES, num_frames - 1);
+}
+
+void Benchmark_Report(Benchmark* benchmark, double now)
+{
+    int num_frames = benchmark->num_frames;
+    int first = FinishFrames(benchmark, now);
+
+    std::vector<double> frame_ms, cpu_ms, gpu_ms, simulation_ms, streaming_ms, collisions_ms, render_ms, latency_ms;
+    double draw_calls = 0.0, triangles = 0.0;
+    uint32_t max_draw_calls = 0;
+    uint64_t max_triangles = 0;
+    double heap_allocations = 0.0;
+    uint32_t max_heap_allocations = 0;
+    int allocating_frames = 0;
+    double heap_bytes = 0.0;
+    int64_t peak_heap_bytes = 0;
+    double tag_allocations[MEMTAG_COUNT] = {}, tag_bytes[MEMTAG_COUNT] = {};
+    for (int i = first; i < num_frames; ++i)
+    {
+        const BenchmarkFrame& f = benchmark->frames[i];
+        frame_ms.push_back(f.frame_ms);
+        cpu_ms.push_back(f.cpu_ms);
+        gpu_ms.push_back(f.gpu_ms);
+        simulation_ms.push_back(f.simulation_ms);
+        streaming_ms.push_back(f.streaming_ms);
+        collisions_ms.push_back(f.collisions_ms);
+        render_ms.push_back(f.render_ms);
+        latency_ms.push_back(f.latency_ms);
+        draw_calls += f.draw_calls;
+        triangles += (double)f.triangles;
+        max_draw_calls = std::max(max_draw_calls, f.draw_calls);
+        max_triangles = std::max(max_triangles, f.triangles);
+        heap_allocations += f.heap_allocations;
+        max_heap_allocations = std::max(max_heap_allocations, f.heap_allocations);
+        allocating_frames += (f.heap_allocations > 0);
+        heap_bytes += (double)f.heap_bytes;
+        peak_heap_bytes = std::max(peak_heap_bytes, f.heap_peak_bytes);
+        for (int t = 0; t < MEMTAG_COUNT; ++t)
+        {
+            tag_allocations[t] += f.heap_tag_allocations[t];
+            tag_bytes[t] += (double)f.heap_tag_bytes[t];
+        }
+    }
+    int measured = num_frames - first;
+
+    printf("Benchmark: %d quadros (%d de aquecimento descartados)\n", num_frames, first);
+    printf("  Carregamento: %.3f s\n", benchmark->load_seconds);
+    PrintStatistics("Quadro", frame_ms);
+    PrintStatistics("CPU", cpu_ms);
+    PrintStatistics("GPU", gpu_ms);
+    PrintStatistics("Simulação", simulation_ms);
+    PrintStatistics("Setores", streaming_ms);
+    PrintStatistics("Colisões", collisions_ms);
+    PrintStatistics("Desenho", render_ms);
+    PrintStatistics("Latência", latency_ms);
+
+    // Os passos de quadros cujas consultas não ficaram prontas a tempo ficam de fora.
+    std::vector<double> pass_ms[GPUPASS_COUNT];
+    for (int i = first; i < num_frames; ++i)
+    {
+        const BenchmarkFrame& f = benchmark->frames[i];
+        for (int p = 0; f.gpu_passes_valid && p < GPUPASS_COUNT; ++p)
+            pass_ms[p].push_back(f.gpu_pass_ms[p]);
+    }
+    if (!pass_ms[0].empty())
+    {
+        printf("  Tempo de GPU por passo (%d quadros):\n", (int)pass_ms[0].size());
+        for (int p = 0; p < GPUPASS_COUNT; ++p)
+            PrintStatistics(GpuTimer_PassName((GpuPass)p), pass_ms[p]);
+    }
+    printf("  Draw calls por quadro: média %.1f, máx %u\n", draw_calls / measured, max_draw_calls);
+    printf("  Triângulos por quadro: média %.0f, máx %llu\n", triangles / measured, (unsigned long long)max_triangles);
+    // Depois do aquecimento, apenas quadros que ativam setores novos (veja "include/streaming.h") deveriam alocar.
+    printf("  Alocações no heap por quadro: média %.1f, máx %u, %d quadros com alocações\n", heap_allocations / measured, max_heap_allocations, allocating_frames);
+
+    // No modo de instrumentação (veja "include/memtrack.h") também contamos malloc() e os bytes, por categoria.
+    if (MemTrack_Enabled())
+    {
+        printf("  Bytes no heap por quadro: média %.0f, pico de memória em uso %.1f MB\n", heap_bytes / measured, peak_heap_bytes / (1024.0 * 1024.0));
+        for (int t = 0; t < MEMTAG_COUNT; ++t)
+            printf("    %-14s %8.1f alocações, %10.0f bytes por quadro\n", MemTrack_TagName((MemTag)t), tag_allocations[t] / measured, tag_bytes[t] / measured);
+    }
+}
+
+void Benchmark_PrintStressHeader()
+{
+    printf("Stress: médias por quadro em ms (p95 do quadro), draw calls e asteroides ativos por quadro\n");
+    printf("%10s %9s %9s %9s %9s %9s %9s %9s %9s %10s %10s %9s\n",
+           "asteroides", "geração", "quadro", "p95", "CPU", "GPU", "simulação", "setores", "colisões", "desenho", "draws", "ativos");
+}
+
+void Benchmark_ReportStressRound(Benchmark* benchmark, double now, uint32_t num_asteroids)
+{
+    int num_frames = benchmark->num_frames;
+    int first = FinishFrames(benchmark, now);
+
+    std::vector<double> frame_ms, cpu_ms, gpu_ms, simulation_ms, streaming_ms, collisions_ms, render_ms, draw_calls, active_asteroids;
+    for (int i = first; i < num_frames; ++i)
+    {
+        const BenchmarkFrame& f = benchmark->frames[i];
+        frame_ms.push_back(f.frame_ms);
+        cpu_ms.push_back(f.cpu_ms);
+        gpu_ms.push_back(f.gpu_ms);
+        simulation_ms.push_back(f.simulation_ms);
+        streaming_ms.push_back(f.streaming_ms);
+        collisions_ms.push_back(f.collisions_ms);
+        render_ms.push_back(f.render_ms);
+        draw_calls.push_back(f.draw_calls);
+        active_asteroids.push_back(f.active_asteroids);
+    }
+
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    double p95 = sorted[std::min(sorted.size() - 1, (size_t)std::max(1.0, std::ceil(0.95 * sorted.size())) - 1)];
+
+    printf("%10u %8.2fs %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %10.3f %10.0f %9.0f\n",
+           num_asteroids, benchmark->load_seconds, Mean(frame_ms), p95, Mean(cpu_ms), Mean(gpu_ms), Mean(simulation_ms),
+           Mean(streaming_ms), Mean(collisions_ms), Mean(render_ms), Mean(draw_calls), Mean(active_asteroids));
+    fflush(stdout);
+}
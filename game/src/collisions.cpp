@@ -47,6 +47,35 @@ bool checkSphereCubeCollision(BoundingSphere sphere, BoundingCube cube){
     return (cornerDistance_sq < (sphere.radius * sphere.radius));
 }
 
+// Planos da pirâmide de visão a partir da matriz projection*view (método de Gribb e Hartmann):
+// cada plano é a soma ou a diferença entre a última linha da matriz e uma das outras três.
+Frustum extractFrustum(glm::mat4 projection_view){
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i)
+        row[i] = glm::vec4(projection_view[0][i], projection_view[1][i], projection_view[2][i], projection_view[3][i]);
+
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i)
+    {
+        frustum.planes[2*i + 0] = row[3] + row[i];
+        frustum.planes[2*i + 1] = row[3] - row[i];
+    }
+    for (int i = 0; i < 6; ++i)
+        frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+    return frustum;
+}
+
+// Teste de visibilidade: esfera-pirâmide de visão. Conservador: pode aceitar esferas fora da pirâmide, perto dos cantos.
+bool checkSphereFrustumCollision(BoundingSphere sphere, const Frustum& frustum){
+    for (int i = 0; i < 6; ++i)
+    {
+        const glm::vec4& p = frustum.planes[i];
+        if (p.x * sphere.center.x + p.y * sphere.center.y + p.z * sphere.center.z + p.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
 glm::vec3 getCubeCenter(BoundingCube cube){
     return (cube.lowerBackLeft + cube.upperFrontRight) * 0.5f;
 }
@@ -0,0 +1,116 @@
+#include "framepacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX      // Sem as macros min() e max(), que escondem std::min() e std::max()
+#include <windows.h>  // timeBeginPeriod(), da biblioteca winmm
+#endif
+
+#include "profiler.h"
+
+double FramePacer_Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+VsyncMode FramePacer_SetVsync(VsyncMode mode)
+{
+    if (mode == VSYNC_ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+    {
+        printf("Sincronização vertical adaptativa não suportada pelo driver; usando a sincronização vertical comum.\n");
+        mode = VSYNC_ON;
+    }
+    glfwSwapInterval(mode == VSYNC_ADAPTIVE ? -1 : (mode == VSYNC_ON ? 1 : 0));
+    return mode;
+}
+
+void FramePacer_Init(FramePacer* pacer, int max_fps, bool throttle_idle)
+{
+    pacer->period = max_fps > 0 ? 1.0 / max_fps : 0.0;
+    pacer->next_frame = FramePacer_Now();
+    pacer->oversleep = PACER_MIN_SPIN;
+    pacer->throttle_idle = throttle_idle;
+#ifdef _WIN32
+    // Sem isso, o sleep do Windows tem resolução de 15,6 ms.
+    timeBeginPeriod(1);
+#endif
+}
+
+void FramePacer_Shutdown(FramePacer* pacer)
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+// Dorme até pouco antes de "deadline" e espera ativamente o restante.
+static void SleepUntil(FramePacer* pacer, double deadline)
+{
+    PROFILE_SCOPE("Limite de quadros");
+    double margin = std::min(PACER_MAX_SPIN, std::max(PACER_MIN_SPIN, pacer->oversleep));
+    double now = FramePacer_Now();
+    if (deadline - now > margin)
+    {
+        double requested = deadline - now - margin;
+        std::this_thread::sleep_for(std::chrono::duration<double>(requested));
+        double slept = FramePacer_Now() - now;
+        // O atraso medido esquece lentamente os valores antigos.
+        pacer->oversleep = std::max(slept - requested, pacer->oversleep * 0.95);
+    }
+    while (FramePacer_Now() < deadline)
+        std::this_thread::yield();
+}
+
+double FramePacer_Wait(FramePacer* pacer, GLFWwindow* window, bool title_screen)
+{
+    double start = FramePacer_Now();
+    bool idle = false;
+    if (window != NULL && pacer->throttle_idle)
+    {
+        if (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+        {
+            PROFILE_SCOPE("Janela minimizada");
+            while (glfwGetWindowAttrib(window, GLFW_ICONIFIED) && !glfwWindowShouldClose(window))
+                glfwWaitEvents();
+            pacer->next_frame = FramePacer_Now();
+            return pacer->next_frame - start;
+        }
+        idle = title_screen || !glfwGetWindowAttrib(window, GLFW_FOCUSED);
+    }
+
+    if (idle)
+    {
+        // O próximo quadro começa com o primeiro evento, ou no fim do período de espera.
+        PROFILE_SCOPE("Espera por eventos");
+        double deadline = std::max(pacer->next_frame + 1.0 / PACER_IDLE_FPS, start);
+        glfwWaitEventsTimeout(deadline - start);
+        pacer->next_frame = FramePacer_Now();
+        return pacer->next_frame - start;
+    }
+
+    if (pacer->period > 0.0)
+    {
+        // Um atraso menor que um quadro é compensado no próximo; se ficamos mais atrasados, recomeçamos a contagem.
+        pacer->next_frame += pacer->period;
+        if (pacer->next_frame < start - pacer->period)
+            pacer->next_frame = start;
+        SleepUntil(pacer, pacer->next_frame);
+    }
+    else
+    {
+        pacer->next_frame = start;
+    }
+
+    // Tratamos os eventos depois da espera, o mais perto possível do início do próximo quadro.
+    if (window != NULL)
+    {
+        PROFILE_SCOPE("glfwPollEvents");
+        glfwPollEvents();
+    }
+    return FramePacer_Now() - start;
+}
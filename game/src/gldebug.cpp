@@ -0,0 +1,192 @@
+#include "gldebug.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Funções e constantes de GL_KHR_debug (OpenGL 4.3), que não fazem parte da glad do projeto (OpenGL 3.3).
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS       0x8242
+#define GL_DEBUG_SOURCE_API               0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM     0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER   0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY       0x8249
+#define GL_DEBUG_SOURCE_APPLICATION       0x824A
+#define GL_DEBUG_TYPE_ERROR               0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR  0x824E
+#define GL_DEBUG_TYPE_PORTABILITY         0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE         0x8250
+#define GL_DEBUG_TYPE_MARKER              0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP          0x8269
+#define GL_DEBUG_TYPE_POP_GROUP           0x826A
+#define GL_DEBUG_SEVERITY_NOTIFICATION    0x826B
+#define GL_DEBUG_SEVERITY_HIGH            0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM          0x9147
+#define GL_DEBUG_SEVERITY_LOW             0x9148
+#define GL_DEBUG_OUTPUT                   0x92E0
+#define GL_CONTEXT_FLAG_DEBUG_BIT         0x00000002
+
+typedef void (APIENTRYP PFN_glDebugMessageCallback)(GLDEBUGPROC callback, const void* userParam);
+typedef void (APIENTRYP PFN_glDebugMessageControl)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled);
+typedef void (APIENTRYP PFN_glObjectLabel)(GLenum identifier, GLuint name, GLsizei length, const GLchar* label);
+typedef void (APIENTRYP PFN_glPushDebugGroup)(GLenum source, GLuint id, GLsizei length, const GLchar* message);
+typedef void (APIENTRYP PFN_glPopDebugGroup)();
+
+static struct
+{
+    PFN_glObjectLabel    ObjectLabel;     // NULL com o relatório desligado
+    PFN_glPushDebugGroup PushDebugGroup;
+    PFN_glPopDebugGroup  PopDebugGroup;
+    GLuint               message_ids[GLDEBUG_MAX_MESSAGES];  // Mensagens já recebidas e quantas vezes cada uma
+    unsigned             message_counts[GLDEBUG_MAX_MESSAGES];
+    int                  num_messages;
+} g_GlDebug;
+
+static bool HasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static const char* SourceName(GLenum source)
+{
+    switch (source)
+    {
+        case GL_DEBUG_SOURCE_API:             return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "WINDOW_SYSTEM";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "SHADER_COMPILER";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     return "THIRD_PARTY";
+        case GL_DEBUG_SOURCE_APPLICATION:     return "APPLICATION";
+        default:                              return "OTHER";
+    }
+}
+
+static const char* TypeName(GLenum type)
+{
+    switch (type)
+    {
+        case GL_DEBUG_TYPE_ERROR:               return "ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED_BEHAVIOR";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "UNDEFINED_BEHAVIOR";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "PERFORMANCE";
+        case GL_DEBUG_TYPE_MARKER:              return "MARKER";
+        case GL_DEBUG_TYPE_PUSH_GROUP:          return "PUSH_GROUP";
+        case GL_DEBUG_TYPE_POP_GROUP:           return "POP_GROUP";
+        default:                                return "OTHER";
+    }
+}
+
+static const char* SeverityName(GLenum severity)
+{
+    switch (severity)
+    {
+        case GL_DEBUG_SEVERITY_HIGH:   return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW:    return "low";
+        default:                       return "notification";
+    }
+}
+
+// Chamada pelo driver, na thread que fez a chamada OpenGL (GL_DEBUG_OUTPUT_SYNCHRONOUS): um ponto de parada aqui
+// mostra no depurador a pilha de chamadas que causou a mensagem.
+static void APIENTRY PrintDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                       const GLchar* message, const void* userParam)
+{
+    // Mensagens repetidas (por exemplo, de um erro a cada quadro) são impressas apenas as primeiras vezes.
+    int i = 0;
+    while (i < g_GlDebug.num_messages && g_GlDebug.message_ids[i] != id)
+        ++i;
+    if (i == g_GlDebug.num_messages && i < GLDEBUG_MAX_MESSAGES)
+    {
+        g_GlDebug.message_ids[i] = id;
+        g_GlDebug.message_counts[i] = 0;
+        g_GlDebug.num_messages += 1;
+    }
+    if (i < GLDEBUG_MAX_MESSAGES)
+    {
+        g_GlDebug.message_counts[i] += 1;
+        if (g_GlDebug.message_counts[i] > GLDEBUG_MAX_REPEATS)
+            return;
+    }
+
+    bool error = type == GL_DEBUG_TYPE_ERROR || type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR;
+    fprintf(stderr, "%s: OpenGL %s %s (%s, id %u): %s\n", error ? "ERROR" : "WARNING", SourceName(source),
+            TypeName(type), SeverityName(severity), id, message);
+    if (i < GLDEBUG_MAX_MESSAGES && g_GlDebug.message_counts[i] == GLDEBUG_MAX_REPEATS)
+        fprintf(stderr, "WARNING: OpenGL message %u repeated %d times; further ones are ignored.\n", id, GLDEBUG_MAX_REPEATS);
+}
+
+bool GlDebug_Init(GlDebugLevel level, GLADloadproc load)
+{
+    memset(&g_GlDebug, 0, sizeof(g_GlDebug));
+    if (level == GLDEBUG_OFF)
+        return false;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 43 && !HasExtension("GL_KHR_debug"))
+    {
+        fprintf(stderr, "WARNING: GL_KHR_debug not supported by the driver; --gl-debug ignored.\n");
+        return false;
+    }
+    PFN_glDebugMessageCallback DebugMessageCallback = (PFN_glDebugMessageCallback)load("glDebugMessageCallback");
+    PFN_glDebugMessageControl DebugMessageControl = (PFN_glDebugMessageControl)load("glDebugMessageControl");
+    PFN_glObjectLabel ObjectLabel = (PFN_glObjectLabel)load("glObjectLabel");
+    PFN_glPushDebugGroup PushDebugGroup = (PFN_glPushDebugGroup)load("glPushDebugGroup");
+    PFN_glPopDebugGroup PopDebugGroup = (PFN_glPopDebugGroup)load("glPopDebugGroup");
+    if (DebugMessageCallback == NULL || DebugMessageControl == NULL || ObjectLabel == NULL ||
+        PushDebugGroup == NULL || PopDebugGroup == NULL)
+    {
+        fprintf(stderr, "WARNING: GL_KHR_debug functions not found; --gl-debug ignored.\n");
+        return false;
+    }
+
+    // O driver descarta as mensagens abaixo da gravidade pedida, sem chamar PrintDebugMessage().
+    const GLenum severities[] = { GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_NOTIFICATION };
+    for (int i = 0; i < 4; ++i)
+        DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[i], 0, NULL, i < (int)level ? GL_TRUE : GL_FALSE);
+
+    // Os nossos próprios grupos geram mensagens (GL_DEBUG_TYPE_PUSH_GROUP e POP_GROUP), que não precisamos ver.
+    DebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+    DebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+
+    DebugMessageCallback(PrintDebugMessage, NULL);
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+    g_GlDebug.ObjectLabel = ObjectLabel;
+    g_GlDebug.PushDebugGroup = PushDebugGroup;
+    g_GlDebug.PopDebugGroup = PopDebugGroup;
+
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    printf("Relatório de erros do OpenGL ligado (gravidade mínima: %s%s).\n", SeverityName(severities[level - 1]),
+           (flags & GL_CONTEXT_FLAG_DEBUG_BIT) ? ", contexto de depuração" : "");
+    return true;
+}
+
+void GlDebug_Label(GLenum identifier, GLuint name, const char* label)
+{
+    if (g_GlDebug.ObjectLabel != NULL)
+        g_GlDebug.ObjectLabel(identifier, name, -1, label);
+}
+
+void GlDebug_PushGroup(const char* name)
+{
+    if (g_GlDebug.PushDebugGroup != NULL)
+        g_GlDebug.PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+void GlDebug_PopGroup()
+{
+    if (g_GlDebug.PopDebugGroup != NULL)
+        g_GlDebug.PopDebugGroup();
+}
@@ -0,0 +1,71 @@
+#include "governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+static float RoundScale(float scale)
+{
+    scale = std::floor(scale / GOVERNOR_SCALE_STEP + 0.5f) * GOVERNOR_SCALE_STEP;
+    return std::min(1.0f, std::max(GOVERNOR_MIN_SCALE, scale));
+}
+
+void Governor_Init(FrameGovernor* governor, double target_ms, float resolution_scale)
+{
+    governor->target_ms = target_ms;
+    governor->window_ms = 0.0;
+    governor->window_frames = 0;
+    governor->resolution_scale = target_ms > 0.0 ? RoundScale(resolution_scale) : std::min(1.0f, std::max(0.1f, resolution_scale));
+    governor->lod_bias = 0;
+    governor->effects = GOVERNOR_MAX_EFFECTS;
+    governor->changes = 0;
+}
+
+bool Governor_Update(FrameGovernor* governor, double frame_ms)
+{
+    if (governor->target_ms <= 0.0)
+        return false;
+
+    governor->window_ms += frame_ms;
+    governor->window_frames += 1;
+    if (governor->window_frames < GOVERNOR_WINDOW)
+        return false;
+
+    double average = governor->window_ms / governor->window_frames;
+    double target = governor->target_ms;
+    governor->window_ms = 0.0;
+    governor->window_frames = 0;
+
+    float scale = governor->resolution_scale;
+    int lod_bias = governor->lod_bias;
+    int effects = governor->effects;
+    if (average > GOVERNOR_HIGH * target)
+    {
+        if (scale > GOVERNOR_MIN_SCALE)
+        {
+            // Pelo menos um degrau de escala, para não ficar preso pelo arredondamento.
+            float wanted = scale * (float)std::sqrt(target / average);
+            scale = RoundScale(std::min(wanted, scale - GOVERNOR_SCALE_STEP));
+        }
+        else if (lod_bias < GOVERNOR_MAX_LOD_BIAS)
+            lod_bias += 1;
+        else if (effects > 0)
+            effects -= 1;
+    }
+    else if (average < GOVERNOR_LOW * target)
+    {
+        if (effects < GOVERNOR_MAX_EFFECTS)
+            effects += 1;
+        else if (lod_bias > 0)
+            lod_bias -= 1;
+        else if (scale < 1.0f)
+            scale = RoundScale(scale + GOVERNOR_SCALE_STEP);
+    }
+
+    bool changed = (scale != governor->resolution_scale || lod_bias != governor->lod_bias || effects != governor->effects);
+    governor->resolution_scale = scale;
+    governor->lod_bias = lod_bias;
+    governor->effects = effects;
+    if (changed)
+        governor->changes += 1;
+    return changed;
+}
@@ -0,0 +1,151 @@
+#include "gputimer.h"
+
+#include "profiler.h"
+
+// Soma-se a um instante da GPU para obter o instante da CPU. Espera a GPU (veja "include/gputimer.h").
+static int64_t MeasureCpuOffset()
+{
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    return (int64_t)Profiler_Now() - (int64_t)gpu_now;
+}
+
+void GpuTimer_Init(GpuTimer* timer)
+{
+    for (int i = 0; i < GPUTIMER_LATENCY; ++i)
+    {
+        GpuTimerFrame& frame = timer->frames[i];
+        glGenQueries(GPUTIMER_MAX_MARKS, frame.queries);
+        frame.num_marks = 0;
+        frame.tag = -1;
+        frame.cpu_offset = 0;
+        frame.pending = false;
+    }
+    timer->current = -1;
+    timer->next = 0;
+    timer->dropped_frames = 0;
+    timer->cpu_offset = MeasureCpuOffset();
+    timer->calibrate_in = GPUTIMER_CALIBRATE_FRAMES;
+}
+
+void GpuTimer_Shutdown(GpuTimer* timer)
+{
+    for (int i = 0; i < GPUTIMER_LATENCY; ++i)
+        glDeleteQueries(GPUTIMER_MAX_MARKS, timer->frames[i].queries);
+}
+
+const char* GpuTimer_PassName(GpuPass pass)
+{
+    switch (pass)
+    {
+        case GPUPASS_SKY:       return "Céu";
+        case GPUPASS_COINS:     return "Moedas";
+        case GPUPASS_ASTEROIDS: return "Asteroides";
+        case GPUPASS_SHIP:      return "Nave";
+        case GPUPASS_ROCKET:    return "Míssil";
+        case GPUPASS_TEXT:      return "Texto";
+        default:                return "Fim";
+    }
+}
+
+// Lê as marcas de um quadro. Com "wait" falso, não lê nada se a última ainda não estiver pronta
+// (a GPU executa os comandos em ordem, então as anteriores também estão).
+static bool ReadFrame(GpuTimerFrame& frame, bool wait, GpuTimerResult* result)
+{
+    if (!wait)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(frame.queries[frame.num_marks - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    result->tag = frame.tag;
+    result->num_marks = frame.num_marks;
+    for (int p = 0; p < GPUPASS_COUNT; ++p)
+        result->pass_ms[p] = 0.0;
+
+    GLuint64 previous = 0;
+    for (int i = 0; i < frame.num_marks; ++i)
+    {
+        GLuint64 time = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &time);
+        result->passes[i] = frame.passes[i];
+        result->cpu_times[i] = (uint64_t)((int64_t)time + frame.cpu_offset);
+        if (i > 0 && frame.passes[i - 1] != GPUPASS_NONE)
+            result->pass_ms[frame.passes[i - 1]] += (time - previous) / 1.0e6;
+        previous = time;
+    }
+    return true;
+}
+
+bool GpuTimer_BeginFrame(GpuTimer* timer, int tag, GpuTimerResult* resolved)
+{
+    int slot = timer->next;
+    timer->next = (timer->next + 1) % GPUTIMER_LATENCY;
+    timer->current = slot;
+
+    GpuTimerFrame& frame = timer->frames[slot];
+    bool ready = false;
+    if (frame.pending)
+    {
+        ready = ReadFrame(frame, false, resolved);
+        if (!ready)
+            timer->dropped_frames += 1;
+        frame.pending = false;
+    }
+
+    // Relacionamos os relógios da GPU e da CPU, para colocar as marcas no trace do profiler. A medida espera a GPU,
+    // então é refeita apenas de tempos em tempos; os quadros ainda no anel guardam a diferença com que foram gravados.
+    if (--timer->calibrate_in == 0)
+    {
+        timer->cpu_offset = MeasureCpuOffset();
+        timer->calibrate_in = GPUTIMER_CALIBRATE_FRAMES;
+    }
+    frame.cpu_offset = timer->cpu_offset;
+    frame.num_marks = 0;
+    frame.tag = tag;
+    return ready;
+}
+
+void GpuTimer_Mark(GpuTimer* timer, GpuPass pass)
+{
+    if (timer->current < 0)
+        return;
+
+    // A última marca fica reservada para o fim do quadro.
+    GpuTimerFrame& frame = timer->frames[timer->current];
+    int limit = (pass == GPUPASS_NONE) ? GPUTIMER_MAX_MARKS : GPUTIMER_MAX_MARKS - 1;
+    if (frame.num_marks >= limit)
+        return;
+
+    glQueryCounter(frame.queries[frame.num_marks], GL_TIMESTAMP);
+    frame.passes[frame.num_marks] = (uint8_t)pass;
+    frame.num_marks += 1;
+}
+
+void GpuTimer_EndFrame(GpuTimer* timer)
+{
+    if (timer->current < 0)
+        return;
+
+    GpuTimer_Mark(timer, GPUPASS_NONE);
+    GpuTimerFrame& frame = timer->frames[timer->current];
+    frame.pending = (frame.num_marks > 1);
+    timer->current = -1;
+}
+
+void GpuTimer_Finish(GpuTimer* timer, void (*callback)(const GpuTimerResult& result, void* data), void* data)
+{
+    for (int k = 0; k < GPUTIMER_LATENCY; ++k)
+    {
+        GpuTimerFrame& frame = timer->frames[(timer->next + k) % GPUTIMER_LATENCY];
+        if (!frame.pending)
+            continue;
+
+        GpuTimerResult result;
+        ReadFrame(frame, true, &result);
+        frame.pending = false;
+        callback(result, data);
+    }
+}
@@ -0,0 +1,341 @@
+// Executável "headless": simula muitas partidas em paralelo, sem janela e sem
+// OpenGL, muito mais rápido que o tempo real. Cada partida é conduzida por um
+// piloto automático com semente própria ou por uma gravação feita com a opção
+// --record do jogo (veja "include/replay.h"), e termina na primeira vitória ou
+// derrota, ou ao esgotar o tempo limite. Ao final são impressos os resultados
+// agregados e a vazão da simulação (passos por segundo por thread).
+//
+// Como o jogo, deve ser executado a partir de "bin/Linux".
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/common.hpp>
+
+#include "level.h"
+#include "streaming.h"
+#include "replay.h"
+#include "simulation.h"
+#include "jobs.h"
+
+// Resultado de uma partida. "outcome" é GAME_WON, GAME_LOST ou GAME_PLAYING (tempo esgotado ou fim da gravação).
+struct GameResult
+{
+    int      outcome;
+    uint32_t coins;         // Moedas coletadas
+    uint64_t ticks;         // Passos simulados
+    double   game_seconds;  // Duração da partida, desde o ENTER
+    uint64_t checksum;      // Simulation_Checksum() do estado final
+};
+
+// Piloto automático: acelera sempre para frente e gira a câmera em direção à
+// próxima moeda, com velocidade de giro e erro de mira sorteados por partida.
+// Eventualmente atira e faz um barrel roll.
+struct Autopilot
+{
+    uint32_t random;
+    float    max_turn;     // Giro máximo por passo, em graus
+    float    aim_noise;    // Amplitude do erro de mira, em graus
+    float    aim_yaw_error, aim_pitch_error;
+    float    fire_chance;  // Probabilidade de atirar em cada passo
+    float    roll_chance;  // Probabilidade de iniciar um barrel roll em cada passo
+};
+
+// Nível simulado. Veja "include/level.h" e ParseCommandLine().
+std::string g_LevelTextFilename = "../../data/levels/default.txt";
+std::string g_LevelBinaryFilename = "../../data/levels/default.lvl";
+float g_StreamRadius = 250.0f;
+
+// Partidas a simular, threads usadas (0 = uma por núcleo) e semente da primeira partida.
+int g_Games = 1000;
+int g_Threads = 0;
+uint32_t g_RandomSeed = 1;
+
+int g_SimulationRate = 60;
+float g_MaxGameSeconds = 180.0f;  // Tempo limite de cada partida conduzida pelo piloto automático
+bool g_PrintGames = false;         // Imprime o resultado de cada partida
+
+// Gravações que conduzem as partidas, usadas em rodízio. Se vazio, as partidas usam o piloto automático.
+std::vector<std::string> g_ReplayFilenames;
+
+static float Autopilot_Random(Autopilot* pilot)
+{
+    pilot->random = pilot->random * 1103515245u + 12345u;
+    return ((pilot->random >> 8) & 0xFFFFFF) / 16777216.0f;
+}
+
+static void Autopilot_Init(Autopilot* pilot, uint32_t seed)
+{
+    pilot->random = seed * 2654435761u + 1u;
+    pilot->max_turn = 1.0f + 2.0f * Autopilot_Random(pilot);
+    pilot->aim_noise = 2.0f * Autopilot_Random(pilot);
+    pilot->aim_yaw_error = pilot->aim_pitch_error = 0.0f;
+    pilot->fire_chance = 0.02f * Autopilot_Random(pilot);
+    pilot->roll_chance = 0.005f * Autopilot_Random(pilot);
+}
+
+// Ângulo em graus no intervalo [-180, 180).
+static float WrapDegrees(float angle)
+{
+    return angle - 360.0f * floorf((angle + 180.0f) / 360.0f);
+}
+
+static void Autopilot_Drive(Autopilot* pilot, const GameState& state, const Level& level, GameInput* input)
+{
+    input->start = !state.started;
+    input->forward = true;
+    input->roll_left = input->roll_right = false;
+
+    // A mira erra por um ângulo sorteado novamente a cada segundo simulado.
+    if (state.tick % (uint64_t)g_SimulationRate == 0)
+    {
+        pilot->aim_yaw_error = pilot->aim_noise * (2.0f * Autopilot_Random(pilot) - 1.0f);
+        pilot->aim_pitch_error = pilot->aim_noise * (2.0f * Autopilot_Random(pilot) - 1.0f);
+    }
+
+    // A nave fica à frente da câmera, na direção em que ela olha: apontando a câmera para a moeda, a nave passa por ela.
+    if (state.next_coin < level.num_coins)
+    {
+        const LevelCoin& coin = level.coins[state.next_coin];
+        glm::vec3 to_coin = glm::vec3(coin.x, coin.y, coin.z) - state.camera_position;
+        float yaw = glm::degrees(atan2f(to_coin.z, to_coin.x)) + pilot->aim_yaw_error;
+        float pitch = glm::degrees(atan2f(to_coin.y, sqrtf(to_coin.x * to_coin.x + to_coin.z * to_coin.z))) + pilot->aim_pitch_error;
+
+        input->look_yaw = glm::clamp(WrapDegrees(yaw - state.camera_yaw), -pilot->max_turn, pilot->max_turn);
+        input->look_pitch = glm::clamp(pitch - state.camera_pitch, -pilot->max_turn, pilot->max_turn);
+    }
+
+    if (Autopilot_Random(pilot) < pilot->fire_chance)
+        input->fire = true;
+    if (Autopilot_Random(pilot) < pilot->roll_chance)
+        (Autopilot_Random(pilot) < 0.5f ? input->roll_left : input->roll_right) = true;
+}
+
+static GameResult FinishGame(const GameState& state, int outcome, LevelStreamer* streamer)
+{
+    GameResult result;
+    result.outcome = outcome;
+    result.coins = state.next_coin;
+    result.ticks = state.tick;
+    result.game_seconds = state.started ? state.time - state.start_time : 0.0;
+    result.checksum = Simulation_Checksum(state);
+    LevelStreamer_Shutdown(streamer);
+    return result;
+}
+
+static GameResult PlayScriptedGame(const Level& level, uint32_t seed)
+{
+    GameState state;
+    Simulation_Init(state, level, seed, false);
+
+    // Os setores são lidos na própria simulação: as threads já estão ocupadas com as outras partidas.
+    LevelStreamer streamer;
+    LevelStreamer_Init(&streamer, &level, g_StreamRadius, 2, false);
+
+    Autopilot pilot;
+    Autopilot_Init(&pilot, seed);
+
+    GameInput input = {};
+    const float dt = 1.0f / g_SimulationRate;
+    const uint64_t max_ticks = (uint64_t)(g_MaxGameSeconds * g_SimulationRate);
+
+    int outcome = GAME_PLAYING;
+    while (outcome == GAME_PLAYING && state.tick < max_ticks)
+    {
+        Autopilot_Drive(&pilot, state, level, &input);
+        outcome = Simulation_Tick(state, input, level, &streamer, dt);
+    }
+    return FinishGame(state, outcome, &streamer);
+}
+
+// Reproduz uma gravação exatamente como o jogo faz com a opção --replay, até a primeira vitória ou derrota.
+static GameResult PlayRecordedGame(const Level& level, const InputLog& log)
+{
+    GameState state;
+    Simulation_Init(state, level, log.header.seed, false);
+
+    LevelStreamer streamer;
+    LevelStreamer_Init(&streamer, &level, g_StreamRadius, 2, false);
+
+    GameInput input = {};
+    const float dt = 1.0f / log.header.simulation_rate;
+
+    size_t next = 0;
+    int outcome = GAME_PLAYING;
+    while (outcome == GAME_PLAYING && state.tick < log.end_tick)
+    {
+        while (next < log.events.size() && log.events[next].tick <= state.tick)
+            Simulation_ApplyInputEvent(input, log.events[next++]);
+        outcome = Simulation_Tick(state, input, level, &streamer, dt);
+    }
+    return FinishGame(state, outcome, &streamer);
+}
+
+// Partidas simuladas pelas tarefas de PlayGames().
+struct HeadlessGames
+{
+    const Level*                   level;
+    const std::vector<InputLog>*   logs;
+    std::vector<GameResult>*       results;
+};
+
+static void PlayGames(void* data, uint32_t begin, uint32_t end)
+{
+    HeadlessGames* games = (HeadlessGames*)data;
+    for (uint32_t game = begin; game < end; ++game)
+    {
+        if (games->logs->empty())
+            (*games->results)[game] = PlayScriptedGame(*games->level, g_RandomSeed + game);
+        else
+            (*games->results)[game] = PlayRecordedGame(*games->level, (*games->logs)[game % games->logs->size()]);
+    }
+}
+
+// Interpreta os argumentos da linha de comando:
+//   --level <arquivo.txt>          simula o nível indicado (o binário ".lvl" é gerado ao lado do texto)
+//   --stream-radius <distância>    distância da nave até a qual os setores do nível ficam carregados
+//   --games <partidas>             número de partidas simuladas (padrão 1000)
+//   --threads <threads>            número de threads (padrão 0, uma por núcleo)
+//   --seed <semente>               semente da primeira partida; a partida i usa semente + i (padrão 1)
+//   --sim-hz <passos>              passos de simulação por segundo do piloto automático (padrão 60)
+//   --max-seconds <segundos>       tempo limite de cada partida do piloto automático (padrão 180)
+//   --replay <arquivo.inp>         conduz as partidas com uma gravação; pode ser repetida, e as gravações são usadas em rodízio
+//   --print-games                  imprime o resultado de cada partida
+static void ParseCommandLine(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--level" && i + 1 < argc)
+        {
+            g_LevelTextFilename = argv[++i];
+            g_LevelBinaryFilename = Level_BinaryFilename(g_LevelTextFilename);
+        }
+        else if (arg == "--stream-radius" && i + 1 < argc)
+        {
+            g_StreamRadius = (float)atof(argv[++i]);
+        }
+        else if (arg == "--games" && i + 1 < argc)
+        {
+            g_Games = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            g_Threads = std::max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            g_RandomSeed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (arg == "--sim-hz" && i + 1 < argc)
+        {
+            g_SimulationRate = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--max-seconds" && i + 1 < argc)
+        {
+            g_MaxGameSeconds = std::max(0.0f, (float)atof(argv[++i]));
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            g_ReplayFilenames.push_back(argv[++i]);
+        }
+        else if (arg == "--print-games")
+        {
+            g_PrintGames = true;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unknown argument \"%s\".\n", argv[i]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ParseCommandLine(argc, argv);
+
+    Level level;
+    if (!Level_LoadOrCompile(g_LevelTextFilename.c_str(), g_LevelBinaryFilename.c_str(), &level))
+    {
+        fprintf(stderr, "ERROR: Cannot load level \"%s\".\n", g_LevelBinaryFilename.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<InputLog> logs(g_ReplayFilenames.size());
+    for (size_t i = 0; i < logs.size(); ++i)
+    {
+        if (!Replay_Load(g_ReplayFilenames[i].c_str(), &logs[i])
+            || !Replay_CheckLevel(logs[i], g_ReplayFilenames[i].c_str(), Replay_LevelHash(level), g_StreamRadius))
+            std::exit(EXIT_FAILURE);
+    }
+
+    int num_threads = (g_Threads > 0) ? g_Threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, g_Games);
+
+    // Cada partida é uma tarefa; as threads ociosas roubam as partidas das outras. Os resultados ficam na
+    // ordem das partidas, de forma que o relatório não depende do número de threads.
+    std::vector<GameResult> results(g_Games);
+    HeadlessGames games = { &level, &logs, &results };
+
+    JobSystem jobs;
+    Jobs_Init(&jobs, num_threads);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JobCounter counter;
+    Jobs_ParallelFor(&jobs, (uint32_t)g_Games, 1, PlayGames, &games, &counter);
+    Jobs_Wait(&jobs, &counter);
+    Jobs_Shutdown(&jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int won = 0, lost = 0, unfinished = 0;
+    uint64_t ticks = 0, coins = 0;
+    uint32_t max_coins = 0;
+    double won_seconds = 0.0;
+    uint64_t checksum = REPLAY_HASH_SEED;
+    for (int i = 0; i < g_Games; ++i)
+    {
+        const GameResult& r = results[i];
+        if (g_PrintGames)
+        {
+            const char* outcome = (r.outcome == GAME_WON) ? "vitória" : (r.outcome == GAME_LOST) ? "derrota" : "sem resultado";
+            printf("Partida %d: %s, %u moedas, %.2f s, %llu passos, checksum %016llx\n",
+                   i, outcome, r.coins, r.game_seconds, (unsigned long long)r.ticks, (unsigned long long)r.checksum);
+        }
+
+        won += (r.outcome == GAME_WON);
+        lost += (r.outcome == GAME_LOST);
+        unfinished += (r.outcome == GAME_PLAYING);
+        if (r.outcome == GAME_WON)
+            won_seconds += r.game_seconds;
+        ticks += r.ticks;
+        coins += r.coins;
+        max_coins = std::max(max_coins, r.coins);
+        checksum = Replay_Hash(&r.checksum, sizeof(r.checksum), checksum);
+    }
+
+    double ticks_per_second = ticks / seconds;
+    printf("Headless: %d partidas em %d threads, %.3f s (%s)\n", g_Games, num_threads, seconds,
+           logs.empty() ? "piloto automático" : "gravações");
+    printf("  Vitórias: %d (%.1f%%), derrotas: %d (%.1f%%), sem resultado: %d (%.1f%%)\n",
+           won, 100.0 * won / g_Games, lost, 100.0 * lost / g_Games, unfinished, 100.0 * unfinished / g_Games);
+    printf("  Moedas por partida: média %.2f, máx %u de %u\n", (double)coins / g_Games, max_coins, level.num_coins);
+    if (won > 0)
+        printf("  Duração média das vitórias: %.2f s\n", won_seconds / won);
+    printf("  Passos simulados: %llu (%.0f por segundo, %.0f por segundo por thread)\n",
+           (unsigned long long)ticks, ticks_per_second, ticks_per_second / num_threads);
+    printf("  Checksum das partidas: %016llx\n", (unsigned long long)checksum);
+
+    Level_Unload(&level);
+    return 0;
+}
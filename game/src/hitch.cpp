@@ -0,0 +1,111 @@
+#include "hitch.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "memtrack.h"
+#include "profiler.h"
+
+void Hitch_Init(HitchRecorder* recorder, const char* directory, double budget_ms, double min_interval, int max_snapshots)
+{
+    recorder->num_frames = 0;
+    recorder->budget_ms = budget_ms;
+    recorder->min_interval = min_interval;
+    recorder->max_snapshots = max_snapshots;
+    recorder->num_snapshots = 0;
+    recorder->last_snapshot = 0.0;
+    recorder->pending = -1;
+    recorder->ignored = -1;
+    snprintf(recorder->directory, sizeof(recorder->directory), "%s", directory);
+}
+
+HitchFrame* Hitch_BeginFrame(HitchRecorder* recorder, uint32_t frame)
+{
+    HitchFrame* slot = &recorder->frames[frame % HITCH_HISTORY];
+    memset(slot, 0, sizeof(HitchFrame));
+    slot->frame = frame;
+    recorder->num_frames = frame + 1;
+    return slot;
+}
+
+HitchFrame* Hitch_Frame(HitchRecorder* recorder, uint32_t frame)
+{
+    if (frame >= recorder->num_frames || recorder->num_frames - frame > HITCH_HISTORY)
+        return NULL;
+    HitchFrame* slot = &recorder->frames[frame % HITCH_HISTORY];
+    return slot->frame == frame ? slot : NULL;
+}
+
+// Grava os arquivos do quadro lento "hitch", com os quadros guardados até "last".
+static void WriteSnapshot(HitchRecorder* recorder, uint32_t hitch, uint32_t last)
+{
+    // A gravação é rara e pode alocar, como o carregamento.
+    MEMTRACK_SCOPE(MEMTAG_LOADING);
+
+    uint32_t first = hitch > HITCH_FRAMES_BEFORE ? hitch - HITCH_FRAMES_BEFORE : 0;
+    if (recorder->num_frames > HITCH_HISTORY && first < recorder->num_frames - HITCH_HISTORY)
+        first = recorder->num_frames - HITCH_HISTORY;
+
+    char filename[300];
+    snprintf(filename, sizeof(filename), "%s/hitch_%05u.json", recorder->directory, hitch);
+    // O trace vai até o quadro atual, que começou depois de "last".
+    Profiler_WriteTrace(filename, last + 2 - first);
+
+    snprintf(filename, sizeof(filename), "%s/hitch_%05u.txt", recorder->directory, hitch);
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open hitch file \"%s\" for writing.\n", filename);
+        return;
+    }
+
+    const HitchFrame* slow = Hitch_Frame(recorder, hitch);
+    fprintf(file, "Quadro lento %u: %.2f ms (orçamento %.2f ms).\n", hitch, slow->frame_ms, recorder->budget_ms);
+    fprintf(file, "Passo da simulação %llu, %u eventos de entrada, checksum %016llx.\n",
+            (unsigned long long)slow->tick, slow->input_events, (unsigned long long)slow->checksum);
+    fprintf(file, "Para reproduzir, grave a partida com --record e reproduza a gravação com --replay até esse passo.\n\n");
+    fprintf(file, "  quadro        ms  simulação  descrição  draw calls  triângulos  trocas  alocações     passo  eventos  checksum\n");
+    for (uint32_t f = first; f <= last; ++f)
+    {
+        const HitchFrame* frame = Hitch_Frame(recorder, f);
+        if (frame == NULL)
+            continue;
+        fprintf(file, "%c %6u  %8.2f  %9.2f  %9.2f", f == hitch ? '*' : ' ', f, frame->frame_ms, frame->simulation_ms, frame->build_ms);
+        if (frame->rendered)
+            fprintf(file, "  %10u  %10llu  %6u", frame->draw_calls, (unsigned long long)frame->triangles, frame->state_changes);
+        else
+            fprintf(file, "  %10s  %10s  %6s", "-", "-", "-");
+        fprintf(file, "  %9u  %8llu  %7u  %016llx\n", frame->heap_allocations, (unsigned long long)frame->tick,
+                frame->input_events, (unsigned long long)frame->checksum);
+    }
+    fclose(file);
+    printf("Quadro lento %u (%.2f ms): gravado em \"%s\".\n", hitch, slow->frame_ms, filename);
+}
+
+void Hitch_EndFrame(HitchRecorder* recorder, uint32_t frame, double frame_ms, double now)
+{
+    HitchFrame* slot = Hitch_Frame(recorder, frame);
+    if (slot == NULL)
+        return;
+    slot->frame_ms = frame_ms;
+
+    if (recorder->budget_ms <= 0.0)
+        return;
+
+    bool allowed = recorder->num_snapshots < recorder->max_snapshots &&
+                   (recorder->num_snapshots == 0 || now - recorder->last_snapshot >= recorder->min_interval);
+    if (recorder->pending < 0 && allowed && frame >= HITCH_WARMUP_FRAMES && (int64_t)frame != recorder->ignored &&
+        frame_ms > recorder->budget_ms)
+    {
+        recorder->pending = frame;
+    }
+
+    if (recorder->pending >= 0 && frame >= recorder->pending + HITCH_FRAMES_AFTER)
+    {
+        WriteSnapshot(recorder, (uint32_t)recorder->pending, frame);
+        recorder->pending = -1;
+        recorder->num_snapshots += 1;
+        recorder->last_snapshot = now;
+        recorder->ignored = frame + 1;
+    }
+}
@@ -0,0 +1,241 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "gldebug.h"
+#include "shadercache.h"
+
+// Funções definidas em textrendering.cpp
+int TextRendering_LayoutString(const char* str, float x, float y, float sx, float sy, float* quads, int max_quads);
+float TextRendering_FontHeight();
+
+// Unidade de textura da fonte, ligada por TextRendering_Init().
+#define HUD_FONT_TEXTURE_UNIT 31
+
+#define HUD_MARGIN       8.0f   // Pixels entre o painel e a borda do framebuffer, e entre o painel e o seu conteúdo
+#define HUD_BAR_WIDTH    2.0f   // Largura, em pixels, de cada quadro no gráfico (uma coluna de CPU e uma de GPU)
+#define HUD_GRAPH_HEIGHT 64.0f
+#define HUD_GRAPH_MS     (2.0f * 1000.0f / 60.0f)  // Tempo no topo do gráfico: dois quadros a 60 Hz
+#define HUD_NUM_LINES    7
+
+static const GLchar* const hudvertexshader_source = ""
+"#version 330\n"
+"layout (location = 0) in vec4 position;\n"
+"layout (location = 1) in vec4 color;\n"
+"out vec2 texCoords;\n"
+"out vec4 vertexColor;\n"
+"void main()\n"
+"{\n"
+    "gl_Position = vec4(position.xy, 0, 1);\n"
+    "texCoords = position.zw;\n"
+    "vertexColor = color;\n"
+"}\n"
+"\0";
+
+// Retângulos sólidos têm s < 0; as letras usam o canal vermelho da textura da fonte como opacidade.
+static const GLchar* const hudfragmentshader_source = ""
+"#version 330\n"
+"uniform sampler2D tex;\n"
+"in vec2 texCoords;\n"
+"in vec4 vertexColor;\n"
+"out vec4 fragColor;\n"
+"void main()\n"
+"{\n"
+    "float alpha = texCoords.x < 0.0 ? 1.0 : texture(tex, texCoords).r;\n"
+    "fragColor = vec4(vertexColor.rgb, vertexColor.a * alpha);\n"
+"}\n"
+"\0";
+
+static const float HUD_BACKGROUND[4] = { 0.0f, 0.0f, 0.0f, 0.6f };
+static const float HUD_GRID[4]       = { 1.0f, 1.0f, 1.0f, 0.3f };
+static const float HUD_CPU[4]        = { 1.0f, 0.6f, 0.1f, 0.9f };
+static const float HUD_GPU[4]        = { 0.2f, 0.8f, 1.0f, 0.9f };
+static const float HUD_TEXT[4]       = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+// Chamada por ShaderCache_FinishAll() quando o programa de GPU do painel está ligado.
+static void SetHudUniforms(GLuint program, void* data)
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "tex"), HUD_FONT_TEXTURE_UNIT);
+    glUseProgram(0);
+}
+
+void Hud_Init(Hud* hud)
+{
+    hud->program = ShaderCache_SubmitProgram("hud", hudvertexshader_source, hudfragmentshader_source, SetHudUniforms, NULL);
+
+    // O buffer tem espaço para o maior painel possível; cada quadro reescreve apenas o início dele.
+    glGenVertexArrays(1, &hud->vao);
+    glGenBuffers(1, &hud->vbo);
+    glBindVertexArray(hud->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, hud->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(hud->vertices), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    GL_LABEL(GL_BUFFER, hud->vbo, "Painel de desempenho (vértices)");
+    GL_LABEL(GL_VERTEX_ARRAY, hud->vao, "Painel de desempenho");
+
+    for (int i = 0; i < HUD_HISTORY; ++i)
+    {
+        hud->cpu_ms[i] = 0.0f;
+        hud->gpu_ms[i] = 0.0f;
+    }
+    hud->cpu_head = 0;
+    hud->gpu_head = 0;
+    hud->num_vertices = 0;
+}
+
+void Hud_Shutdown(Hud* hud)
+{
+    glDeleteBuffers(1, &hud->vbo);
+    glDeleteVertexArrays(1, &hud->vao);
+    glDeleteProgram(hud->program);
+}
+
+void Hud_AddGpuFrame(Hud* hud, double gpu_ms)
+{
+    hud->gpu_ms[hud->gpu_head] = (float)gpu_ms;
+    hud->gpu_head = (hud->gpu_head + 1) % HUD_HISTORY;
+}
+
+// Acrescenta um retângulo dado em pixels (origem no canto superior esquerdo), convertido para NDC.
+static void AddQuad(Hud* hud, float x0, float y0, float x1, float y1, float s0, float t0, float s1, float t1,
+                    const float color[4], int width, int height)
+{
+    if (hud->num_vertices + 6 > 6 * HUD_MAX_QUADS)
+        return;
+
+    float nx0 = 2.0f * x0 / width - 1.0f;
+    float nx1 = 2.0f * x1 / width - 1.0f;
+    float ny0 = 1.0f - 2.0f * y0 / height;
+    float ny1 = 1.0f - 2.0f * y1 / height;
+
+    HudVertex corners[6] = {
+        { nx0, ny0, s0, t0, color[0], color[1], color[2], color[3] },
+        { nx0, ny1, s0, t1, color[0], color[1], color[2], color[3] },
+        { nx1, ny1, s1, t1, color[0], color[1], color[2], color[3] },
+        { nx0, ny0, s0, t0, color[0], color[1], color[2], color[3] },
+        { nx1, ny1, s1, t1, color[0], color[1], color[2], color[3] },
+        { nx1, ny0, s1, t0, color[0], color[1], color[2], color[3] },
+    };
+    for (int i = 0; i < 6; ++i)
+        hud->vertices[hud->num_vertices++] = corners[i];
+}
+
+static void AddRect(Hud* hud, float x0, float y0, float x1, float y1, const float color[4], int width, int height)
+{
+    AddQuad(hud, x0, y0, x1, y1, -1.0f, 0.0f, -1.0f, 0.0f, color, width, height);
+}
+
+// Escreve "text" com a linha de base em "y" (pixels). Retorna a coordenada x do fim do texto.
+static float AddText(Hud* hud, const char* text, float x, float y, int width, int height)
+{
+    float quads[8 * 128];
+    int count = TextRendering_LayoutString(text, x, y, 1.0f, -1.0f, quads, 128);
+    for (int i = 0; i < count; ++i)
+    {
+        const float* q = quads + 8 * i;
+        AddQuad(hud, q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], HUD_TEXT, width, height);
+    }
+    return count > 0 ? quads[8 * (count - 1) + 2] : x;
+}
+
+static float Megabytes(uint64_t bytes)
+{
+    return bytes / (1024.0f * 1024.0f);
+}
+
+void Hud_Draw(Hud* hud, const HudFrame& frame, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    hud->cpu_ms[hud->cpu_head] = (float)frame.cpu_ms;
+    hud->cpu_head = (hud->cpu_head + 1) % HUD_HISTORY;
+
+    float cpuMax = 0.0f, gpuMax = 0.0f;
+    for (int i = 0; i < HUD_HISTORY; ++i)
+    {
+        cpuMax = std::max(cpuMax, hud->cpu_ms[i]);
+        gpuMax = std::max(gpuMax, hud->gpu_ms[i]);
+    }
+    float gpuLast = hud->gpu_ms[(hud->gpu_head + HUD_HISTORY - 1) % HUD_HISTORY];
+
+    char lines[HUD_NUM_LINES][128];
+    snprintf(lines[0], sizeof(lines[0]), "CPU %5.2f ms (max %5.2f)   GPU %5.2f ms (max %5.2f)", frame.cpu_ms, cpuMax, gpuLast, gpuMax);
+    snprintf(lines[1], sizeof(lines[1]), "Simulacao %5.2f ms (setores %4.2f, colisoes %4.2f)", frame.simulation_ms, frame.streaming_ms, frame.collisions_ms);
+    snprintf(lines[2], sizeof(lines[2]), "Descricao %5.2f ms  Desenho %5.2f ms  Latencia %5.1f ms", frame.build_ms, frame.render_ms, frame.latency_ms);
+    snprintf(lines[3], sizeof(lines[3]), "Draw calls %u   Triangulos %llu   Trocas de estado %u", frame.draw_calls, (unsigned long long)frame.triangles, frame.state_changes);
+    snprintf(lines[4], sizeof(lines[4]), "Objetos visiveis %u   descartados %u", frame.visible_objects, frame.culled_objects);
+    snprintf(lines[5], sizeof(lines[5]), "Alocacoes %u   Texturas %.1f MB   Buffers %.1f MB", frame.heap_allocations, Megabytes(frame.texture_bytes), Megabytes(frame.buffer_bytes));
+    snprintf(lines[6], sizeof(lines[6]), "Resolucao %d%% %dx%d  LOD %d  Efeitos %d  Mudancas %u", (int)(frame.resolution_scale * 100.0f + 0.5f),
+             frame.scene_width, frame.scene_height, frame.lod_bias, frame.effects, frame.quality_changes);
+
+    float lineHeight = TextRendering_FontHeight();
+    float graphWidth = HUD_HISTORY * HUD_BAR_WIDTH;
+    float left = HUD_MARGIN;
+    float top = HUD_MARGIN;
+
+    // Os primeiros vértices ficam reservados para o fundo, cuja largura depende do texto.
+    hud->num_vertices = 6;
+
+    // Gráfico: do quadro mais antigo (à esquerda) ao mais recente, com linhas em 1/60 s e 1/30 s.
+    float graphLeft = left + HUD_MARGIN;
+    float graphBottom = top + HUD_MARGIN + HUD_GRAPH_HEIGHT;
+    for (int k = 1; k <= 2; ++k)
+    {
+        float y = graphBottom - HUD_GRAPH_HEIGHT * k / 2.0f;
+        AddRect(hud, graphLeft, y, graphLeft + graphWidth, y + 1.0f, HUD_GRID, width, height);
+    }
+    for (int i = 0; i < HUD_HISTORY; ++i)
+    {
+        float cpu = std::min(hud->cpu_ms[(hud->cpu_head + i) % HUD_HISTORY] / HUD_GRAPH_MS, 1.0f) * HUD_GRAPH_HEIGHT;
+        float gpu = std::min(hud->gpu_ms[(hud->gpu_head + i) % HUD_HISTORY] / HUD_GRAPH_MS, 1.0f) * HUD_GRAPH_HEIGHT;
+        float x = graphLeft + i * HUD_BAR_WIDTH;
+        if (cpu > 0.0f)
+            AddRect(hud, x, graphBottom - cpu, x + HUD_BAR_WIDTH / 2, graphBottom, HUD_CPU, width, height);
+        if (gpu > 0.0f)
+            AddRect(hud, x + HUD_BAR_WIDTH / 2, graphBottom - gpu, x + HUD_BAR_WIDTH, graphBottom, HUD_GPU, width, height);
+    }
+
+    // Texto, com a legenda das cores do gráfico antes da primeira linha.
+    float y = graphBottom + HUD_MARGIN + lineHeight;
+    float right = graphLeft + graphWidth;
+    AddRect(hud, graphLeft, y - 0.6f * lineHeight, graphLeft + 4.0f, y, HUD_CPU, width, height);
+    AddRect(hud, graphLeft + 4.0f, y - 0.6f * lineHeight, graphLeft + 8.0f, y, HUD_GPU, width, height);
+    for (int l = 0; l < HUD_NUM_LINES; ++l)
+    {
+        right = std::max(right, AddText(hud, lines[l], graphLeft + (l == 0 ? 12.0f : 0.0f), y, width, height));
+        y += lineHeight;
+    }
+
+    int numVertices = hud->num_vertices;
+    hud->num_vertices = 0;
+    AddRect(hud, left, top, right + HUD_MARGIN, y - lineHeight + HUD_MARGIN, HUD_BACKGROUND, width, height);
+    hud->num_vertices = numVertices;
+
+    // Um único envio de vértices e um único draw call para todo o painel.
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_CULL_FACE);
+    glDepthFunc(GL_ALWAYS);
+
+    glBindBuffer(GL_ARRAY_BUFFER, hud->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, hud->num_vertices * sizeof(HudVertex), hud->vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(hud->program);
+    glBindVertexArray(hud->vao);
+    glDrawArrays(GL_TRIANGLES, 0, hud->num_vertices);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+}
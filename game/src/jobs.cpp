@@ -0,0 +1,222 @@
+#include "jobs.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#include "profiler.h"
+
+// Fila da thread atual: cada thread criada por Jobs_Init() usa a sua; qualquer outra thread usa a fila 0.
+static thread_local int t_JobQueue = 0;
+
+// Operações do buffer circular de uma fila. Devem ser chamadas com o mutex da fila.
+static void PushBack(JobQueue& q, const Job& job)
+{
+    uint32_t capacity = (uint32_t)q.jobs.size();
+    if (q.count == capacity)
+    {
+        // Cheio: copiamos as tarefas em ordem para um buffer com o dobro do tamanho.
+        std::vector<Job> grown(std::max(64u, 2 * capacity));
+        for (uint32_t i = 0; i < q.count; ++i)
+            grown[i] = q.jobs[(q.first + i) % capacity];
+        q.jobs.swap(grown);
+        q.first = 0;
+        capacity = (uint32_t)q.jobs.size();
+    }
+    q.jobs[(q.first + q.count) % capacity] = job;
+    q.count += 1;
+}
+
+static Job PopFront(JobQueue& q)
+{
+    Job job = q.jobs[q.first];
+    q.first = (q.first + 1) % (uint32_t)q.jobs.size();
+    q.count -= 1;
+    return job;
+}
+
+static Job PopBack(JobQueue& q)
+{
+    q.count -= 1;
+    return q.jobs[(q.first + q.count) % (uint32_t)q.jobs.size()];
+}
+
+static void Enqueue(JobSystem* jobs, int queue, const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs->queues[queue].mutex);
+        PushBack(jobs->queues[queue], job);
+    }
+    jobs->queued.fetch_add(1);
+}
+
+// Acorda as threads que estão dormindo. O mutex garante que uma thread que acabou de
+// ver "queued" igual a zero já esteja esperando a notificação quando ela for enviada.
+static void WakeWorkers(JobSystem* jobs)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+    }
+    jobs->wakeup.notify_all();
+}
+
+// Retira uma tarefa do início da própria fila ou, se ela estiver vazia, do fim da fila de outra thread.
+static bool PopJob(JobSystem* jobs, int queue, Job* job)
+{
+    if (jobs->queued.load() == 0)
+        return false;
+
+    for (int k = 0; k < jobs->num_threads; ++k)
+    {
+        JobQueue& q = jobs->queues[(queue + k) % jobs->num_threads];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.count == 0)
+            continue;
+        *job = (k == 0) ? PopFront(q) : PopBack(q);
+        jobs->queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+static void Execute(JobSystem* jobs, const Job& job)
+{
+    {
+        MEMTRACK_SCOPE(job.tag);
+        job.function(job.data, job.begin, job.end);
+    }
+
+    JobCounter* counter = job.counter;
+    if (counter == NULL)
+        return;
+
+    // As tarefas dependentes são copiadas da lista antes do decremento: depois
+    // dele, o contador pode deixar de existir a qualquer momento (Jobs_Wait retorna).
+    // As duas listas mantêm sua capacidade, para não alocar memória a cada quadro.
+    static thread_local std::vector<Job> released;
+    released.clear();
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        if (counter->pending.load() == 1)
+        {
+            released.assign(counter->waiting.begin(), counter->waiting.end());
+            counter->waiting.clear();
+        }
+        counter->pending.fetch_sub(1);
+    }
+    if (!released.empty())
+    {
+        for (size_t i = 0; i < released.size(); ++i)
+            Enqueue(jobs, t_JobQueue, released[i]);
+        WakeWorkers(jobs);
+    }
+}
+
+static void WorkerThread(JobSystem* jobs, int queue)
+{
+    t_JobQueue = queue;
+
+    char name[32];
+    snprintf(name, sizeof(name), "Tarefas %d", queue);
+    PROFILE_THREAD_NAME(name);
+
+    Job job;
+    for (;;)
+    {
+        if (PopJob(jobs, queue, &job))
+        {
+            Execute(jobs, job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(jobs->mutex);
+        jobs->wakeup.wait(lock, [&] { return jobs->quit || jobs->queued.load() > 0; });
+        if (jobs->quit)
+            return;
+    }
+}
+
+// Coloca a tarefa na fila indicada ou, se ela depender de um contador ainda não zerado, na lista de espera dele.
+static bool SubmitOrDefer(JobSystem* jobs, int queue, const Job& job, JobCounter* dependency)
+{
+    if (dependency != NULL)
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        if (dependency->pending.load() > 0)
+        {
+            dependency->waiting.push_back(job);
+            return false;
+        }
+    }
+    Enqueue(jobs, queue, job);
+    return true;
+}
+
+void Jobs_Init(JobSystem* jobs, int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    jobs->num_threads = std::min(num_threads, JOBS_MAX_THREADS);
+    jobs->queued.store(0);
+    jobs->quit = false;
+    for (int i = 1; i < jobs->num_threads; ++i)
+        jobs->workers.push_back(std::thread(WorkerThread, jobs, i));
+}
+
+void Jobs_Submit(JobSystem* jobs, JobFunction function, void* data, uint32_t begin, uint32_t end, JobCounter* counter, JobCounter* dependency)
+{
+    Job job = { function, data, begin, end, counter, MemTrack_Tag() };
+    if (counter != NULL)
+        counter->pending.fetch_add(1);
+    if (SubmitOrDefer(jobs, t_JobQueue, job, dependency))
+        WakeWorkers(jobs);
+}
+
+void Jobs_ParallelFor(JobSystem* jobs, uint32_t count, uint32_t grain, JobFunction function, void* data, JobCounter* counter, JobCounter* dependency)
+{
+    grain = std::max(1u, grain);
+    uint32_t num_jobs = (count + grain - 1) / grain;
+    if (num_jobs == 0)
+        return;
+    if (counter != NULL)
+        counter->pending.fetch_add(num_jobs);
+
+    // A fila q recebe as tarefas [num_jobs * q / n, num_jobs * (q + 1) / n).
+    bool queued = false;
+    int n = jobs->num_threads;
+    for (int q = 0; q < n; ++q)
+    {
+        uint32_t first = (uint32_t)((uint64_t)num_jobs * q / n);
+        uint32_t last = (uint32_t)((uint64_t)num_jobs * (q + 1) / n);
+        for (uint32_t i = first; i < last; ++i)
+        {
+            Job job = { function, data, i * grain, std::min(count, (i + 1) * grain), counter, MemTrack_Tag() };
+            queued = SubmitOrDefer(jobs, q, job, dependency) || queued;
+        }
+    }
+    if (queued)
+        WakeWorkers(jobs);
+}
+
+void Jobs_Wait(JobSystem* jobs, JobCounter* counter)
+{
+    Job job;
+    while (counter->pending.load() > 0)
+    {
+        if (PopJob(jobs, t_JobQueue, &job))
+            Execute(jobs, job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void Jobs_Shutdown(JobSystem* jobs)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        jobs->quit = true;
+    }
+    jobs->wakeup.notify_all();
+    for (size_t i = 0; i < jobs->workers.size(); ++i)
+        jobs->workers[i].join();
+    jobs->workers.clear();
+}
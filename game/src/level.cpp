@@ -0,0 +1,365 @@
+#include "level.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// Lê um número no formato "a" ou "a/b" a partir de *s, avançando o ponteiro.
+static bool ParseNumber(const char** s, float* value)
+{
+    char* end;
+    float a = strtof(*s, &end);
+    if (end == *s)
+        return false;
+
+    if (*end == '/')
+    {
+        const char* denominator = end + 1;
+        float b = strtof(denominator, &end);
+        if (end == denominator || b == 0.0f)
+            return false;
+        a /= b;
+    }
+
+    *value = a;
+    *s = end;
+    return true;
+}
+
+// Lê exatamente "count" números de uma linha; sobrar texto é um erro.
+static bool ParseValues(const char* s, float* values, int count)
+{
+    for (int i = 0; i < count; ++i)
+        if (!ParseNumber(&s, &values[i]))
+            return false;
+
+    while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+        ++s;
+
+    return *s == '\0' || *s == '#';
+}
+
+bool Level_CompileText(const char* text_filename, const char* binary_filename)
+{
+    FILE* in = fopen(text_filename, "r");
+    if (in == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open level file \"%s\".\n", text_filename);
+        return false;
+    }
+
+    std::vector<LevelAsteroid>    asteroids;
+    std::vector<LevelGroupMember> group;
+    std::vector<LevelCoin>        coins;
+
+    // Valores lidos das linhas "group" e "sector".
+    LevelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.sector_length = LEVEL_SECTOR_LENGTH;
+
+    bool ok = true;
+    char line[512];
+    int line_number = 0;
+    while (ok && fgets(line, sizeof(line), in))
+    {
+        line_number += 1;
+
+        char kind[16];
+        int consumed = 0;
+        if (sscanf(line, " %15s%n", kind, &consumed) != 1 || kind[0] == '#')
+            continue;
+
+        const char* args = line + consumed;
+        float v[5];
+
+        if (strcmp(kind, "asteroid") == 0 && ParseValues(args, v, 5))
+        {
+            LevelAsteroid a = { v[0], v[1], v[2], v[3], v[4] };
+            asteroids.push_back(a);
+        }
+        else if (strcmp(kind, "member") == 0 && ParseValues(args, v, 4))
+        {
+            LevelGroupMember m = { v[0], v[1], v[2], v[3] };
+            group.push_back(m);
+        }
+        else if (strcmp(kind, "coin") == 0 && ParseValues(args, v, 4))
+        {
+            LevelCoin c = { v[0], v[1], v[2], v[3] };
+            coins.push_back(c);
+        }
+        else if (strcmp(kind, "group") == 0 && ParseValues(args, v, 4))
+        {
+            header.group_origin[0] = v[0];
+            header.group_origin[1] = v[1];
+            header.group_origin[2] = v[2];
+            header.group_speed     = v[3];
+        }
+        else if (strcmp(kind, "sector") == 0 && ParseValues(args, v, 1) && v[0] > 0.0f)
+        {
+            header.sector_length = v[0];
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Invalid line %d in level file \"%s\".\n", line_number, text_filename);
+            ok = false;
+        }
+    }
+    fclose(in);
+
+    if (!ok)
+        return false;
+
+    uint32_t num_sectors = 0;
+    if (!Level_WriteBinary(binary_filename, asteroids, group, coins, header.group_origin, header.group_speed, header.sector_length, &num_sectors))
+        return false;
+
+    printf("Nível \"%s\" compilado: %u asteroides em %u setores, %u no grupo, %u moedas.\n",
+           text_filename, (unsigned)asteroids.size(), num_sectors, (unsigned)group.size(), (unsigned)coins.size());
+    return true;
+}
+
+bool Level_WriteBinary(const char* binary_filename, std::vector<LevelAsteroid>& asteroids, const std::vector<LevelGroupMember>& group,
+                       const std::vector<LevelCoin>& coins, const float group_origin[3], float group_speed, float sector_length,
+                       uint32_t* num_sectors)
+{
+    LevelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_FILE_MAGIC, 4);
+    header.version = LEVEL_FILE_VERSION;
+    header.sector_length = sector_length;
+    header.group_origin[0] = group_origin[0];
+    header.group_origin[1] = group_origin[1];
+    header.group_origin[2] = group_origin[2];
+    header.group_speed = group_speed;
+
+    // Ordenamos os asteroides por setor, na ordem em que a nave os encontra (Z decrescente),
+    // mantendo a ordem original dentro de cada setor.
+    std::vector<int32_t> cells(asteroids.size());
+    std::vector<uint32_t> order(asteroids.size());
+    for (size_t i = 0; i < asteroids.size(); ++i)
+    {
+        cells[i] = (int32_t)floorf(asteroids[i].z / header.sector_length);
+        order[i] = (uint32_t)i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&cells](uint32_t a, uint32_t b) { return cells[a] > cells[b]; });
+
+    std::vector<LevelAsteroid> sorted(asteroids.size());
+    std::vector<LevelSector> sectors;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        sorted[i] = asteroids[order[i]];
+        int32_t cell = cells[order[i]];
+        if (sectors.empty() || sectors.back().cell != cell)
+        {
+            LevelSector sector = { cell, (uint32_t)i, 0 };
+            sectors.push_back(sector);
+        }
+        sectors.back().num_asteroids += 1;
+    }
+    asteroids.swap(sorted);
+
+    header.num_asteroids     = (uint32_t)asteroids.size();
+    header.num_group_members = (uint32_t)group.size();
+    header.num_coins         = (uint32_t)coins.size();
+    header.asteroids_offset  = sizeof(LevelFileHeader);
+    header.group_offset      = header.asteroids_offset + asteroids.size() * sizeof(LevelAsteroid);
+    header.coins_offset      = header.group_offset + group.size() * sizeof(LevelGroupMember);
+    header.num_sectors       = (uint32_t)sectors.size();
+    header.sectors_offset    = header.coins_offset + coins.size() * sizeof(LevelCoin);
+
+    FILE* out = fopen(binary_filename, "wb");
+    if (out == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write level file \"%s\".\n", binary_filename);
+        return false;
+    }
+
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(asteroids.data(), sizeof(LevelAsteroid), asteroids.size(), out);
+    fwrite(group.data(), sizeof(LevelGroupMember), group.size(), out);
+    fwrite(coins.data(), sizeof(LevelCoin), coins.size(), out);
+    fwrite(sectors.data(), sizeof(LevelSector), sectors.size(), out);
+    bool ok = !ferror(out);
+    fclose(out);
+
+    if (num_sectors != NULL)
+        *num_sectors = header.num_sectors;
+    return ok;
+}
+
+// Mapeia um arquivo inteiro em memória, somente leitura.
+static void* MapFile(const char* filename, size_t* size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (size_t)file_size.QuadPart;
+    return data;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+static void UnmapFile(void* data, size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// Verifica se o vetor [offset, offset + count*record_size) cabe no arquivo.
+static bool RangeFits(uint64_t offset, uint64_t count, uint64_t record_size, size_t file_size)
+{
+    return offset <= file_size && count <= (file_size - offset) / record_size;
+}
+
+bool Level_Load(const char* binary_filename, Level* level)
+{
+    memset(level, 0, sizeof(Level));
+
+    size_t size = 0;
+    void* data = MapFile(binary_filename, &size);
+    if (data == NULL)
+        return false;
+
+    const LevelFileHeader* header = (const LevelFileHeader*)data;
+    if (size < sizeof(LevelFileHeader)
+        || memcmp(header->magic, LEVEL_FILE_MAGIC, 4) != 0
+        || header->version != LEVEL_FILE_VERSION
+        || !RangeFits(header->asteroids_offset, header->num_asteroids, sizeof(LevelAsteroid), size)
+        || !RangeFits(header->group_offset, header->num_group_members, sizeof(LevelGroupMember), size)
+        || !RangeFits(header->coins_offset, header->num_coins, sizeof(LevelCoin), size)
+        || !RangeFits(header->sectors_offset, header->num_sectors, sizeof(LevelSector), size)
+        || !(header->sector_length > 0.0f))
+    {
+        fprintf(stderr, "ERROR: Invalid level file \"%s\".\n", binary_filename);
+        UnmapFile(data, size);
+        return false;
+    }
+
+    // Cada setor deve apontar para asteroides dentro do vetor, e os setores devem estar em ordem decrescente de
+    // "cell", como o carregamento por setores espera. Um binário corrompido seria lido fora do mapeamento.
+    const LevelSector* sectors = (const LevelSector*)((const char*)data + header->sectors_offset);
+    for (uint32_t i = 0; i < header->num_sectors; ++i)
+    {
+        if ((uint64_t)sectors[i].first_asteroid + sectors[i].num_asteroids > header->num_asteroids
+            || (i > 0 && sectors[i].cell >= sectors[i - 1].cell))
+        {
+            fprintf(stderr, "ERROR: Invalid sector table in level file \"%s\".\n", binary_filename);
+            UnmapFile(data, size);
+            return false;
+        }
+    }
+
+    const char* base = (const char*)data;
+    level->asteroids         = (const LevelAsteroid*)(base + header->asteroids_offset);
+    level->num_asteroids     = header->num_asteroids;
+    level->group             = (const LevelGroupMember*)(base + header->group_offset);
+    level->num_group_members = header->num_group_members;
+    level->coins             = (const LevelCoin*)(base + header->coins_offset);
+    level->num_coins         = header->num_coins;
+    level->sectors           = (const LevelSector*)(base + header->sectors_offset);
+    level->num_sectors       = header->num_sectors;
+    level->sector_length     = header->sector_length;
+    level->group_origin[0]   = header->group_origin[0];
+    level->group_origin[1]   = header->group_origin[1];
+    level->group_origin[2]   = header->group_origin[2];
+    level->group_speed       = header->group_speed;
+    level->mapping           = data;
+    level->mapping_size      = size;
+    return true;
+}
+
+bool Level_LoadOrCompile(const char* text_filename, const char* binary_filename, Level* level)
+{
+    struct stat text_stat;
+    struct stat binary_stat;
+    bool has_text   = stat(text_filename, &text_stat) == 0;
+    bool has_binary = stat(binary_filename, &binary_stat) == 0;
+
+    bool stale = has_text && (!has_binary || text_stat.st_mtime > binary_stat.st_mtime);
+    if (!stale && Level_Load(binary_filename, level))
+        return true;
+
+    // O binário não existe, está desatualizado ou foi gerado por uma versão anterior do formato.
+    if (!has_text || !Level_CompileText(text_filename, binary_filename))
+        return false;
+
+    return Level_Load(binary_filename, level);
+}
+
+std::string Level_BinaryFilename(const std::string& text_filename)
+{
+    // Um '.' antes da última barra faz parte do nome de uma pasta (por exemplo, "../levels/fase1").
+    size_t dot = text_filename.find_last_of('.');
+    size_t slash = text_filename.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return text_filename + ".lvl";
+    return text_filename.substr(0, dot) + ".lvl";
+}
+
+void Level_Unload(Level* level)
+{
+    if (level->mapping != NULL)
+        UnmapFile(level->mapping, level->mapping_size);
+
+    memset(level, 0, sizeof(Level));
+}
+
+void Level_ReleaseAsteroids(const Level* level, uint32_t first, uint32_t count)
+{
+#ifndef _WIN32
+    // madvise() exige endereços alinhados à página; liberamos apenas as páginas
+    // inteiramente contidas no intervalo, para não afetar setores vizinhos.
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)(level->asteroids + first);
+    uintptr_t end   = (uintptr_t)(level->asteroids + first + count);
+    begin = (begin + page - 1) & ~(page - 1);
+    end   = end & ~(page - 1);
+    if (begin < end)
+        madvise((void*)begin, end - begin, MADV_DONTNEED);
+#endif
+}
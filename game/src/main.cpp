@@ -1,6 +1,7 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////// INCLUINDO BIBLIOTECAS ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <cctype>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -8,7 +9,6 @@
 
 // Headers específicos de C++
 #include <map>
-#include <stack>
 #include <string>
 #include <vector>
 #include <limits>
@@ -16,6 +16,10 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <unordered_set>
+#include <chrono>
+#include <thread>
+#include <functional>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -25,6 +29,7 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 // Headers da biblioteca para carregar modelos obj
 #include <tiny_obj_loader.h>
@@ -33,6 +38,28 @@
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "collisions.h"
+#include "level.h"
+#include "streaming.h"
+#include "replay.h"
+#include "simulation.h"
+#include "benchmark.h"
+#include "stress.h"
+#include "offscreen.h"
+#include "softrender.h"
+#include "jobs.h"
+#include "renderthread.h"
+#include "scenegraph.h"
+#include "arena.h"
+#include "memtrack.h"
+#include "profiler.h"
+#include "gputimer.h"
+#include "hud.h"
+#include "hitch.h"
+#include "governor.h"
+#include "scenetarget.h"
+#include "framepacer.h"
+#include "shadercache.h"
+#include "gldebug.h"
 
 using namespace std;
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -47,7 +74,9 @@ struct ObjModel
     // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
     ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
     {
-        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
+        // Os modelos são carregados em paralelo (veja LoadObjModels()): as mensagens de cada
+        // modelo são impressas de uma só vez, para não se misturarem com as dos outros.
+        std::string log = std::string("Carregando objetos do arquivo \"") + filename + "\"...\n";
 
         // Se basepath == NULL, então setamos basepath como o dirname do filename, para que os arquivos MTL sejam corretamente carregados caso estejam no mesmo diretório dos arquivos OBJ.
         std::string fullpath(filename);
@@ -84,9 +113,9 @@ struct ObjModel
                     filename);
                 throw std::runtime_error("Objeto sem nome.");
             }
-            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
+            log += "- Objeto '" + shapes[shape].name + "'\n";
         }
-        printf("OK.\n");
+        printf("%sOK.\n", log.c_str());
     }
 };
 
@@ -100,6 +129,117 @@ struct SceneObject
     GLuint       vertex_array_object_id;    // ID do VAO onde estão armazenados os atributos do modelo
     glm::vec3    bbox_min;                  // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
+    uint32_t     soft_mesh;                 // Malha no rasterizador por software (veja "include/softrender.h")
+};
+
+// Imagem de textura lida do disco, ainda não enviada para a GPU. Veja DecodeTextureImages() e LoadTextureImage().
+struct TextureImage
+{
+    const char*    filename;
+    unsigned char* data;     // RGB, linhas de baixo para cima
+    int            width, height;
+};
+
+// Arquivos carregados em paralelo na inicialização do jogo.
+struct AssetLoading
+{
+    std::vector<TextureImage> textures;
+    std::vector<const char*>  model_filenames;
+    std::vector<ObjModel*>    models;
+};
+
+// Matrizes de modelagem dos asteroides visíveis de um setor.
+struct VisibleAsteroids
+{
+    const glm::mat4** models;
+    uint32_t          count;
+};
+
+// Entrada e saída das tarefas de visibilidade dos asteroides. Os arrays de saída ficam na arena do quadro.
+struct AsteroidCulling
+{
+    const std::vector<StreamedSector*>* sectors;
+    const Level*                        level;
+    const GameState*                    state;
+    const SceneGraph*                   graph;
+    int32_t                             first_member;   // Nó do primeiro membro do grupo em "graph"
+    Frustum                             frustum;
+    float                               model_radius;   // Raio da esfera envolvente do modelo "asteroid", sem escala
+    glm::vec3                           camera_position;
+    float                               focal_pixels;   // Distância focal em pixels: raio projetado de uma esfera de raio 1 a distância 1
+    float                               min_pixels;     // Raio projetado abaixo do qual um asteroide não é desenhado (LOD bias)
+    VisibleAsteroids*                   sector_visible; // Asteroides visíveis de cada setor ativo
+    uint32_t                            num_sectors;
+    uint8_t*                            group_visible;  // Membros do grupo visíveis
+};
+
+// Nós do grafo de cena com os objetos do nível (veja "include/scenegraph.h"): as moedas e o grupo de asteroides são
+// raízes e os membros do grupo são filhos dele. Apenas a matriz local do grupo muda durante a partida.
+struct LevelSceneNodes
+{
+    int32_t group;
+    int32_t first_member;
+    int32_t first_coin;
+};
+
+// Desenho registrado por DrawVirtualObject(): o objeto e os valores dos "uniforms" e estados no momento da chamada.
+struct DrawCommand
+{
+    const SceneObject* object;
+    glm::mat4          model, view, projection;
+    int                object_id;
+    bool               culling_and_depth_test;
+    bool               scene_camera;  // "view" é a câmera da cena, substituída por LatchCameraView()
+    GpuPass            gpu_pass;  // Passo medido pelo GpuTimer
+};
+
+// Descrição completa de um quadro, preenchida pelo laço principal sem chamar o OpenGL e desenhada por
+// RenderFramePacket(), na própria thread principal ou na thread de renderização (veja "include/renderthread.h").
+struct FramePacket
+{
+    Arena                    arena;              // Memória temporária do quadro, liberada quando o pacote volta a ser preenchido
+    int                      frame;              // Número do quadro, usado nos nomes das imagens de --dump-frames
+    int                      framebuffer_width;  // Tamanho do framebuffer quando o quadro foi descrito
+    int                      framebuffer_height;
+    float                    resolution_scale;   // Escala da resolução da cena (veja "include/governor.h")
+    bool                     draw_sky;           // Sem a esfera do céu, o fundo é preto
+    ArenaVector<DrawCommand> draws;
+    bool                     show_start_game;    // Texto "Press ENTER to Start"
+    bool                     show_hud;           // Painel de desempenho, com os números em "hud" (veja "include/hud.h")
+    HudFrame                 hud;
+
+    // Com "latch_camera", a câmera da cena é recalculada com a entrada lida logo antes de o pacote ser entregue
+    // (veja LatchCameraView()). "input_time" é o instante (GetTime()) da leitura da entrada usada pelo quadro, a
+    // partir do qual medimos a latência até a troca de buffers.
+    glm::vec4                camera_position;
+    bool                     latch_camera;
+    double                   input_time;
+
+    // Preenchidos por RenderFramePacket() e lidos pela thread principal quando o pacote volta a ser preenchido.
+    bool                     rendered;
+    RenderCounters           counters;
+
+    // Benchmark (NULL fora dele): quadro medido, instante do seu início, trabalho da CPU na thread principal e,
+    // dentro dele, o tempo gasto descrevendo a cena.
+    Benchmark*               benchmark;
+    int                      benchmark_frame;
+    double                   frame_start;
+    double                   cpu_ms;
+    double                   build_ms;
+};
+
+// Transformações usadas para desenhar um quadro. São capturadas ao fim de cada passo da simulação e interpoladas
+// entre os dois últimos passos, de forma que a taxa de quadros não depende da taxa de simulação.
+struct FrameTransforms
+{
+    glm::vec3 camera_position;
+    glm::quat camera_orientation;
+    glm::quat ship_roll;
+    bool      rocket_active;
+    glm::vec3 rocket_position;
+    bool      meteor_active;
+    glm::vec3 meteor_position;
+    float     group_offset;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -108,12 +248,27 @@ struct SceneObject
 void BuildTrianglesAndAddToVirtualScene(ObjModel*);                            // Constrói representação de um ObjModel como malha de triângulos para renderização
 void ComputeNormals(ObjModel* model);                                          // Computa normais de um ObjModel, caso não existam.
 void LoadShadersFromFiles();                                                   // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename);                                   // Função que carrega imagens de textura
+void LoadShaderUniforms(GLuint program_id, void* data);                        // Busca as variáveis dos shaders, com o programa pronto
+void LoadTextureImage(const TextureImage& image);                              // Função que envia imagens de textura para a GPU
+void DecodeTextureImages(void* data, uint32_t begin, uint32_t end);            // Tarefas que leem as imagens de textura do disco
+void LoadObjModels(void* data, uint32_t begin, uint32_t end);                  // Tarefas que carregam modelos OBJ e computam suas normais
+void CullSectorAsteroids(void* data, uint32_t begin, uint32_t end);            // Tarefas de visibilidade dos asteroides (veja AsteroidCulling)
+void CullGroupAsteroids(void* data, uint32_t begin, uint32_t end);
 void DrawVirtualObject(const char* object_name);                               // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char* filename);                                // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename);                              // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id);                       // Função utilizada pelas duas acima
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id);   // Cria um programa de GPU
+void DrawVirtualObject(const SceneObject& object);                             // Idem, sem procurar o objeto pelo nome
+void SetModelMatrix(const glm::mat4& model);                                   // Valores dos "uniforms" dos próximos desenhos, enviados aos
+void SetViewMatrix(const glm::mat4& view, bool scene_camera = false);          // shaders ou guardados para o rasterizador por software
+void SetProjectionMatrix(const glm::mat4& projection);
+void SetObjectId(int object_id);
+void SetCullingAndDepthTest(bool enabled);
+void SetGpuPass(GpuPass pass);
+void ExecuteDrawCommand(const DrawCommand& command);                           // Desenha um objeto registrado por DrawVirtualObject()
+void LatchCameraView(FramePacket& packet, const glm::vec3& front);              // Troca a câmera de um quadro já descrito
+void RenderFramePacket(FramePacket& packet, GLFWwindow* window, Offscreen* offscreen);        // Desenha um quadro
+void RunOnRenderThread(const std::function<void()>& function);                 // Executa código OpenGL na thread dona do contexto
+void StoreGpuTimes(const GpuTimerResult& result, void* benchmark);             // Guarda os tempos de GPU dos passos de um quadro
+void BuildLevelSceneGraph(const Level& level);                                  // Cria os nós do grafo de cena dos objetos do nível
+std::string LoadShaderSource(const char* filename);                            // Lê o código de um shader de um arquivo GLSL
 void PrintObjModelInfo(ObjModel*);                                             // Função para debugging
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
@@ -132,6 +287,11 @@ void TextRendering_PrintMatrixVectorProductDivW(GLFWwindow* window, glm::mat4 M,
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
 void TextRendering_ShowStartGame(GLFWwindow* window);
 
+// Transformações de desenho obtidas da simulação do jogo (veja "include/simulation.h").
+FrameTransforms CaptureFrameTransforms(const GameState& state);
+FrameTransforms InterpolateFrameTransforms(const FrameTransforms& a, const FrameTransforms& b, float alpha);
+void LoadStressLevel(const Level& base, uint32_t num_asteroids, Level* level, double* seconds);  // Gera e carrega o nível de uma rodada do modo stress
+
 // Funções callback para comunicação com o sistema operacional e interação do usuário.
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void ErrorCallback(int error, const char* description);
@@ -141,8 +301,10 @@ void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
 //funcoes auxiliares
-void PushMatrix(glm::mat4 M);
-void PopMatrix(glm::mat4& M);
+void ParseCommandLine(int argc, char* argv[]);                                 // Interpreta os argumentos passados ao programa
+double GetTime();                                                              // Segundos desde o início do programa
+bool WindowShouldClose(GLFWwindow* window);                                    // Sem janela (--offscreen), window é NULL
+void CloseWindow(GLFWwindow* window);
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////// DEFINIÇÃO DE VARIÁVEIS GLOBAIS //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -152,19 +314,10 @@ void PopMatrix(glm::mat4& M);
 // Veja na função main() como estes são acessados.
 std::map<std::string, SceneObject> g_VirtualScene;
 
-// Pilha que guardará as matrizes de modelagem.
-std::stack<glm::mat4>  g_MatrixStack;
-
-// Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
+// Razão de proporção da janela (largura/altura) e tamanho do framebuffer. Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
-
-// "g_LeftMouseButtonPressed = true" se o usuário está com o botão esquerdo do mouse pressionado no momento atual. Veja função MouseButtonCallback().
-bool g_LeftMouseButtonPressed = false;
-bool g_RightMouseButtonPressed = false;  // Análogo para botão direito do mouse
-bool g_MiddleMouseButtonPressed = false; // Análogo para botão do meio do mouse
-
-// Armazenam a última posição do cursor do mouse, para que possamos calcular quanto que o mouse se movimentou entre dois instantes de tempo. Utilizadas no callback CursorPosCallback() abaixo.
-double g_LastCursorPosX, g_LastCursorPosY;
+int g_FramebufferWidth = 800;
+int g_FramebufferHeight = 600;
 
 // Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
 GLuint g_GpuProgramID = 0;
@@ -178,96 +331,268 @@ GLint g_bbox_max_uniform;
 // Número de texturas carregadas pela função LoadTextureImage()
 GLuint g_NumLoadedTextures = 0;
 
-// Variável que controla se o texto informativo será mostrado na tela.
+// Memória enviada à GPU por LoadTextureImage() e BuildTrianglesAndAddToVirtualScene(), mostrada no painel de desempenho.
+uint64_t g_TextureBytes = 0;
+uint64_t g_BufferBytes = 0;
+
+// Variável que controla se o texto informativo será mostrado na tela. Com g_ShowHud, ele é substituído pelo
+// painel de desempenho (tecla H ou opção --hud).
 bool g_ShowInfoText = true;
+bool g_ShowHud = false;
+
+// Entrada do jogador, preenchida por Simulation_ApplyInputEvent() a partir dos eventos recebidos pelos callbacks.
+GameInput g_Input = {};
+
+// Eventos de entrada recebidos pelos callbacks e ainda não entregues à simulação.
+std::vector<InputEvent> g_PendingInput;
+
+// Gravação e reprodução de partidas (veja "include/replay.h") e arquivo de checksums do estado a cada passo.
+std::string g_RecordFilename;
+std::string g_ReplayFilename;
+std::string g_ChecksumFilename;
+bool g_Replaying = false;
+InputLog g_InputLog;
+
+// Modo benchmark: percorre o nível em um número fixo de quadros e imprime os tempos medidos. Veja "include/benchmark.h".
+bool g_Benchmark = false;
+int g_BenchmarkFrames = 2000;
+
+// Modo stress: repete o benchmark com níveis gerados a partir do nível escolhido, dobrando o número de
+// asteroides a cada rodada até g_StressMaxAsteroids (0 = desligado). Veja "include/stress.h".
+uint32_t g_StressMaxAsteroids = 0;
+uint32_t g_StressFirstAsteroids = 1000;
+int g_StressFrames = 300;
+std::string g_StressLevelFilename = "../../data/levels/stress.lvl";
+
+// Com g_AllocAssert, uma alocação com "operator new" no laço principal depois dos primeiros quadros
+// (BENCHMARK_WARMUP_FRAMES) aborta o programa, mostrando a pilha de chamadas. Veja "include/memtrack.h".
+bool g_AllocAssert = false;
+
+// Trace dos marcadores de tempo da CPU dos últimos g_TraceFrames quadros, gravado em g_TraceFilename ao apertar
+// a tecla P e, com a opção --profile-trace, no fim da execução. Veja "include/profiler.h".
+std::string g_TraceFilename = "trace.json";
+uint32_t g_TraceFrames = 120;
+bool g_TraceAtExit = false;
+bool g_TraceRequested = false;
+
+// Gravador de quadros lentos: um quadro acima de g_HitchBudgetMs grava o trace e o resumo dos quadros em volta dele
+// em g_HitchDirectory. Veja "include/hitch.h".
+HitchRecorder g_HitchRecorder;
+double g_HitchBudgetMs = 100.0;
+std::string g_HitchDirectory = ".";
+
+// Controle da qualidade do desenho (opção --target-frame-ms): escala da resolução da cena, LOD bias e efeitos.
+// Sem alvo, a cena usa a escala fixa g_ResolutionScale. Veja "include/governor.h" e "include/scenetarget.h".
+FrameGovernor g_Governor;
+double g_TargetFrameMs = 0.0;
+float g_ResolutionScale = 1.0f;
+SceneTarget g_SceneTarget;
+
+// Renderização sem janela: os quadros são desenhados em um framebuffer de g_OffscreenWidth x g_OffscreenHeight
+// pixels (0 = com janela) e, se g_DumpFramesDirectory não for vazio, gravados nessa pasta a cada g_DumpEvery quadros.
+// Veja "include/offscreen.h".
+int g_OffscreenWidth = 0;
+int g_OffscreenHeight = 0;
+std::string g_DumpFramesDirectory;
+int g_DumpEvery = 1;
+bool g_OffscreenShouldClose = false;
+
+// Sistema de tarefas, com g_JobThreads threads (0 = uma por núcleo), usado pela simulação, pelo desenho, pelo
+// carregamento dos arquivos e pelo rasterizador por software. Veja "include/jobs.h". O JobSystem é uma variável
+// local de main(): uma variável global com threads ainda ativas abortaria o programa ao sair por std::exit().
+int g_JobThreads = 0;
+JobSystem* g_Jobs = NULL;
+
+// Asteroides visíveis do quadro atual. Mantido entre os quadros para reaproveitar a memória dos vetores.
+AsteroidCulling g_AsteroidCulling;
+
+// Grafo de cena dos objetos do nível. Veja BuildLevelSceneGraph().
+SceneGraph g_SceneGraph;
+LevelSceneNodes g_SceneNodes;
+
+// Rasterizador por software (opção --renderer software): a cena é desenhada na CPU pelas threads do sistema de
+// tarefas e a OpenGL apenas apresenta o quadro e desenha o texto. Veja "include/softrender.h".
+bool g_SoftwareRenderer = false;
+SoftRenderer g_SoftRenderer;
+
+// Valores atuais dos "uniforms" de shader_vertex.glsl e shader_fragment.glsl e dos estados GL_CULL_FACE e GL_DEPTH_TEST,
+// registrados em cada DrawCommand. Veja SetModelMatrix() e demais funções abaixo.
+glm::mat4 g_DrawModel, g_DrawView, g_DrawProjection;
+int g_DrawObjectId = 0;
+bool g_DrawCullingAndDepthTest = true;
+bool g_DrawSceneCamera = false;
+GpuPass g_DrawGpuPass = GPUPASS_SKY;
+
+// Tempos de GPU de cada passo do desenho, lidos alguns quadros depois e mostrados no trace do profiler, na trilha
+// g_GpuTrack, e no relatório do benchmark. Veja "include/gputimer.h".
+GpuTimer g_GpuTimer;
+ProfileThread* g_GpuTrack = NULL;
+
+// Painel de desempenho, desenhado e atualizado pela thread que desenha.
+Hud g_Hud;
+
+// Pacotes de quadro (buffer duplo) e o pacote sendo preenchido pelo laço principal. Sem a thread de renderização
+// usamos apenas o primeiro, desenhado logo após ser preenchido. Cada pacote tem a sua arena, de forma que a
+// memória de um quadro sendo desenhado não é reaproveitada enquanto o próximo é descrito.
+FramePacket g_FramePackets[2];
+FramePacket* g_FramePacket = &g_FramePackets[0];
+
+// Thread de renderização (opção --render-thread), com até g_FrameLatency quadros de simulação à frente do desenho.
+bool g_UseRenderThread = false;
+int g_FrameLatency = 1;
+RenderThread g_RenderThread;
+
+// Semente do gerador de números aleatórios da simulação, que sorteia os meteoros. Ao reproduzir uma gravação, é usada a semente gravada.
+uint32_t g_RandomSeed = 1;
+
+// "Late latching" da câmera livre (opção --late-latch): a sua orientação é lida de novo, com a posição atual do cursor,
+// logo antes de o quadro ser entregue para desenho. g_InputLatencyMs é a latência da entrada do último quadro
+// desenhado, medida pela thread que desenha e mostrada no painel de desempenho. Veja LatchCameraView().
+bool g_LateLatch = true;
+double g_InputLatencyMs = 0.0;
+
+// Passos de simulação por segundo e limite de quadros por segundo (0 = sem limite). Veja ParseCommandLine().
+int g_SimulationRate = 60;
+int g_MaxFramesPerSecond = 0;
+
+// Ritmo dos quadros: sincronização vertical, limite de quadros e espera por eventos na tela de início, sem foco
+// ou com a janela minimizada. Veja "include/framepacer.h".
+VsyncMode g_Vsync = VSYNC_ON;
+FramePacer g_FramePacer;
+
+// Relatório de erros do OpenGL pelo driver (opção --gl-debug), com a gravidade mínima das mensagens impressas.
+// Veja "include/gldebug.h".
+GlDebugLevel g_GlDebugLevel = GLDEBUG_OFF;
+
+// Pasta do cache dos programas de GPU (opções --shader-cache e --no-shader-cache), relativa à pasta atual.
+bool g_ShaderCacheEnabled = true;
+std::string g_ShaderCacheDirectory = "shadercache";
+
+// Maior intervalo de tempo real consumido pela simulação em um único quadro. Evita que, após uma pausa longa
+// (por exemplo, a janela sendo arrastada), a simulação tente recuperar o atraso executando centenas de passos de uma vez.
+#define MAX_FRAME_TIME 0.25
+
+// Nível (mapa) do jogo, em formato texto e binário. Veja "include/level.h" e ParseCommandLine().
+std::string g_LevelTextFilename = "../../data/levels/default.txt";
+std::string g_LevelBinaryFilename = "../../data/levels/default.lvl";
+
+// Somente os setores do nível a menos desta distância (eixo Z) da nave são carregados, simulados e desenhados. Veja "include/streaming.h".
+float g_StreamRadius = 250.0f;
 
-bool g_IsFreeCamera = true;
-glm::vec3 g_FreeCameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-glm::vec3 g_FreeCameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
-glm::vec3 g_FreeCameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-float g_CameraSpeed = 0.5f;
-float g_left_right_movement = -90.0f;
-float g_up_down_movement = 0.0f;
-bool g_WKeyPressed = false;
-bool g_SKeyPressed = false;
-bool g_AKeyPressed = false;
-bool g_DKeyPressed = false;
-bool g_SpaceKeyPressed = false;
-bool g_StartGame = false;
-bool g_Reboot = false;
-float g_StartGameTime = 0;
-int g_nextCoin = 0;
-
-#define CAMERA_ACCELERATION 3.0f
-#define MAX_CAMERA_SPEED 20.0f
-#define BARREL_ROLL_SPEED 3.0f
-#define TARGET_ANGLE 6.28f
-
-float barrelRollAngle = 0.0f;
-bool isRolling = false;
-int barrelRollDirection = 1;
-
-#define NUM_ASTEROIDS 24
-#define NUM_COINS 12
-vector<bool> shouldRenderSphere(NUM_ASTEROIDS, true);
-vector<bool> shouldRenderCoin(NUM_COINS, true);
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////// IMPLEMENTAÇÃO DAS FUNÇÕES //////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char* argv[])
 {
-    // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do sistema operacional, onde poderemos renderizar com OpenGL.
-    int success = glfwInit();
-    if (!success)
-    {
-        fprintf(stderr, "ERROR: glfwInit() failed.\n");
+    std::chrono::steady_clock::time_point programStart = std::chrono::steady_clock::now();
+
+    ParseCommandLine(argc, argv);
+
+    // As matrizes dos asteroides são montadas em lotes com SSE; conferimos que elas coincidem com as da versão
+    // escalar antes de desenhar qualquer coisa (custa alguns microssegundos).
+    if (!Matrix_CheckBuildModels())
         std::exit(EXIT_FAILURE);
-    }
 
-    // Definimos o callback para impressão de erros da GLFW no terminal
-    glfwSetErrorCallback(ErrorCallback);
+    // Até o laço principal, todas as alocações são de carregamento.
+    MemTrack_SetTag(MEMTAG_LOADING);
+    PROFILE_THREAD_NAME("Principal");
 
-    // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Criamos as threads do sistema de tarefas.
+    JobSystem jobs;
+    Jobs_Init(&jobs, g_JobThreads);
+    g_Jobs = &jobs;
 
-    #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    #endif
+    // O modo stress é um benchmark executado em várias rodadas.
+    if (g_StressMaxAsteroids > 0)
+    {
+        g_Benchmark = true;
+        g_BenchmarkFrames = g_StressFrames;
+    }
 
-    // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as funções modernas de OpenGL.
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Sem janela não há teclado: ou reproduzimos uma partida gravada, ou percorremos o nível como no benchmark.
+    if (g_OffscreenWidth > 0 && g_ReplayFilename.empty())
+        g_Benchmark = true;
 
-    // Criamos uma janela do sistema operacional, com 800 colunas e 600 linhas de pixels, e com título "Spaceship Game".
-    GLFWwindow* window;
-    window = glfwCreateWindow(800, 600, "Spaceship Game", NULL, NULL);
-    if (!window)
+    // Ao reproduzir uma partida gravada, usamos a semente e a taxa de simulação da gravação.
+    if (!g_ReplayFilename.empty())
     {
-        glfwTerminate();
-        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
-        std::exit(EXIT_FAILURE);
+        if (!Replay_Load(g_ReplayFilename.c_str(), &g_InputLog))
+            std::exit(EXIT_FAILURE);
+        g_Replaying = true;
+        g_RandomSeed = g_InputLog.header.seed;
+        g_SimulationRate = g_InputLog.header.simulation_rate;
+        printf("Reproduzindo \"%s\": %u passos, %u eventos.\n", g_ReplayFilename.c_str(), g_InputLog.end_tick, (unsigned)g_InputLog.events.size());
     }
 
-    // Definimos a função de callback que será chamada sempre que o usuário pressionar alguma tecla do teclado ...
-    glfwSetKeyCallback(window, KeyCallback);
-    // ... ou clicar os botões do mouse ...
-    glfwSetMouseButtonCallback(window, MouseButtonCallback);
-    // ... ou movimentar o cursor do mouse em cima da janela ...
-    glfwSetCursorPosCallback(window, CursorPosCallback);
-    // ... ou rolar a "rodinha" do mouse.
-    glfwSetScrollCallback(window, ScrollCallback);
+    GLFWwindow* window = NULL;
+    Offscreen offscreen;
+    if (g_OffscreenWidth > 0)
+    {
+        // Sem janela o contexto OpenGL é criado pela EGL e desenhamos em um framebuffer object. A GLFW não é inicializada.
+        if (!Offscreen_Init(&offscreen, g_OffscreenWidth, g_OffscreenHeight, g_GlDebugLevel != GLDEBUG_OFF))
+            std::exit(EXIT_FAILURE);
+        g_ScreenRatio = (float)g_OffscreenWidth / g_OffscreenHeight;
+        g_FramebufferWidth = g_OffscreenWidth;
+        g_FramebufferHeight = g_OffscreenHeight;
+    }
+    else
+    {
+        // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do sistema operacional, onde poderemos renderizar com OpenGL.
+        int success = glfwInit();
+        if (!success)
+        {
+            fprintf(stderr, "ERROR: glfwInit() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
+
+        // Definimos o callback para impressão de erros da GLFW no terminal
+        glfwSetErrorCallback(ErrorCallback);
+
+        // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
-    // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
-    glfwMakeContextCurrent(window);
+        #ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        #endif
 
-    // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a biblioteca GLAD.
-    gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+        // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as funções modernas de OpenGL.
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // Definimos a função de callback que será chamada sempre que a janela for redimensionada, por consequência alterando o tamanho do "framebuffer".
-    // (região de memória onde são armazenados os pixels da imagem)
-    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    FramebufferSizeCallback(window, 800, 600); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+        // Com a opção --gl-debug, pedimos um contexto de depuração, no qual o driver gera todas as mensagens de erro.
+        if (g_GlDebugLevel != GLDEBUG_OFF)
+            glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+
+        // Criamos uma janela do sistema operacional, com 800 colunas e 600 linhas de pixels, e com título "Spaceship Game".
+        window = glfwCreateWindow(800, 600, "Spaceship Game", NULL, NULL);
+        if (!window)
+        {
+            glfwTerminate();
+            fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
+
+        // Definimos a função de callback que será chamada sempre que o usuário pressionar alguma tecla do teclado ...
+        glfwSetKeyCallback(window, KeyCallback);
+        // ... ou clicar os botões do mouse ...
+        glfwSetMouseButtonCallback(window, MouseButtonCallback);
+        // ... ou movimentar o cursor do mouse em cima da janela ...
+        glfwSetCursorPosCallback(window, CursorPosCallback);
+        // ... ou rolar a "rodinha" do mouse.
+        glfwSetScrollCallback(window, ScrollCallback);
+
+        // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
+        glfwMakeContextCurrent(window);
+
+        // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a biblioteca GLAD.
+        gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+
+        // Definimos a função de callback que será chamada sempre que a janela for redimensionada, por consequência alterando o tamanho do "framebuffer".
+        // (região de memória onde são armazenados os pixels da imagem)
+        glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+        FramebufferSizeCallback(window, 800, 600); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+    }
 
     // Imprimimos no terminal informações sobre a GPU do sistema
     const GLubyte *vendor      = glGetString(GL_VENDOR);
@@ -276,46 +601,96 @@ int main(int argc, char* argv[])
     const GLubyte *glslversion = glGetString(GL_SHADING_LANGUAGE_VERSION);
     printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
-    // Carregamos os shaders de vértices e de fragmentos que serão utilizados para renderização.
-    LoadShadersFromFiles();
+    // Os erros do OpenGL são informados pelo driver (opção --gl-debug), sem consultas a glGetError().
+    GLADloadproc loadProc = window != NULL ? (GLADloadproc) glfwGetProcAddress : (GLADloadproc) Offscreen_GetProcAddress;
+    GlDebug_Init(g_GlDebugLevel, loadProc);
+
+    // Os programas de GPU já ligados em execuções anteriores são lidos do cache em disco. Veja "include/shadercache.h".
+    ShaderCache_Init(g_ShaderCacheEnabled ? g_ShaderCacheDirectory.c_str() : NULL, loadProc);
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /////// CARREGANDO TEXTURAS E MODELOS 3D NO FORMATO OBJ ////////////////////////////////////////////////////
 
-    // Carregamos duas imagens para serem utilizadas como textura
-    LoadTextureImage("../../data/universe.png");                       // TextureImage0
-    LoadTextureImage("../../data/spaceshiptextures/emi.jpg");          // TextureImage1
-    LoadTextureImage("../../data/spaceshiptextures/blender.jpg");      // TextureImage2
-    LoadTextureImage("../../data/asteroidtextures/rock_texture.jpg");  // TextureImage3
-    LoadTextureImage("../../data/cointextures/gold.png");              // TextureImage4
-    LoadTextureImage("../../data/rockettextures/rocket.png");          // TextureImage5
+    // As imagens e os modelos são lidos do disco e processados em paralelo pelo sistema de tarefas. Somente o envio
+    // para a GPU é feito aqui, na ordem abaixo, que define as unidades de textura e a ordem da cena virtual.
+    const char* texture_filenames[] = {
+        "../../data/universe.png",                       // TextureImage0
+        "../../data/spaceshiptextures/emi.jpg",          // TextureImage1
+        "../../data/spaceshiptextures/blender.jpg",      // TextureImage2
+        "../../data/asteroidtextures/rock_texture.jpg",  // TextureImage3
+        "../../data/cointextures/gold.png",              // TextureImage4
+        "../../data/rockettextures/rocket.png",          // TextureImage5
+    };
+    const char* model_filenames[] = {
+        "../../data/sphere.obj",
+        "../../data/spaceship.obj",
+        "../../data/asteroid.obj",
+        "../../data/coin.obj",
+        "../../data/rocket.obj",
+    };
 
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-    ObjModel spheremodel("../../data/sphere.obj");
-    ComputeNormals(&spheremodel);
-    BuildTrianglesAndAddToVirtualScene(&spheremodel);
+    AssetLoading assets;
+    for (size_t i = 0; i < sizeof(texture_filenames) / sizeof(texture_filenames[0]); ++i)
+    {
+        TextureImage image = { texture_filenames[i], NULL, 0, 0 };
+        assets.textures.push_back(image);
+    }
+    assets.model_filenames.assign(model_filenames, model_filenames + sizeof(model_filenames) / sizeof(model_filenames[0]));
+    assets.models.assign(assets.model_filenames.size(), NULL);
 
-    ObjModel spaceshipmodel("../../data/spaceship.obj");
-    ComputeNormals(&spaceshipmodel);
-    BuildTrianglesAndAddToVirtualScene(&spaceshipmodel);
+    JobCounter texturesLoaded, modelsLoaded;
+    stbi_set_flip_vertically_on_load(true);
+    Jobs_ParallelFor(g_Jobs, (uint32_t)assets.textures.size(), 1, DecodeTextureImages, &assets, &texturesLoaded);
+    Jobs_ParallelFor(g_Jobs, (uint32_t)assets.models.size(), 1, LoadObjModels, &assets, &modelsLoaded);
 
-    ObjModel asteroidmodel("../../data/asteroid.obj");
-    ComputeNormals(&asteroidmodel);
-    BuildTrianglesAndAddToVirtualScene(&asteroidmodel);
+    // Enquanto as tarefas decodificam as imagens e os modelos, entregamos ao driver os shaders de todos os programas
+    // de GPU. O resultado da compilação só é consultado depois do envio dos modelos, em ShaderCache_FinishAll().
+    {
+        PROFILE_SCOPE("Entregar shaders");
 
-    ObjModel coinmodel("../../data/coin.obj");
-    ComputeNormals(&coinmodel);
-    BuildTrianglesAndAddToVirtualScene(&coinmodel);
+        // Carregamos os shaders de vértices e de fragmentos que serão utilizados para renderização.
+        LoadShadersFromFiles();
 
-    ObjModel rocketmodel("../../data/rocket.obj");
-    ComputeNormals(&rocketmodel);
-    BuildTrianglesAndAddToVirtualScene(&rocketmodel);
+        // O rasterizador por software precisa de uma cópia das texturas e dos modelos, feita ao carregá-los abaixo.
+        if (g_SoftwareRenderer)
+            SoftRender_Init(&g_SoftRenderer, g_Jobs);
+
+        // Inicializamos o código para renderização de texto e o painel de desempenho.
+        TextRendering_Init();
+        Hud_Init(&g_Hud);
+    }
+
+    {
+        PROFILE_SCOPE("Enviar texturas");
+        Jobs_Wait(g_Jobs, &texturesLoaded);
+        for (size_t i = 0; i < assets.textures.size(); ++i)
+            LoadTextureImage(assets.textures[i]);
+    }
+
+    // Construímos a representação de objetos geométricos através de malhas de triângulos
+    {
+        PROFILE_SCOPE("Enviar modelos");
+        Jobs_Wait(g_Jobs, &modelsLoaded);
+        for (size_t i = 0; i < assets.models.size(); ++i)
+        {
+            BuildTrianglesAndAddToVirtualScene(assets.models[i]);
+            delete assets.models[i];
+        }
+    }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // Inicializamos o código para renderização de texto.
-    TextRendering_Init();
+    // Os programas de GPU passam a ser necessários: esperamos a compilação que ainda não terminou.
+    {
+        PROFILE_SCOPE("Terminar shaders");
+        ShaderCache_FinishAll();
+        ShaderCache_Report();
+    }
+
+    GpuTimer_Init(&g_GpuTimer);
+    g_GpuTrack = Profiler_CreateTrack("GPU");
+    SceneTarget_Init(&g_SceneTarget);
 
     // Habilitamos o Z-buffer.
     glEnable(GL_DEPTH_TEST);
@@ -325,218 +700,300 @@ int main(int argc, char* argv[])
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
-    char lastPressedKey;
-
-    float meteorStartTime = 0;
-    float meteorTime;
-    int meteorColor;
-
-    float rocketStartTime = 0;
-    float rocketTime = 5;
-    float rocketSpeed = 11;
-
-    glm::vec4 bezierControlPoint1;
-    glm::vec4 bezierControlPoint2;
-    glm::vec4 bezierControlPoint3;
-    glm::vec4 bezierControlPoint4;
-
-    glm::vec4 rocketDirection = glm::vec4(-1,0,0,0);
-
-    float asteroidSpeed = 15;
-
-    glm::vec3 asteroidsCenter[] = {
-        glm::vec3(10, 5, -45),
-        glm::vec3(0, 10, -65),
-        glm::vec3(0, -15, -90),
-        glm::vec3(10, -5, -105),
-        glm::vec3(0, -20, -150),
-        glm::vec3(20, -10, -165),
-        glm::vec3(20, 10, -200),
-        glm::vec3(15, 0, -225),
-        glm::vec3(15, -10, -250),
-        glm::vec3(25, 10, -260),
-        glm::vec3(0, 0, -320),
-        glm::vec3(-10, -10, -340),
-        glm::vec3(-25, -30, -370),
-        glm::vec3(-45, -35, -390),
-        glm::vec3(-50, -55, -420),
-        glm::vec3(-30, -45, -440),
-        glm::vec3(-30, -35, -480),
-        glm::vec3(-20, -20, -500),
-        glm::vec3(-5, -25, -520),
-        glm::vec3(-15, -15, -540),
-        glm::vec3(-20, -5, -590),
-        glm::vec3(-20, -10, -620),
-        glm::vec3(0, -20, -630),
-        glm::vec3(-10, -15, -660)
-    };
-
-    BoundingSphere asteroidBoundingSpheres[] = {
-        { asteroidsCenter[0], 0.5f },
-        { asteroidsCenter[1], 0.5f },
-        { asteroidsCenter[2], 0.5f },
-        { asteroidsCenter[3], 0.5f },
-        { asteroidsCenter[4], 0.5f },
-        { asteroidsCenter[5], 0.5f },
-        { asteroidsCenter[6], 0.5f },
-        { asteroidsCenter[7], 0.5f },
-        { asteroidsCenter[8], 0.5f },
-        { asteroidsCenter[9], 0.5f },
-        { asteroidsCenter[10], 0.5f },
-        { asteroidsCenter[11], 0.5f },
-        { asteroidsCenter[12], 0.5f },
-        { asteroidsCenter[13], 0.5f },
-        { asteroidsCenter[14], 0.5f },
-        { asteroidsCenter[15], 0.5f },
-        { asteroidsCenter[16], 0.5f },
-        { asteroidsCenter[17], 0.5f },
-        { asteroidsCenter[18], 0.5f },
-        { asteroidsCenter[19], 0.5f },
-        { asteroidsCenter[20], 0.5f },
-        { asteroidsCenter[21], 0.5f },
-        { asteroidsCenter[22], 0.5f },
-        { asteroidsCenter[23], 0.5f }
-    };
+    // Carregamos o nível do jogo, mapeando em memória sua versão binária. Veja "include/level.h".
+    Level level;
+    if (!Level_LoadOrCompile(g_LevelTextFilename.c_str(), g_LevelBinaryFilename.c_str(), &level))
+    {
+        fprintf(stderr, "ERROR: Cannot load level \"%s\".\n", g_LevelBinaryFilename.c_str());
+        std::exit(EXIT_FAILURE);
+    }
 
-    glm::vec3 asteroidsGroup[] = {
-        glm::vec3(0,10,-36),
-        glm::vec3(10,10,-18),
-        glm::vec3(0,30,-36)
-    };
+    // A gravação guarda o nível e o raio de carregamento dos setores, e só é reproduzida com os mesmos valores.
+    if (g_Replaying && !Replay_CheckLevel(g_InputLog, g_ReplayFilename.c_str(), Replay_LevelHash(level), g_StreamRadius))
+        std::exit(EXIT_FAILURE);
+    if (!g_Replaying && !g_RecordFilename.empty()
+        && !Replay_StartRecording(&g_InputLog, g_RecordFilename.c_str(), g_RandomSeed, g_SimulationRate, Replay_LevelHash(level), g_StreamRadius))
+        std::exit(EXIT_FAILURE);
 
-    glm::vec3 coinCenter[] = {
-        glm::vec3(0, 5, -30),
-        glm::vec3(0, -5, -70),
-        glm::vec3(5, -20, -120),
-        glm::vec3(15, 0, -180),
-        glm::vec3(25, 10, -230),
-        glm::vec3(0, 0, -300),
-        glm::vec3(-20, -15, -350),
-        glm::vec3(-50, -60, -400),
-        glm::vec3(-30, -40, -460),
-        glm::vec3(-10, -20, -520),
-        glm::vec3(-30, 0, -580),
-        glm::vec3(0, -20, -660),
-    };
+    // No modo stress o nível escolhido fornece apenas as moedas e o grupo; os asteroides estáticos são gerados a cada rodada.
+    Level stressBase;
+    uint32_t stressAsteroids = 0;
+    double stressSeconds = 0.0;
+    if (g_StressMaxAsteroids > 0)
+    {
+        stressBase = level;
+        stressAsteroids = std::min(g_StressFirstAsteroids, g_StressMaxAsteroids);
+        LoadStressLevel(stressBase, stressAsteroids, &level, &stressSeconds);
+        Benchmark_PrintStressHeader();
+    }
 
-    glm::vec3 coinNormal = glm::vec3(0, 0, 0);
-
-    BoundingCircle coinBoundingSpheres[] = {
-        { coinCenter[0], 2.5f, coinNormal },
-        { coinCenter[1], 2.5f, coinNormal },
-        { coinCenter[2], 2.5f, coinNormal },
-        { coinCenter[3], 2.5f, coinNormal },
-        { coinCenter[4], 2.5f, coinNormal },
-        { coinCenter[5], 2.5f, coinNormal },
-        { coinCenter[6], 2.5f, coinNormal },
-        { coinCenter[7], 2.5f, coinNormal },
-        { coinCenter[8], 2.5f, coinNormal },
-        { coinCenter[9], 2.5f, coinNormal },
-        { coinCenter[10], 2.5f, coinNormal },
-        { coinCenter[11], 2.5f, coinNormal }
-    };
+    // Os asteroides estáticos são carregados por setores, em uma thread separada, conforme a nave avança.
+    // Ao gravar ou reproduzir uma partida os setores são carregados na própria simulação, para que o
+    // conjunto de asteroides ativos em cada passo (e portanto as colisões) não dependa do escalonamento das threads.
+    bool deterministic = g_Replaying || !g_RecordFilename.empty();
+    LevelStreamer streamer;
+    LevelStreamer_Init(&streamer, &level, g_StreamRadius, 2, !deterministic);
+    BuildLevelSceneGraph(level);
 
-    // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
-    while (!glfwWindowShouldClose(window))
+    FILE* checksums = NULL;
+    if (!g_ChecksumFilename.empty())
     {
-        // Calculando o tempo passado desde a última animação
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        checksums = fopen(g_ChecksumFilename.c_str(), "w");
+        if (checksums == NULL)
+        {
+            fprintf(stderr, "ERROR: Cannot write checksum file \"%s\".\n", g_ChecksumFilename.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+    }
 
-        // Definimos a cor do "fundo" do framebuffer como branco.
-        //           R     G     B     A
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    GameState state;
+    Simulation_Init(state, level, g_RandomSeed, g_Benchmark);
 
-        // "Pintamos" todos os pixels do framebuffer com a cor definida acima, e também resetamos todos os pixels do Z-buffer (depth buffer).
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // No benchmark a partida começa imediatamente e medimos os quadros sem sincronização vertical.
+    Benchmark benchmark;
+    int benchmarkFrame = 0;
+    if (g_Benchmark)
+    {
+        Benchmark_Init(&benchmark, &level, g_BenchmarkFrames);
+        benchmark.load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - programStart).count();
+        if (g_StressMaxAsteroids > 0)
+            benchmark.load_seconds = stressSeconds;
+        g_Input.start = true;
+    }
 
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo os shaders de vértice e fragmentos).
-        glUseProgram(g_GpuProgramID);
+    // Sincronização vertical (opção --vsync), configurada antes de o contexto passar à thread de renderização.
+    // O benchmark mede os quadros sem ela e sem esperar por eventos.
+    if (window != NULL)
+        FramePacer_SetVsync(g_Benchmark ? VSYNC_OFF : g_Vsync);
+    FramePacer_Init(&g_FramePacer, g_MaxFramesPerSecond, !g_Benchmark);
+
+    // A simulação avança em passos fixos de "step" segundos, consumindo o tempo real acumulado em "accumulator".
+    // Cada quadro desenha a interpolação entre os dois últimos passos simulados.
+    const double step = 1.0 / g_SimulationRate;
+    double accumulator = 0.0;
+    double lastFrame = GetTime();
+
+    int renderedFrames = 0;
+    double pacedSeconds = 0.0;  // Espera do FramePacer no fim do quadro anterior, descontada dos tempos de quadro
+
+    FrameTransforms previous = CaptureFrameTransforms(state);
+    FrameTransforms current = previous;
+
+    // Arenas dos pacotes de quadro. Elas crescem sozinhas se o tamanho inicial não bastar.
+    for (int i = 0; i < 2; ++i)
+        Arena_Init(&g_FramePackets[i].arena, 1 << 20);
+    uint64_t heapAllocations = g_HeapAllocations.load();
+    Governor_Init(&g_Governor, g_TargetFrameMs, g_ResolutionScale);
+    Hitch_Init(&g_HitchRecorder, g_HitchDirectory.c_str(), g_HitchBudgetMs, 10.0, 10);  // No máximo uma gravação a cada 10 s, e 10 no total
+    MemStats heapStats;
+    MemTrack_Snapshot(&heapStats);
+    g_PendingInput.reserve(256);
+
+    // Com a thread de renderização, o contexto OpenGL passa a ser dela até o fim do laço principal. As funções da
+    // GLFW que tratam eventos continuam sendo chamadas apenas pela thread principal, como a biblioteca exige.
+    std::function<void()> attachContext = [&]
+    {
+        if (window != NULL)
+            glfwMakeContextCurrent(window);
+        else
+            Offscreen_MakeCurrent(&offscreen, true);
+    };
+    std::function<void()> detachContext = [&]
+    {
+        if (window != NULL)
+            glfwMakeContextCurrent(NULL);
+        else
+            Offscreen_MakeCurrent(&offscreen, false);
+    };
+    if (g_UseRenderThread)
+    {
+        detachContext();
+        RenderThread_Start(&g_RenderThread, g_FrameLatency,
+                           [&](int packet) { RenderFramePacket(g_FramePackets[packet], window, &offscreen); },
+                           attachContext, detachContext);
+    }
 
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        /////// CALCULANDO POSIÇÃO E SENTIDO DA CAMERA /////////////////////////////////////////////////////////////
+    // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
+    MemTrack_SetTag(MEMTAG_OTHER);
+    while (!WindowShouldClose(window))
+    {
+        PROFILE_FRAME((uint32_t)renderedFrames);
+        PROFILE_SCOPE("Quadro");
 
-        glm::vec4 camera_position_c;
-        glm::vec4 camera_lookat_l;
-        glm::vec4 camera_view_vector;
-        glm::vec4 camera_up_vector;
+        // Calculando o tempo passado desde o último quadro
+        double currentFrame = GetTime();
+        accumulator += std::min(currentFrame - lastFrame, MAX_FRAME_TIME);
+        if (renderedFrames > 0)
+        {
+            double frameMs = std::max(0.0, currentFrame - lastFrame - pacedSeconds) * 1000.0;
+            Hitch_EndFrame(&g_HitchRecorder, renderedFrames - 1, frameMs, currentFrame);
+            Governor_Update(&g_Governor, frameMs);
+        }
+        lastFrame = currentFrame;
 
-        if (g_IsFreeCamera)
+        // No benchmark cada quadro avança exatamente um passo da simulação, com a câmera posicionada sobre a curva.
+        if (g_Benchmark)
         {
-            if (g_WKeyPressed || g_SKeyPressed || g_AKeyPressed || g_DKeyPressed)
+            if (benchmarkFrame == g_BenchmarkFrames && g_StressMaxAsteroids > 0)
             {
-                g_CameraSpeed += CAMERA_ACCELERATION * deltaTime;
-                if (g_CameraSpeed > MAX_CAMERA_SPEED)
+                MEMTRACK_SCOPE(MEMTAG_LOADING);
+                MemTrack_Arm(false);
+                RunOnRenderThread([&]
+                {
+                    GpuTimer_Finish(&g_GpuTimer, StoreGpuTimes, &benchmark);
+                    Benchmark_ReportStressRound(&benchmark, currentFrame, level.num_asteroids);
+                });
+
+                // Próxima rodada: dobramos o número de asteroides e recomeçamos a partida no novo nível.
+                if (stressAsteroids < g_StressMaxAsteroids)
                 {
-                    g_CameraSpeed = MAX_CAMERA_SPEED;
+                    stressAsteroids = (uint32_t)std::min<uint64_t>(2ull * stressAsteroids, g_StressMaxAsteroids);
+                    LevelStreamer_Shutdown(&streamer);
+                    Level_Unload(&level);
+                    LoadStressLevel(stressBase, stressAsteroids, &level, &stressSeconds);
+                    LevelStreamer_Init(&streamer, &level, g_StreamRadius, 2, !deterministic);
+                    BuildLevelSceneGraph(level);
+
+                    Simulation_Reset(state, level);
+                    g_Input.start = true;
+                    RunOnRenderThread([&] { Benchmark_Init(&benchmark, &level, g_BenchmarkFrames); });
+                    benchmark.load_seconds = stressSeconds;
+                    benchmarkFrame = 0;
+                    currentFrame = lastFrame = GetTime();
+                    previous = current = CaptureFrameTransforms(state);
                 }
-            }
-            else
-            {
-                g_CameraSpeed -= CAMERA_ACCELERATION * deltaTime * 2.0f;
-                if (g_CameraSpeed < 0.0f)
+                else
                 {
-                    g_CameraSpeed = 0.0f;
+                    CloseWindow(window);
+                    break;
                 }
             }
-            if (g_WKeyPressed)
-            {
-                lastPressedKey = 'W';
-                g_FreeCameraPosition += g_CameraSpeed * g_FreeCameraFront * deltaTime;
-            }
-            if (g_SKeyPressed)
+            else if (benchmarkFrame == g_BenchmarkFrames)
             {
-                lastPressedKey = 'S';
-                g_FreeCameraPosition -= g_CameraSpeed * g_FreeCameraFront * deltaTime;
+                MemTrack_Arm(false);
+                RunOnRenderThread([&]
+                {
+                    GpuTimer_Finish(&g_GpuTimer, StoreGpuTimes, &benchmark);
+                    Benchmark_Report(&benchmark, currentFrame);
+                });
+                CloseWindow(window);
+                break;
             }
+            glm::vec3 position, direction;
+            Benchmark_Camera(&benchmark, benchmarkFrame, &position, &direction);
+            state.camera_position = position;
+            state.camera_yaw = glm::degrees(atan2f(direction.z, direction.x));
+            state.camera_pitch = glm::degrees(asinf(glm::clamp(direction.y, -1.0f, 1.0f)));
+            accumulator = step;
+        }
 
-			if (!isRolling){
-                if (g_AKeyPressed)
-                {
-                    isRolling = true;
-                    barrelRollAngle = 0.0f;
-                    barrelRollDirection = -1;
-                }
-                else if (g_DKeyPressed)
+        // Depois do aquecimento, apenas o carregamento pode alocar com "operator new".
+        if (g_AllocAssert)
+            MemTrack_Arm((g_Benchmark ? benchmarkFrame : renderedFrames) >= BENCHMARK_WARMUP_FRAMES);
+
+        // Entregamos à simulação os eventos recebidos desde o último quadro. Eles são consumidos pelo próximo passo.
+        for (size_t i = 0; i < g_PendingInput.size(); ++i)
+        {
+            g_PendingInput[i].tick = (uint32_t)state.tick;
+            Replay_RecordEvent(&g_InputLog, g_PendingInput[i]);
+            Simulation_ApplyInputEvent(g_Input, g_PendingInput[i]);
+        }
+        g_PendingInput.clear();
+
+        SimulationStats stats = { 0.0, 0.0 };
+        std::chrono::steady_clock::time_point simulationStart = std::chrono::steady_clock::now();
+        while (accumulator >= step)
+        {
+            PROFILE_SCOPE("Passo da simulação");
+            // Ao reproduzir uma gravação, entregamos os eventos gravados exatamente antes do passo que os consumiu.
+            if (g_Replaying)
+            {
+                if (state.tick >= g_InputLog.end_tick)
                 {
-                    isRolling = true;
-                    barrelRollAngle = 0.0f;
-                    barrelRollDirection = 1;
+                    printf("Reprodução concluída: %u passos, checksum %016llx.\n", (unsigned)state.tick, (unsigned long long)Simulation_Checksum(state));
+                    CloseWindow(window);
+                    g_Replaying = false;
+                    accumulator = 0.0;
+                    break;
                 }
+                while (g_InputLog.next < g_InputLog.events.size() && g_InputLog.events[g_InputLog.next].tick <= state.tick)
+                    Simulation_ApplyInputEvent(g_Input, g_InputLog.events[g_InputLog.next++]);
             }
 
-			if (isRolling){
-                barrelRollAngle += deltaTime * BARREL_ROLL_SPEED * barrelRollDirection;
+            previous = current;
+            int result = Simulation_Tick(state, g_Input, level, &streamer, (float)step, (g_Benchmark || g_ShowHud) ? &stats : NULL, g_Jobs);
+            if (result != GAME_PLAYING)
+            {
+                MEMTRACK_SCOPE(MEMTAG_LOADING);
+                printf("%s. Moedas coletadas: %u. Tempo: %2fs.\n", result == GAME_WON ? "Ganhou" : "Perdeu", state.next_coin, state.time-state.start_time);
+                Simulation_Reset(state, level);
+            }
+            current = CaptureFrameTransforms(state);
+            accumulator -= step;
 
-                if (TARGET_ANGLE - barrelRollAngle <= 0.01f and barrelRollDirection == 1){
-                    isRolling = false;
-                    barrelRollAngle = 0.0f;
-                } else if (glm::abs(TARGET_ANGLE - barrelRollAngle) >= 12.56f and barrelRollDirection == -1){
+            if (checksums != NULL)
+                fprintf(checksums, "%u %016llx\n", (unsigned)state.tick, (unsigned long long)Simulation_Checksum(state));
+        }
+        std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+        double simulationMs = std::chrono::duration<double, std::milli>(renderStart - simulationStart).count();
 
-                    isRolling = false;
-                    barrelRollAngle = 0.0f;
-                }
-            }
+        FrameTransforms frame = InterpolateFrameTransforms(previous, current, (float)(accumulator / step));
 
-            if (!(g_WKeyPressed || g_SKeyPressed || g_AKeyPressed || g_DKeyPressed)){
-                if (lastPressedKey == 'W'){
-                    g_FreeCameraPosition += g_CameraSpeed * g_FreeCameraFront * deltaTime;
-                }
-                if (lastPressedKey == 'S'){
-                    g_FreeCameraPosition -= g_CameraSpeed * g_FreeCameraFront * deltaTime;
-                }
+        // Descrevemos o quadro no pacote que não está sendo desenhado. Os desenhos abaixo são apenas registrados nele.
+        // A arena do pacote é esvaziada, e a lista de desenhos recomeça nela com a capacidade do quadro anterior.
+        MemTrack_SetTag(MEMTAG_RENDER);
+        g_FramePacket = &g_FramePackets[g_UseRenderThread ? RenderThread_WritePacket(&g_RenderThread) : 0];
+        FramePacket& packet = *g_FramePacket;
+        if (packet.rendered)
+        {
+            HitchFrame* drawn = Hitch_Frame(&g_HitchRecorder, packet.frame);
+            if (drawn != NULL)
+            {
+                drawn->rendered = true;
+                drawn->draw_calls = packet.counters.draw_calls;
+                drawn->triangles = packet.counters.triangles;
+                drawn->state_changes = packet.counters.state_changes;
             }
-            camera_position_c = glm::vec4(g_FreeCameraPosition, 1.0f);
-            camera_view_vector = glm::vec4(g_FreeCameraFront, 0.0f);
-            camera_up_vector = glm::vec4(g_FreeCameraUp, 0.0f);
+            packet.rendered = false;
         }
-        else
+        size_t previousDraws = packet.draws.size();
+        Arena_Reset(&packet.arena);
+        packet.draws = ArenaVector<DrawCommand>(ArenaAllocator<DrawCommand>(&packet.arena));
+        packet.draws.reserve(previousDraws);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        /////// CALCULANDO POSIÇÃO E SENTIDO DA CAMERA /////////////////////////////////////////////////////////////
+
+        glm::vec4 camera_position_c = glm::vec4(frame.camera_position, 1.0f);
+        glm::vec4 camera_view_vector;
+        glm::vec4 camera_up_vector;
+
+        // Com o "late latching", a orientação da câmera livre não é interpolada: usamos a do último passo, mais o
+        // movimento do mouse ainda não consumido pela simulação. O movimento seguinte é somado por LatchCameraView().
+        packet.latch_camera = g_LateLatch && state.free_camera;
+        if (packet.latch_camera)
+        {
+            glm::quat orientation = glm::quatLookAt(Simulation_LatestCameraFront(state, g_Input, g_Input.last_cursor_x, g_Input.last_cursor_y), glm::vec3(0.0f, 1.0f, 0.0f));
+            camera_view_vector = glm::vec4(orientation * glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+            camera_up_vector   = glm::vec4(orientation * glm::vec3(0.0f, 1.0f, 0.0f), 0.0f);
+        }
+        else if (state.free_camera)
+        {
+            camera_view_vector = glm::vec4(frame.camera_orientation * glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+            camera_up_vector   = glm::vec4(frame.camera_orientation * glm::vec3(0.0f, 1.0f, 0.0f), 0.0f);
+        }
+        else if (level.num_coins > 0)
         {
-            camera_lookat_l    = glm::vec4(coinCenter[g_nextCoin].x,coinCenter[g_nextCoin].y,coinCenter[g_nextCoin].z,1.0f);
+            const LevelCoin& coin = level.coins[std::min<uint32_t>(state.next_coin, level.num_coins - 1)];
+            glm::vec4 camera_lookat_l = glm::vec4(coin.x,coin.y,coin.z,1.0f);
             camera_view_vector = camera_lookat_l - camera_position_c;  // Vetor "view", sentido para onde a câmera está virada
+            camera_up_vector   = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        }
+        else
+        {
+            // Uma fase sem moedas não tem para onde olhar: a câmera olha para -Z.
+            camera_view_vector = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+            camera_up_vector   = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
         }
 
         // Computamos a matriz "View" utilizando os parâmetros da câmera para definir o sistema de coordenadas da câmera.
@@ -557,8 +1014,10 @@ int main(int argc, char* argv[])
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
         // Enviamos as matrizes "view" e "projection" para a placa de vídeo (GPU).
-        glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        SetViewMatrix(view, true);
+        SetProjectionMatrix(projection);
+        packet.camera_position = camera_position_c;
+        packet.input_time = currentFrame;
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
         /////// POSICIONANDO OBJETOS VIRTUAIS NA CENA //////////////////////////////////////////////////////////////
@@ -574,379 +1033,842 @@ int main(int argc, char* argv[])
         glm::mat4 identity = Matrix_Identity();
         glm::mat4 model = Matrix_Identity();
 
-        if(g_StartGame)
-        {
-            // Desenhamos o modelo da esfera
-            model = Matrix_Translate(camera_position_c.x, camera_position_c.y, camera_position_c.z);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, SPHERE);
-            glDisable(GL_CULL_FACE);
-            glDisable(GL_DEPTH_TEST);
-            DrawVirtualObject("the_sphere");
-            glEnable(GL_CULL_FACE);
-            glEnable(GL_DEPTH_TEST);
-
-            // Desenhamos o modelo do foguete
-            glm::vec3 originalShipPosition;
-            glm::vec3 original_camera_view_vector;
-            glm::vec3 currentMissilePosition;
-            if (g_IsFreeCamera){
-                if (g_SpaceKeyPressed && !rocketStartTime)
-                {
-                    rocketStartTime = currentFrame;
-                    camera_view_vector = camera_view_vector / norm(camera_view_vector);
-                    original_camera_view_vector = camera_view_vector;
-                    rocketDirection = rocketDirection / norm(rocketDirection);
-
-                    originalShipPosition = glm::vec3(camera_position_c.x, camera_position_c.y, camera_position_c.z) - glm::vec3(camera_view_vector.x * -18, camera_view_vector.y* -18, camera_view_vector.z* -18);;
-
-                    float angle = acos(dotproduct(camera_view_vector, rocketDirection));
-                    glm::vec4 rotationAxis = crossproduct(camera_view_vector, rocketDirection);
-                    rotationAxis = rotationAxis / norm(rotationAxis);
-
-                    glm::mat4 rotationMatrix = Matrix_Rotate(angle, rotationAxis);
-                    glm::mat4 translationMatrix = Matrix_Translate(originalShipPosition.x, originalShipPosition.y, originalShipPosition.z);
+        // Apenas o grupo de asteroides se move: o grafo de cena recalcula somente os seus membros.
+        SceneGraph_SetLocal(&g_SceneGraph, g_SceneNodes.group, Matrix_Translate(level.group_origin[0]+frame.group_offset,level.group_origin[1],level.group_origin[2]));
+        SceneGraph_Update(&g_SceneGraph);
 
-                    model = translationMatrix * rotationMatrix;
+        // Enquanto desenhamos os primeiros objetos, o sistema de tarefas descarta os asteroides fora da pirâmide de visão.
+        JobCounter asteroidsCulled;
+        uint32_t asteroidsDrawn = 0;
+        if(state.started)
+        {
+            AsteroidCulling& culling = g_AsteroidCulling;
+            const SceneObject& asteroidObject = g_VirtualScene["asteroid"];
+            culling.sectors = &streamer.active;
+            culling.level = &level;
+            culling.state = &state;
+            culling.graph = &g_SceneGraph;
+            culling.first_member = g_SceneNodes.first_member;
+            culling.frustum = extractFrustum(projection * view);
+            culling.model_radius = std::max(glm::length(asteroidObject.bbox_min), glm::length(asteroidObject.bbox_max));
+            int sceneWidth, sceneHeight;
+            SceneTarget_Size(g_FramebufferWidth, g_FramebufferHeight, g_Governor.resolution_scale, &sceneWidth, &sceneHeight);
+            culling.camera_position = glm::vec3(camera_position_c);
+            culling.focal_pixels = 0.5f * sceneHeight / tanf(field_of_view / 2.0f);
+            culling.min_pixels = g_Governor.lod_bias * GOVERNOR_LOD_PIXELS;
+            culling.num_sectors = (uint32_t)streamer.active.size();
+            culling.sector_visible = Arena_AllocateArray<VisibleAsteroids>(&packet.arena, culling.num_sectors);
+            for (uint32_t s = 0; s < culling.num_sectors; ++s)
+                culling.sector_visible[s].models = Arena_AllocateArray<const glm::mat4*>(&packet.arena, streamer.active[s]->asteroids.size());
+            culling.group_visible = Arena_AllocateArray<uint8_t>(&packet.arena, level.num_group_members);
+            Jobs_ParallelFor(g_Jobs, (uint32_t)streamer.active.size(), 1, CullSectorAsteroids, &culling, &asteroidsCulled);
+            Jobs_ParallelFor(g_Jobs, level.num_group_members, 256, CullGroupAsteroids, &culling, &asteroidsCulled);
+        }
 
-                    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, ROCKET);
-                    DrawVirtualObject("the_rocket");
-                }
-                else if (rocketStartTime)
-                {
-                    if (currentFrame - rocketStartTime >= rocketTime)
-                    {
-                        rocketStartTime = 0;
-                        g_SpaceKeyPressed = false;
-                    }
-                    else
-                    {
-                        float deltaTime = currentFrame - rocketStartTime;
-                        glm::vec3 translation = original_camera_view_vector * (rocketSpeed * deltaTime);
-
-                        glm::mat4 translationMatrix = Matrix_Translate(originalShipPosition.x + translation.x, originalShipPosition.y + translation.y, originalShipPosition.z + translation.z );
-                        currentMissilePosition = glm::vec3(originalShipPosition.x + translation.x, originalShipPosition.y + translation.y, originalShipPosition.z + translation.z);
-                        model = translationMatrix;
-
-                        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                        glUniform1i(g_object_id_uniform, ROCKET);
-                        DrawVirtualObject("the_rocket");
-                    }
-                }
-            }    
+        if(state.started)
+        {
+            // Desenhamos o modelo da esfera, a não ser que o controle de qualidade tenha desligado os efeitos
+            if (g_Governor.effects > 0)
+            {
+                model = Matrix_Translate(camera_position_c.x, camera_position_c.y, camera_position_c.z);
+                SetModelMatrix(model);
+                SetObjectId(SPHERE);
+                SetGpuPass(GPUPASS_SKY);
+                SetCullingAndDepthTest(false);
+                DrawVirtualObject("the_sphere");
+                SetCullingAndDepthTest(true);
+            }
 
-            // Desenhamos vários meteoros
-            if (meteorStartTime == 0)
+            // Desenhamos o modelo do foguete
+            if (frame.rocket_active)
             {
-                meteorStartTime = currentFrame;
-                meteorTime = 2 + (rand() % 5);  // sorteia entre 2 e 6 segundos
-                meteorColor = 4 + (rand() % 2); // sorteia entre REDBALL(4) e BLUEBALL(5)
-                bezierControlPoint1 = glm::vec4(-200 + rand() % 500, 300, -300.0f, 1);
-                bezierControlPoint2 = glm::vec4(-200 + rand() % 500, 100.0f, -300.0f, 1);
-                bezierControlPoint3 = glm::vec4(-200 + rand() % 500, -100.0f, -300.0f, 1);
-                bezierControlPoint4 = glm::vec4(-200 + rand() % 500, -300.0f, -300.0f, 1);
+                model = Matrix_Translate(frame.rocket_position.x, frame.rocket_position.y, frame.rocket_position.z);
+                SetModelMatrix(model);
+                SetObjectId(ROCKET);
+                SetGpuPass(GPUPASS_ROCKET);
+                DrawVirtualObject("the_rocket");
             }
-            else
+
+            // Desenhamos o meteoro
+            if (frame.meteor_active)
             {
-                if (currentFrame - meteorStartTime >= meteorTime)
-                {
-                    meteorStartTime = 0;
-                }
-                else
-                {
-                    float t =  (1/meteorTime)*(currentFrame-meteorStartTime); // mapeia o intervalo [meteorStartTime, meteorStartTime + meteorTime] -> [0, 1]
-                    glm::vec4 point_on_curve = (float)(pow(1-t,3))*bezierControlPoint1 + (float)(3*t*pow(1-t,2))*bezierControlPoint2 + (float)(3*pow(t,2)*(1-t))*bezierControlPoint3 + (float)(pow(t,3))*bezierControlPoint4;
-                    model = Matrix_Translate(point_on_curve.x, point_on_curve.y, point_on_curve.z)*Matrix_Scale(1.0f/300.0f, 1.0f/300.0f, 1.0f/300.0f);
-                    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, meteorColor);
-                    DrawVirtualObject("asteroid");
-                }
+                model = Matrix_TranslateScale(frame.meteor_position.x, frame.meteor_position.y, frame.meteor_position.z, 1.0f/300.0f, 1.0f/300.0f, 1.0f/300.0f);
+                SetModelMatrix(model);
+                SetObjectId(state.meteor_color);
+                SetGpuPass(GPUPASS_ASTEROIDS);
+                DrawVirtualObject("asteroid");
             }
 
             // Desenhamos as moedas
-            for(int i = 0; i < NUM_COINS; ++i)
+            SetGpuPass(GPUPASS_COINS);
+            for(uint32_t i = 0; i < level.num_coins; ++i)
             {
-                if(shouldRenderCoin[i])
+                if(!state.coin_collected[i])
                 {
-                    model = Matrix_Translate(coinCenter[i].x, coinCenter[i].y, coinCenter[i].z)*Matrix_Scale(1,1,0.2);
-                    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, COIN);
+                    SetModelMatrix(SceneGraph_World(&g_SceneGraph, g_SceneNodes.first_coin + i));
+                    SetObjectId(COIN);
                     DrawVirtualObject("the_coin");
                 }
             }
 
-            // Desenhamos os asteroides
-            for(int i = 0; i < NUM_ASTEROIDS; ++i)
+            // Desenhamos os asteroides visíveis dos setores ativos
+            Jobs_Wait(g_Jobs, &asteroidsCulled);
+            uint32_t drawsBeforeAsteroids = (uint32_t)packet.draws.size();
+            SetObjectId(ASTEROID);
+            SetGpuPass(GPUPASS_ASTEROIDS);
+            const SceneObject& asteroidObject = g_VirtualScene["asteroid"];
+            for(uint32_t s = 0; s < g_AsteroidCulling.num_sectors; ++s)
             {
-                if(shouldRenderSphere[i])
+                const VisibleAsteroids& visible = g_AsteroidCulling.sector_visible[s];
+                for(uint32_t i = 0; i < visible.count; ++i)
                 {
-                    model = Matrix_Translate(asteroidsCenter[i].x, asteroidsCenter[i].y, asteroidsCenter[i].z)*Matrix_Scale(1.0f/300.0f, 1.0f/300.0f, 1.0f/300.0f);
-                    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                    glUniform1i(g_object_id_uniform, ASTEROID);
-                    DrawVirtualObject("asteroid");
+                    SetModelMatrix(*visible.models[i]);
+                    DrawVirtualObject(asteroidObject);
                 }
             }
 
+            // Desenhamos os asteroides se movendo em grupo, desde o inicio
+            for(uint32_t i = 0; i < level.num_group_members; ++i)
+            {
+                if(g_AsteroidCulling.group_visible[i])
+                {
+                    SetModelMatrix(SceneGraph_World(&g_SceneGraph, g_SceneNodes.first_member + i));
+                    DrawVirtualObject(asteroidObject);
+                }
+            }
+            asteroidsDrawn = (uint32_t)packet.draws.size() - drawsBeforeAsteroids;
 
-            // Desenhamos 3 asteroides se movendo em grupo, desde o inicio
-            model = Matrix_Translate(-300+((currentFrame-g_StartGameTime)*asteroidSpeed),60,-300);
+            // Desenhamos modelo da nave
 
-            PushMatrix(model);
-            if(shouldRenderSphere[0])
-            {
-                model = model*Matrix_Translate(asteroidsGroup[0].x, asteroidsGroup[0].y, asteroidsGroup[0].z)*Matrix_Scale(1.0f/300.0f, 1.0f/300.0f, 1.0f/300.0f);
-                glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                glUniform1i(g_object_id_uniform, ASTEROID);
-                DrawVirtualObject("asteroid");
+            if (state.free_camera){
+                model = Matrix_MultiplyAffine(Matrix_Translate(0,0,-18)*Matrix_Rotate_Y(3.141592), glm::mat4_cast(frame.ship_roll));
+                SetModelMatrix(model);
+                SetViewMatrix(identity);
+                SetObjectId(SPACESHIP);
+                SetGpuPass(GPUPASS_SHIP);
+                DrawVirtualObject("the_spaceship");
             }
-            PopMatrix(model);
+        }
+
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+        packet.frame = renderedFrames;
+        packet.framebuffer_width = g_FramebufferWidth;
+        packet.framebuffer_height = g_FramebufferHeight;
+        packet.resolution_scale = g_Governor.resolution_scale;
+        packet.draw_sky = !state.started || g_Governor.effects > 0;
+        packet.show_start_game = !state.started;
+        packet.benchmark = NULL;
+
+        uint32_t activeAsteroids = 0;
+        for (size_t s = 0; s < streamer.active.size(); ++s)
+            activeAsteroids += (uint32_t)streamer.active[s]->asteroids.size();
+        uint64_t allocations = g_HeapAllocations.load();
+        uint32_t frameAllocations = (uint32_t)(allocations - heapAllocations);
+        heapAllocations = allocations;
+
+        HitchFrame* hitch = Hitch_BeginFrame(&g_HitchRecorder, renderedFrames);
+        hitch->simulation_ms = simulationMs;
+        hitch->build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+        hitch->heap_allocations = frameAllocations;
+        hitch->tick = state.tick;
+        hitch->input_events = (uint32_t)(g_Replaying ? g_InputLog.next : g_InputLog.num_events);
+        hitch->checksum = Simulation_Checksum(state);
+
+        // Números do painel de desempenho conhecidos pela thread principal. Os do desenho são preenchidos por RenderFramePacket().
+        packet.show_hud = g_ShowHud;
+        if (g_ShowHud)
+        {
+            HudFrame& hud = packet.hud;
+            hud.simulation_ms = simulationMs;
+            hud.streaming_ms = stats.streaming_ms;
+            hud.collisions_ms = stats.collisions_ms;
+            hud.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+            hud.visible_objects = (uint32_t)packet.draws.size();
+            hud.culled_objects = state.started ? activeAsteroids + level.num_group_members - asteroidsDrawn : 0;
+            hud.heap_allocations = frameAllocations;
+            hud.texture_bytes = g_TextureBytes;
+            hud.buffer_bytes = g_BufferBytes;
+            hud.lod_bias = g_Governor.lod_bias;
+            hud.effects = g_Governor.effects;
+            hud.quality_changes = g_Governor.changes;
+        }
 
-            PushMatrix(model);
-            if(shouldRenderSphere[1])
+        if (g_Benchmark)
+        {
+            BenchmarkFrame& systems = benchmark.frames[benchmarkFrame];
+            systems.simulation_ms = simulationMs;
+            systems.streaming_ms = stats.streaming_ms;
+            systems.collisions_ms = stats.collisions_ms;
+            systems.active_asteroids = activeAsteroids;
+            systems.heap_allocations = frameAllocations;
+
+            // No modo de instrumentação, também as alocações de cada categoria e o pico de memória do quadro.
+            MemStats heapNow;
+            MemTrack_Snapshot(&heapNow);
+            for (int t = 0; t < MEMTAG_COUNT; ++t)
             {
-                model = model*Matrix_Translate(asteroidsGroup[1].x, asteroidsGroup[1].y, asteroidsGroup[1].z)*Matrix_Scale(1.0f/300.0f, 1.0f/300.0f, 1.0f/300.0f);
-                glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                glUniform1i(g_object_id_uniform, ASTEROID);
-                DrawVirtualObject("asteroid");
+                systems.heap_tag_allocations[t] = (uint32_t)(heapNow.tags[t].allocations - heapStats.tags[t].allocations);
+                systems.heap_tag_bytes[t] = heapNow.tags[t].bytes - heapStats.tags[t].bytes;
             }
-            PopMatrix(model);
+            systems.heap_bytes = heapNow.bytes - heapStats.bytes;
+            systems.heap_peak_bytes = heapNow.peak_bytes;
+            heapStats = heapNow;
+            MemTrack_ResetPeak();
+
+            // Os tempos de desenho e da GPU são medidos por RenderFramePacket().
+            packet.benchmark = &benchmark;
+            packet.benchmark_frame = benchmarkFrame;
+            packet.frame_start = currentFrame;
+            packet.cpu_ms = (GetTime() - currentFrame) * 1000.0;
+            packet.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+            benchmarkFrame += 1;
+        }
 
-            PushMatrix(model);
-            if(shouldRenderSphere[2])
+        // Lemos a entrada da câmera mais uma vez, o mais perto possível da entrega do quadro: o cursor do mouse
+        // ou, no benchmark, a curva percorrida pela câmera. Ao reproduzir uma gravação, o cursor é ignorado.
+        if (packet.latch_camera)
+        {
+            PROFILE_SCOPE("Late latching");
+            double cursorX = g_Input.last_cursor_x, cursorY = g_Input.last_cursor_y;
+            if (window != NULL && !g_Replaying && !g_Benchmark)
+                glfwGetCursorPos(window, &cursorX, &cursorY);
+            glm::vec3 front = Simulation_LatestCameraFront(state, g_Input, cursorX, cursorY);
+            if (g_Benchmark)
             {
-                model = model*Matrix_Translate(asteroidsGroup[2].x, asteroidsGroup[2].y, asteroidsGroup[2].z)*Matrix_Scale(1.0f/150.0f, 1.0f/150.0f, 1.0f/150.0f);
-                glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                glUniform1i(g_object_id_uniform, ASTEROID);
-                DrawVirtualObject("asteroid");
+                glm::vec3 position;
+                Benchmark_Camera(&benchmark, packet.benchmark_frame, &position, &front);
             }
-            PopMatrix(model);
+            LatchCameraView(packet, front);
+            packet.input_time = GetTime();
+        }
 
-            // Desenhamos modelo da nave
+        // Desenhamos o quadro agora ou, com a thread de renderização, enquanto simulamos o próximo.
+        if (g_UseRenderThread)
+            RenderThread_Submit(&g_RenderThread);
+        else
+            RenderFramePacket(packet, window, &offscreen);
+        renderedFrames += 1;
+        MemTrack_SetTag(MEMTAG_OTHER);
+
+        // Esperamos o instante do próximo quadro e verificamos com o sistema operacional se houve alguma interação do usuário
+        // (teclado, mouse, ...). Caso positivo, as funções de callback definidas anteriormente usando glfwSet*Callback() serão
+        // chamadas pela biblioteca GLFW. Na tela de início, sem foco ou com a janela minimizada, esperamos pelos eventos.
+        pacedSeconds = FramePacer_Wait(&g_FramePacer, window, !state.started);
+        if (g_TraceRequested)
+        {
+            g_TraceRequested = false;
+            Profiler_WriteTrace(g_TraceFilename.c_str(), g_TraceFrames);
+        }
+    }
 
-            if (g_IsFreeCamera){
-                model = Matrix_Translate(0,0,-18)*Matrix_Rotate_Y(3.141592)*Matrix_Rotate_Z(barrelRollAngle);;
-                glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE , glm::value_ptr(model));
-                glUniformMatrix4fv(g_view_uniform, 1, GL_FALSE, glm::value_ptr(identity));
-                glUniform1i(g_object_id_uniform, SPACESHIP);
-                DrawVirtualObject("the_spaceship");
-            }
+    // Esperamos os quadros pendentes e trazemos o contexto OpenGL de volta para a thread principal.
+    if (g_UseRenderThread)
+    {
+        RenderThread_Stop(&g_RenderThread);
+        attachContext();
+    }
+    for (int i = 0; i < 2; ++i)
+        Arena_Shutdown(&g_FramePackets[i].arena);
+    GpuTimer_Shutdown(&g_GpuTimer);
+    Hud_Shutdown(&g_Hud);
+    SceneTarget_Shutdown(&g_SceneTarget);
+    FramePacer_Shutdown(&g_FramePacer);
+    if (g_TraceAtExit)
+        Profiler_WriteTrace(g_TraceFilename.c_str(), g_TraceFrames);
 
+    // Finalizamos o uso dos recursos do sistema operacional
+    Replay_StopRecording(&g_InputLog, (uint32_t)state.tick);
+    if (checksums != NULL)
+        fclose(checksums);
+    LevelStreamer_Shutdown(&streamer);
+    Level_Unload(&level);
+    if (g_StressMaxAsteroids > 0)
+        Level_Unload(&stressBase);
+    if (g_SoftwareRenderer)
+        SoftRender_Shutdown(&g_SoftRenderer);
+    if (window != NULL)
+        glfwTerminate();
+    else
+        Offscreen_Shutdown(&offscreen);
+    Jobs_Shutdown(g_Jobs);
 
-            float offsetValue = -1.5; //nave eh maior pra tras que pra frente,
+    // Fim do programa
+    return 0;
+}
 
-            glm::vec3 shipOffset = glm::vec3(camera_view_vector.x * offsetValue,
-                                           camera_view_vector.y * offsetValue,
-                                           camera_view_vector.z * offsetValue);
+// Tarefas que fazem a leitura das imagens de textura do disco (AssetLoading::textures). As imagens são
+// invertidas verticalmente, conforme stbi_set_flip_vertically_on_load(), chamada antes de submeter as tarefas.
+void DecodeTextureImages(void* data, uint32_t begin, uint32_t end)
+{
+    AssetLoading* assets = (AssetLoading*)data;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        PROFILE_SCOPE("Decodificar textura");
+        TextureImage& image = assets->textures[i];
+        int channels;
+        image.data = stbi_load(image.filename, &image.width, &image.height, &channels, 3);
+    }
+}
 
+// Tarefas que carregam os modelos OBJ (AssetLoading::model_filenames) e computam suas normais.
+void LoadObjModels(void* data, uint32_t begin, uint32_t end)
+{
+    AssetLoading* assets = (AssetLoading*)data;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        PROFILE_SCOPE("Carregar modelo");
+        ObjModel* model = new ObjModel(assets->model_filenames[i]);
+        ComputeNormals(model);
+        assets->models[i] = model;
+    }
+}
 
-            glm::vec3 shipPosition = glm::vec3(camera_position_c.x, camera_position_c.y, camera_position_c.z)
-                                    - glm::vec3(camera_view_vector.x * -18, camera_view_vector.y * -18, camera_view_vector.z * -18)
-                                    + shipOffset;
+// Função que envia para a GPU uma imagem lida por DecodeTextureImages(), para ser utilizada como textura
+void LoadTextureImage(const TextureImage& image)
+{
+    printf("Carregando imagem \"%s\"... ", image.filename);
 
+    unsigned char* data = image.data;
+    int width = image.width;
+    int height = image.height;
 
-            BoundingSphere shipBoundingSphere  = { shipPosition, 4.0f };
+    if ( data == NULL )
+    {
+        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", image.filename);
+        std::exit(EXIT_FAILURE);
+    }
 
-            // verifica foguete vs asteroides
-            if (rocketStartTime)
-            {
-                glm::vec3 cubeDimensions = glm::vec3(5.0f, 5.0f, 5.0f);
+    printf("OK (%dx%d).\n", width, height);
 
-                glm::vec3 lowerBackLeft =  currentMissilePosition - cubeDimensions * 0.5f;
-                glm::vec3 upperFrontRight = currentMissilePosition + cubeDimensions * 0.5f;
+    if (g_SoftwareRenderer)
+        SoftRender_AddTexture(&g_SoftRenderer, data, width, height);
 
-                BoundingCube MissileBoundingSphere = { lowerBackLeft, upperFrontRight };
+    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
+    GLuint texture_id;
+    GLuint sampler_id;
+    glGenTextures(1, &texture_id);
+    glGenSamplers(1, &sampler_id);
 
-                for(int i = 0; i < NUM_ASTEROIDS; ++i)
-                {
-                    if (checkSphereCubeCollision(asteroidBoundingSpheres[i], MissileBoundingSphere))
-                    {
-                        asteroidBoundingSpheres[i].center = glm::vec3(999.0f,999.0f, 999.0f); //'deleta' a esfera
-                        shouldRenderSphere[i] = false;
-                    }
-                }
-            }
+    // Veja slides 95-96 do documento Aula_20_Mapeamento_de_Texturas.pdf
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-            // verifica nave vs asteroides
-            for(int i = 0; i < NUM_ASTEROIDS; ++i)
-            {
-                if (checkSphereSphereCollision(shipBoundingSphere, asteroidBoundingSpheres[i]))
-                {
-                    g_StartGame = false;
-                    g_Reboot = true;
-                    printf("Perdeu. Moedas coletadas: %d. Tempo: %2fs.\n", g_nextCoin, currentFrame-g_StartGameTime);
-                }
-            }
+    // Parâmetros de amostragem da textura.
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-            if (g_nextCoin < NUM_COINS)
-            {
-                // verifica nave vs próxima moeda
-                if (checkSphereCircleCollision(shipBoundingSphere, coinBoundingSpheres[g_nextCoin]))
-                {
-                    shouldRenderCoin[g_nextCoin] = false;
-                    g_nextCoin++;
-                }
-            }
-            else
+    // Agora enviamos a imagem lida do disco para a GPU
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    GLuint textureunit = g_NumLoadedTextures;
+    glActiveTexture(GL_TEXTURE0 + textureunit);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    GL_LABEL(GL_TEXTURE, texture_id, image.filename);
+    g_TextureBytes += (uint64_t)width * height * 3 * 4 / 3;  // Estimativa: 3 bytes por texel, mais 1/3 para os mipmaps
+    glBindSampler(textureunit, sampler_id);
+
+    stbi_image_free(data);
+
+    g_NumLoadedTextures += 1;
+}
+
+// Tarefas de visibilidade dos asteroides estáticos: cada índice é um setor ativo, cujos asteroides não destruídos
+// e dentro da pirâmide de visão são guardados em AsteroidCulling::sector_visible. As matrizes de modelagem de um setor
+// são calculadas uma única vez, na primeira vez que ele é processado, e guardadas no próprio setor.
+// Com LOD bias (veja "include/governor.h"), asteroides cuja projeção na tela é pequena demais não são desenhados.
+static bool TooSmallToDraw(const AsteroidCulling* culling, const BoundingSphere& bounds)
+{
+    if (culling->min_pixels <= 0.0f)
+        return false;
+    glm::vec3 offset = bounds.center - culling->camera_position;
+    float pixels = bounds.radius * culling->focal_pixels;
+    return pixels * pixels < culling->min_pixels * culling->min_pixels * glm::dot(offset, offset);
+}
+
+void CullSectorAsteroids(void* data, uint32_t begin, uint32_t end)
+{
+    PROFILE_SCOPE("Visibilidade dos setores");
+    AsteroidCulling* culling = (AsteroidCulling*)data;
+    static thread_local std::vector<float> x, y, z, scale;
+    for (uint32_t s = begin; s < end; ++s)
+    {
+        StreamedSector* sector = (*culling->sectors)[s];
+        uint32_t count = (uint32_t)sector->asteroids.size();
+        if (sector->models.size() != count)
+        {
+            // Feito uma única vez por setor ativado: faz parte do carregamento dele.
+            MEMTRACK_SCOPE(MEMTAG_LOADING);
+            x.resize(count);
+            y.resize(count);
+            z.resize(count);
+            scale.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
             {
-                // se coletou todas as moedas, jogo termina
-                g_StartGame = false;
-                g_Reboot = true;
-                printf("Ganhou. Moedas coletadas: %d. Tempo: %2fs.\n", g_nextCoin, currentFrame-g_StartGameTime);
+                const LevelAsteroid& asteroid = sector->asteroids[i];
+                x[i] = asteroid.x;
+                y[i] = asteroid.y;
+                z[i] = asteroid.z;
+                scale[i] = asteroid.scale;
             }
+            sector->models.resize(count);
+            TransformArrays transforms = { x.data(), y.data(), z.data(), scale.data(), NULL, NULL, NULL, NULL };
+            Matrix_BuildModels(transforms, count, sector->models.data());
         }
-        else
+
+        VisibleAsteroids& visible = culling->sector_visible[s];
+        visible.count = 0;
+        for (uint32_t i = 0; i < count; ++i)
         {
-            if (g_Reboot)
-            {
-                g_IsFreeCamera = true;
-                g_FreeCameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-                g_FreeCameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
-                g_FreeCameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-                g_CameraSpeed = 0.5f;
-                g_left_right_movement = -90.0f;
-                g_up_down_movement = 0.0f;
-                g_nextCoin = 0;
-                meteorStartTime = 0;
-                rocketStartTime = 0;
-                shouldRenderSphere = vector<bool>(NUM_ASTEROIDS, true);
-                shouldRenderCoin = vector<bool>(NUM_COINS, true);
-                g_Reboot = false;
-            }
+            if (culling->state->destroyed_asteroids.count(sector->first_asteroid + i))
+                continue;
+
+            const LevelAsteroid& asteroid = sector->asteroids[i];
+            BoundingSphere bounds = { glm::vec3(asteroid.x, asteroid.y, asteroid.z), culling->model_radius * asteroid.scale };
+            if (checkSphereFrustumCollision(bounds, culling->frustum) && !TooSmallToDraw(culling, bounds))
+                visible.models[visible.count++] = &sector->models[i];
         }
+    }
+}
 
+// Tarefas de visibilidade dos asteroides que se movem em grupo: cada índice é um membro do grupo.
+void CullGroupAsteroids(void* data, uint32_t begin, uint32_t end)
+{
+    PROFILE_SCOPE("Visibilidade do grupo");
+    AsteroidCulling* culling = (AsteroidCulling*)data;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        culling->group_visible[i] = 0;
+        if (culling->state->destroyed_members[i])
+            continue;
+
+        const glm::mat4& model = SceneGraph_World(culling->graph, culling->first_member + i);
+        BoundingSphere bounds = { glm::vec3(model[3]), culling->model_radius * culling->level->group[i].scale };
+        if (checkSphereFrustumCollision(bounds, culling->frustum) && !TooSmallToDraw(culling, bounds))
+            culling->group_visible[i] = 1;
+    }
+}
 
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cria o grafo de cena do nível: as raízes (o grupo de asteroides e as moedas) e, em seguida, os membros do grupo.
+void BuildLevelSceneGraph(const Level& level)
+{
+    SceneGraph_Init(&g_SceneGraph);
 
-        // Imprimimos na tela informação sobre o número de quadros renderizados por segundo (frames per second).
-        TextRendering_ShowFramesPerSecond(window);
-        TextRendering_ShowStartGame(window);
+    g_SceneNodes.group = SceneGraph_AddNode(&g_SceneGraph, -1, Matrix_Translate(level.group_origin[0], level.group_origin[1], level.group_origin[2]));
+    g_SceneNodes.first_coin = (int32_t)g_SceneGraph.parent.size();
+    for (uint32_t i = 0; i < level.num_coins; ++i)
+        SceneGraph_AddNode(&g_SceneGraph, -1, Matrix_TranslateScale(level.coins[i].x, level.coins[i].y, level.coins[i].z, 1.0f, 1.0f, 0.2f));
 
-        // O framebuffer onde OpenGL executa as operações de renderização não é o mesmo que está sendo mostrado para o usuário, caso contrário
-        // seria possível ver artefatos conhecidos como "screen tearing". A chamada abaixo faz a troca dos buffers, mostrando para o usuário
-        // tudo que foi renderizado pelas funções acima.
-        // Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
-        glfwSwapBuffers(window);
+    g_SceneNodes.first_member = (int32_t)g_SceneGraph.parent.size();
+    for (uint32_t i = 0; i < level.num_group_members; ++i)
+    {
+        const LevelGroupMember& member = level.group[i];
+        SceneGraph_AddNode(&g_SceneGraph, g_SceneNodes.group, Matrix_TranslateScale(member.x, member.y, member.z, member.scale, member.scale, member.scale));
+    }
+    SceneGraph_Update(&g_SceneGraph);
+}
+
+// Função que registra o desenho de um objeto armazenado em g_VirtualScene no pacote do quadro atual, com os valores
+// definidos por SetModelMatrix() e demais funções abaixo. O desenho é feito depois, por ExecuteDrawCommand().
+void DrawVirtualObject(const char* object_name)
+{
+    DrawVirtualObject(g_VirtualScene[object_name]);
+}
+
+void DrawVirtualObject(const SceneObject& object)
+{
+    DrawCommand command;
+    command.object = &object;
+    command.model = g_DrawModel;
+    command.view = g_DrawView;
+    command.projection = g_DrawProjection;
+    command.object_id = g_DrawObjectId;
+    command.culling_and_depth_test = g_DrawCullingAndDepthTest;
+    command.scene_camera = g_DrawSceneCamera;
+    command.gpu_pass = g_DrawGpuPass;
+    g_FramePacket->draws.push_back(command);
+}
+
+// Funções que definem os valores dos "uniforms" e dos estados usados pelos próximos DrawVirtualObject().
+void SetModelMatrix(const glm::mat4& model)
+{
+    g_DrawModel = model;
+}
+
+void SetViewMatrix(const glm::mat4& view, bool scene_camera)
+{
+    g_DrawView = view;
+    g_DrawSceneCamera = scene_camera;
+}
+
+void SetProjectionMatrix(const glm::mat4& projection)
+{
+    g_DrawProjection = projection;
+}
+
+void SetObjectId(int object_id)
+{
+    g_DrawObjectId = object_id;
+}
+
+// Desligado apenas para a esfera do fundo, desenhada por trás de tudo.
+void SetCullingAndDepthTest(bool enabled)
+{
+    g_DrawCullingAndDepthTest = enabled;
+}
+
+void SetGpuPass(GpuPass pass)
+{
+    g_DrawGpuPass = pass;
+}
+
+// Recalcula a matriz "view" de um quadro já descrito com a câmera virada para "front" e a substitui nos comandos que
+// usam a câmera da cena (a nave, desenhada no sistema de coordenadas da câmera, não muda). A visibilidade dos
+// asteroides foi calculada com a câmera anterior: como a diferença é apenas o movimento do mouse durante a descrição
+// do quadro, no pior caso um asteroide na borda da tela aparece um quadro depois.
+void LatchCameraView(FramePacket& packet, const glm::vec3& front)
+{
+    glm::quat orientation = glm::quatLookAt(front, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 view_vector = glm::vec4(orientation * glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+    glm::vec4 up_vector = glm::vec4(orientation * glm::vec3(0.0f, 1.0f, 0.0f), 0.0f);
+    glm::mat4 view = Matrix_Camera_View(packet.camera_position, view_vector, up_vector);
+
+    for (size_t i = 0; i < packet.draws.size(); ++i)
+    {
+        if (packet.draws[i].scene_camera)
+            packet.draws[i].view = view;
+    }
+}
+
+// Valores já enviados à GPU no quadro atual (veja ExecuteDrawCommand()). Zerado por RenderFramePacket().
+struct SentDrawState
+{
+    bool      valid;
+    glm::mat4 view, projection;
+    int       object_id;
+    bool      culling_and_depth_test;
+};
+SentDrawState g_SentDrawState;
 
-        // Verificamos com o sistema operacional se houve alguma interação do usuário (teclado, mouse, ...). Caso positivo, as funções de callback
-        // definidas anteriormente usando glfwSet*Callback() serão chamadas pela biblioteca GLFW.
-        glfwPollEvents();
+// Função que desenha um objeto registrado por DrawVirtualObject().
+void ExecuteDrawCommand(const DrawCommand& command)
+{
+    const SceneObject& object = *command.object;
+
+    // No rasterizador por software, o objeto é apenas registrado e desenhado no fim do quadro.
+    if (g_SoftwareRenderer)
+    {
+        SoftDraw draw;
+        draw.mesh = object.soft_mesh;
+        draw.first_vertex = (uint32_t)object.first_index;
+        draw.num_vertices = (uint32_t)object.num_indices;
+        draw.model = command.model;
+        draw.view = command.view;
+        draw.projection = command.projection;
+        draw.object_id = command.object_id;
+        draw.bbox_min = glm::vec4(object.bbox_min, 1.0f);
+        draw.bbox_max = glm::vec4(object.bbox_max, 1.0f);
+        draw.cull = command.culling_and_depth_test;
+        draw.depth_test = command.culling_and_depth_test;
+        SoftRender_Draw(&g_SoftRenderer, draw);
+
+        g_RenderCounters.draw_calls += 1;
+        g_RenderCounters.triangles += object.num_indices / 3;
+        return;
     }
 
-    // Finalizamos o uso dos recursos do sistema operacional
-    glfwTerminate();
+    // Enviamos aos shaders a matriz de modelagem e, apenas quando mudam entre objetos, os demais valores.
+    SentDrawState& sent = g_SentDrawState;
+    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(command.model));
+    if (!sent.valid || command.view != sent.view)
+    {
+        glUniformMatrix4fv(g_view_uniform, 1, GL_FALSE, glm::value_ptr(command.view));
+        g_RenderCounters.state_changes += 1;
+    }
+    if (!sent.valid || command.projection != sent.projection)
+    {
+        glUniformMatrix4fv(g_projection_uniform, 1, GL_FALSE, glm::value_ptr(command.projection));
+        g_RenderCounters.state_changes += 1;
+    }
+    if (!sent.valid || command.object_id != sent.object_id)
+    {
+        glUniform1i(g_object_id_uniform, command.object_id);
+        g_RenderCounters.state_changes += 1;
+    }
+    if (!sent.valid || command.culling_and_depth_test != sent.culling_and_depth_test)
+    {
+        g_RenderCounters.state_changes += 1;
+        if (command.culling_and_depth_test)
+        {
+            glEnable(GL_CULL_FACE);
+            glEnable(GL_DEPTH_TEST);
+        }
+        else
+        {
+            glDisable(GL_CULL_FACE);
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+    sent.valid = true;
+    sent.view = command.view;
+    sent.projection = command.projection;
+    sent.object_id = command.object_id;
+    sent.culling_and_depth_test = command.culling_and_depth_test;
 
-    // Fim do programa
-    return 0;
+    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene().
+    glBindVertexArray(object.vertex_array_object_id);
+
+    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader com os parâmetros da axis-aligned bounding box (AABB) do modelo.
+    glUniform4f(g_bbox_min_uniform, object.bbox_min.x, object.bbox_min.y, object.bbox_min.z, 1.0f);
+    glUniform4f(g_bbox_max_uniform, object.bbox_max.x, object.bbox_max.y, object.bbox_max.z, 1.0f);
+
+    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ apontados pelo VAO como linhas.
+    glDrawElements(
+        object.rendering_mode,
+        object.num_indices,
+        GL_UNSIGNED_INT,
+        (void*)(object.first_index * sizeof(GLuint))
+    );
+    g_RenderCounters.draw_calls += 1;
+    g_RenderCounters.triangles += object.num_indices / 3;
+
+    // "Desligamos" o VAO, evitando assim que operações posteriores venham a alterar o mesmo. Isso evita bugs.
+    glBindVertexArray(0);
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char* filename)
+// Função que desenha um quadro descrito pelo laço principal. Chamada pela thread dona do contexto OpenGL.
+void RenderFramePacket(FramePacket& packet, GLFWwindow* window, Offscreen* offscreen)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    MEMTRACK_SCOPE(MEMTAG_RENDER);
+    PROFILE_SCOPE("Desenho do quadro");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    g_RenderCounters.draw_calls = 0;
+    g_RenderCounters.triangles = 0;
+    g_RenderCounters.state_changes = 0;
+    if (packet.benchmark != NULL)
+        Benchmark_BeginFrame(packet.benchmark, packet.benchmark_frame, packet.frame_start);
+
+    // Começamos a medir os passos deste quadro e guardamos os tempos de um quadro anterior, se já estiverem prontos.
+    GpuTimerResult gpuTimes;
+    if (GpuTimer_BeginFrame(&g_GpuTimer, packet.benchmark != NULL ? packet.benchmark_frame : -1, &gpuTimes))
+        StoreGpuTimes(gpuTimes, packet.benchmark);
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    // Indicamos que queremos renderizar em toda região do framebuffer. A função "glViewport" define o mapeamento das "normalized device coordinates" (NDC) para "pixel coordinates".
+    // Com escala menor que 1, a cena é desenhada em uma região menor de um framebuffer intermediário e ampliada depois
+    // (veja "include/scenetarget.h"); o rasterizador por software desenha direto na resolução menor.
+    int sceneWidth, sceneHeight;
+    SceneTarget_Size(packet.framebuffer_width, packet.framebuffer_height, packet.resolution_scale, &sceneWidth, &sceneHeight);
+    if (g_SoftwareRenderer)
+        glViewport(0, 0, packet.framebuffer_width, packet.framebuffer_height);
+    else
+        SceneTarget_Begin(&g_SceneTarget, packet.framebuffer_width, packet.framebuffer_height, packet.resolution_scale);
 
-    if ( data == NULL )
+    // Definimos a cor do "fundo" do framebuffer como branco (ou preto, sem a esfera do céu).
+    //           R     G     B     A
+    float background = packet.draw_sky ? 1.0f : 0.0f;
+    glClearColor(background, background, background, 1.0f);
+
+    // "Pintamos" todos os pixels do framebuffer com a cor definida acima, e também resetamos todos os pixels do Z-buffer (depth buffer).
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (g_SoftwareRenderer)
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
+        g_SoftRenderer.clear_color = packet.draw_sky ? 0xFFFFFFFFu : 0xFF000000u;
+        SoftRender_BeginFrame(&g_SoftRenderer, sceneWidth, sceneHeight);
     }
 
-    printf("OK (%dx%d).\n", width, height);
+    // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo os shaders de vértice e fragmentos).
+    glUseProgram(g_GpuProgramID);
+    g_RenderCounters.state_changes += 1;
 
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
-    GLuint sampler_id;
-    glGenTextures(1, &texture_id);
-    glGenSamplers(1, &sampler_id);
+    g_SentDrawState.valid = false;
+    {
+        PROFILE_SCOPE("Comandos de desenho");
+        GL_DEBUG_GROUP("Cena");
+        int pass = -1;
+        for (size_t i = 0; i < packet.draws.size(); ++i)
+        {
+            const DrawCommand& command = packet.draws[i];
+            if (command.gpu_pass != pass)
+            {
+                // Cada passo também é um grupo nas ferramentas de depuração do OpenGL.
+                if (pass != -1)
+                    GL_DEBUG_POP();
+                GL_DEBUG_PUSH(GpuTimer_PassName(command.gpu_pass));
+                pass = command.gpu_pass;
+                GpuTimer_Mark(&g_GpuTimer, command.gpu_pass);
+            }
+            ExecuteDrawCommand(command);
+        }
+        if (pass != -1)
+            GL_DEBUG_POP();
+        GpuTimer_Mark(&g_GpuTimer, GPUPASS_NONE);
+    }
 
-    // Veja slides 95-96 do documento Aula_20_Mapeamento_de_Texturas.pdf
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Com o rasterizador por software, desenhamos agora a cena registrada acima e a copiamos para o framebuffer.
+    if (g_SoftwareRenderer)
+    {
+        PROFILE_SCOPE("Rasterizador por software");
+        GL_DEBUG_GROUP("Rasterizador por software");
+        SoftRender_EndFrame(&g_SoftRenderer);
+        SoftRender_Present(&g_SoftRenderer);
+    }
+    else
+    {
+        GL_DEBUG_GROUP("Ampliação da cena");
+        SceneTarget_Resolve(&g_SceneTarget);
+    }
 
-    // Parâmetros de amostragem da textura.
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Imprimimos na tela informação sobre o número de quadros renderizados por segundo (frames per second). A GLFW
+    // só permite consultar o tamanho da janela na thread principal; nas outras o texto usa o tamanho do viewport.
+    GLFWwindow* textWindow = g_UseRenderThread ? NULL : window;
+    {
+        MEMTRACK_SCOPE(MEMTAG_TEXT);
+        PROFILE_SCOPE("Texto");
+        GL_DEBUG_GROUP("Texto");
+        GpuTimer_Mark(&g_GpuTimer, GPUPASS_TEXT);
+        if (!packet.show_hud)
+            TextRendering_ShowFramesPerSecond(textWindow);
+        if (packet.show_start_game)
+            TextRendering_ShowStartGame(textWindow);
+    }
+    GpuTimer_EndFrame(&g_GpuTimer);
 
-    // Agora enviamos a imagem lida do disco para a GPU
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    double renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    packet.counters = g_RenderCounters;
+    packet.rendered = true;
+    if (packet.benchmark != NULL)
+    {
+        packet.benchmark->frames[packet.benchmark_frame].render_ms = packet.build_ms + renderMs;
+        Benchmark_EndFrame(packet.benchmark, packet.benchmark_frame, packet.cpu_ms + renderMs);
+    }
 
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    // O painel de desempenho é desenhado depois de todas as medições do quadro, para não aparecer nelas.
+    if (packet.show_hud)
+    {
+        PROFILE_SCOPE("Painel de desempenho");
+        GL_DEBUG_GROUP("Painel de desempenho");
+        HudFrame hud = packet.hud;
+        hud.render_ms = renderMs;
+        hud.cpu_ms = hud.simulation_ms + hud.build_ms + renderMs;
+        hud.draw_calls = g_RenderCounters.draw_calls;
+        hud.triangles = g_RenderCounters.triangles;
+        hud.state_changes = g_RenderCounters.state_changes;
+        hud.latency_ms = g_InputLatencyMs;
+        hud.resolution_scale = packet.resolution_scale;
+        hud.scene_width = sceneWidth;
+        hud.scene_height = sceneHeight;
+        Hud_Draw(&g_Hud, hud, packet.framebuffer_width, packet.framebuffer_height);
+    }
 
-    stbi_image_free(data);
+    // O framebuffer onde OpenGL executa as operações de renderização não é o mesmo que está sendo mostrado para o usuário, caso contrário
+    // seria possível ver artefatos conhecidos como "screen tearing". A chamada abaixo faz a troca dos buffers, mostrando para o usuário
+    // tudo que foi renderizado pelas funções acima.
+    // Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
+    if (window != NULL)
+    {
+        PROFILE_SCOPE("glfwSwapBuffers");
+        glfwSwapBuffers(window);
+    }
+    else
+    {
+        // Sem janela, gravamos o quadro (opção --dump-frames) antes de entregar os comandos do próximo.
+        if (!g_DumpFramesDirectory.empty() && packet.frame % g_DumpEvery == 0)
+        {
+            char filename[32];
+            snprintf(filename, sizeof(filename), "/frame_%05d.ppm", packet.frame);
+            if (!Offscreen_SaveFrame(offscreen, (g_DumpFramesDirectory + filename).c_str()))
+                std::exit(EXIT_FAILURE);
+        }
+        PROFILE_SCOPE("Offscreen_EndFrame");
+        Offscreen_EndFrame(offscreen);
+    }
 
-    g_NumLoadedTextures += 1;
+    // Latência da entrada: da leitura da entrada usada pelo quadro até a volta da troca de buffers.
+    g_InputLatencyMs = (GetTime() - packet.input_time) * 1000.0;
+    if (packet.benchmark != NULL)
+        packet.benchmark->frames[packet.benchmark_frame].latency_ms = g_InputLatencyMs;
 }
 
-// Função que desenha um objeto armazenado em g_VirtualScene.
-void DrawVirtualObject(const char* object_name)
+// Guarda os tempos de GPU de um quadro já lido: no trace do profiler, no painel de desempenho e, no benchmark (se "benchmark" não for NULL),
+// no quadro medido. Chamada pela thread que desenha.
+void StoreGpuTimes(const GpuTimerResult& result, void* benchmark)
 {
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
+#ifndef PROFILER_DISABLE
+    for (int i = 0; i + 1 < result.num_marks; ++i)
+    {
+        if (result.passes[i] != GPUPASS_NONE)
+            Profiler_RecordTrack(g_GpuTrack, GpuTimer_PassName((GpuPass)result.passes[i]), result.cpu_times[i], result.cpu_times[i + 1]);
+    }
+#endif
 
-    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
+    double total = 0.0;
+    for (int p = 0; p < GPUPASS_COUNT; ++p)
+        total += result.pass_ms[p];
+    Hud_AddGpuFrame(&g_Hud, total);
 
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ apontados pelo VAO como linhas.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
-    );
+    Benchmark* measured = (Benchmark*)benchmark;
+    if (measured != NULL && result.tag >= 0 && result.tag < measured->num_frames)
+    {
+        BenchmarkFrame& frame = measured->frames[result.tag];
+        for (int p = 0; p < GPUPASS_COUNT; ++p)
+            frame.gpu_pass_ms[p] = result.pass_ms[p];
+        frame.gpu_passes_valid = true;
+    }
+}
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+// Executa na thread de renderização, se ela existir, código OpenGL que não faz parte de um quadro (relatórios do
+// benchmark, por exemplo). A thread principal espera os quadros pendentes e o fim da execução.
+void RunOnRenderThread(const std::function<void()>& function)
+{
+    if (g_UseRenderThread)
+        RenderThread_Call(&g_RenderThread, function);
+    else
+        function();
 }
 
 // Função que carrega os shaders de vértices e de fragmentos que serão utilizados para renderização.
 void LoadShadersFromFiles()
 {
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
+    std::string vertex_source = LoadShaderSource("../../src/shader_vertex.glsl");
+    std::string fragment_source = LoadShaderSource("../../src/shader_fragment.glsl");
 
     // Deletamos o programa de GPU anterior, caso ele exista.
     if ( g_GpuProgramID != 0 )
         glDeleteProgram(g_GpuProgramID);
 
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    // Criamos um programa de GPU utilizando os shaders carregados acima (ou o lemos do cache). As variáveis dos
+    // shaders são buscadas em LoadShaderUniforms(), quando o programa estiver pronto.
+    g_GpuProgramID = ShaderCache_SubmitProgram("shader_vertex.glsl/shader_fragment.glsl", vertex_source.c_str(),
+                                               fragment_source.c_str(), LoadShaderUniforms, NULL);
+}
 
+// Chamada por ShaderCache_FinishAll() quando o programa de GPU criado em LoadShadersFromFiles() está ligado.
+void LoadShaderUniforms(GLuint program_id, void* data)
+{
     // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
     // Utilizaremos estas variáveis para enviar dados para a placa de vídeo (GPU)!
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model");       // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view");        // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection");  // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id");   // Variável "object_id" em shader_fragment.glsl
-    g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
-    g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
+    g_model_uniform      = glGetUniformLocation(program_id, "model");       // Variável da matriz "model"
+    g_view_uniform       = glGetUniformLocation(program_id, "view");        // Variável da matriz "view" em shader_vertex.glsl
+    g_projection_uniform = glGetUniformLocation(program_id, "projection");  // Variável da matriz "projection" em shader_vertex.glsl
+    g_object_id_uniform  = glGetUniformLocation(program_id, "object_id");   // Variável "object_id" em shader_fragment.glsl
+    g_bbox_min_uniform   = glGetUniformLocation(program_id, "bbox_min");
+    g_bbox_max_uniform   = glGetUniformLocation(program_id, "bbox_max");
 
     // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage0"), 0);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage1"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage2"), 2);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage3"), 3);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage4"), 4);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage5"), 5);
+    glUseProgram(program_id);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage1"), 1);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage2"), 2);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage3"), 3);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage4"), 4);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage5"), 5);
     glUseProgram(0);
 }
 
@@ -1090,6 +2012,7 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 
         theobject.bbox_min = bbox_min;
         theobject.bbox_max = bbox_max;
+        theobject.soft_mesh = (uint32_t)g_SoftRenderer.meshes.size();  // Malha adicionada abaixo, se o rasterizador por software estiver ativo
 
         g_VirtualScene[model->shapes[shape].name] = theobject;
     }
@@ -1140,41 +2063,25 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    g_BufferBytes += (model_coefficients.size() + normal_coefficients.size() + texture_coefficients.size()) * sizeof(float) + indices.size() * sizeof(GLuint);
+
+    // Nomes dos objetos nas mensagens do driver (opção --gl-debug): o nome do primeiro objeto do modelo.
+    GL_LABEL(GL_VERTEX_ARRAY, vertex_array_object_id, model->shapes[0].name.c_str());
+    GL_LABEL(GL_BUFFER, VBO_model_coefficients_id, (model->shapes[0].name + " (posições)").c_str());
+    GL_LABEL(GL_BUFFER, indices_id, (model->shapes[0].name + " (índices)").c_str());
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a alterar o mesmo. Isso evita bugs.
     glBindVertexArray(0);
-}
-
-// Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
-{
-    // Criamos um identificador (ID) para este shader, informando que o mesmo será aplicado nos vértices.
-    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-
-    // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
-
-    // Retorna o ID gerado acima
-    return vertex_shader_id;
-}
-
-// Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
-{
-    // Criamos um identificador (ID) para este shader, informando que o mesmo será aplicado nos fragmentos.
-    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
 
-    // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
-
-    // Retorna o ID gerado acima
-    return fragment_shader_id;
+    // O rasterizador por software guarda sua própria cópia dos vértices; os índices são sequenciais e não são necessários.
+    if (g_SoftwareRenderer)
+        SoftRender_AddMesh(&g_SoftRenderer, model_coefficients, normal_coefficients, texture_coefficients);
 }
 
-// Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+// Lê o código de um shader de um arquivo GLSL. A compilação é feita por ShaderCache_SubmitProgram().
+std::string LoadShaderSource(const char* filename)
 {
-    // Lemos o arquivo de texto indicado pela variável "filename" e colocamos seu conteúdo em memória, apontado pela variável "shader_string".
+    // Lemos o arquivo de texto indicado pela variável "filename" e colocamos seu conteúdo em memória.
     std::ifstream file;
     try {
         file.exceptions(std::ifstream::failbit);
@@ -1185,187 +2092,38 @@ void LoadShader(const char* filename, GLuint shader_id)
     }
     std::stringstream shader;
     shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
-
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
-
-    // Compila o código do shader GLSL (em tempo de execução)
-    glCompileShader(shader_id);
-
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation of \"";
-            output += filename;
-            output += "\" failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "WARNING: OpenGL compilation of \"";
-            output += filename;
-            output += "\".\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    delete [] log;
-}
-
-// Esta função cria um programa de GPU, o qual contém obrigatoriamente um Vertex Shader e um Fragment Shader.
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
-{
-    // Criamos um identificador (ID) para este programa de GPU
-    GLuint program_id = glCreateProgram();
-
-    // Definição dos dois shaders GLSL que devem ser executados pelo programa
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
-
-    // Linkagem dos shaders acima ao programa
-    glLinkProgram(program_id);
-
-    // Verificamos se ocorreu algum erro durante a linkagem
-    GLint linked_ok = GL_FALSE;
-    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
-
-    // Imprime no terminal qualquer erro de linkagem
-    if ( linked_ok == GL_FALSE )
-    {
-        GLint log_length = 0;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
-
-        // Alocamos memória para guardar o log de compilação.
-        GLchar* log = new GLchar[log_length];
-
-        glGetProgramInfoLog(program_id, log_length, &log_length, log);
-
-        std::string output;
-
-        output += "ERROR: OpenGL linking of program failed.\n";
-        output += "== Start of link log\n";
-        output += log;
-        output += "\n== End of link log\n";
-
-        delete [] log;
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    // Os "Shader Objects" podem ser marcados para deleção após serem linkados
-    glDeleteShader(vertex_shader_id);
-    glDeleteShader(fragment_shader_id);
-
-    // Retornamos o ID gerado acima
-    return program_id;
+    return shader.str();
 }
 
 // Definição da função que será chamada sempre que a janela do sistema operacional for redimensionada, por consequência alterando o tamanho do "framebuffer".
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    // Indicamos que queremos renderizar em toda região do framebuffer. A função "glViewport" define o mapeamento das "normalized device coordinates" (NDC) para "pixel coordinates".
-    glViewport(0, 0, width, height);
-
-    // Atualizamos também a razão que define a proporção da janela (largura / altura), a qual será utilizada na definição das matrizes de projeção.
+    // Atualizamos a razão que define a proporção da janela (largura / altura), a qual será utilizada na definição das matrizes de projeção.
     g_ScreenRatio = (float)width / height;
+    g_FramebufferWidth = width;
+    g_FramebufferHeight = height;
 }
 
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
-    {
-        // Se o usuário pressionou o botão esquerdo do mouse, guardamos a posição atual do cursor nas variáveis g_LastCursorPosX e g_LastCursorPosY.
-        // Também, setamos a variável g_LeftMouseButtonPressed como true, para saber que o usuário está com o botão esquerdo pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_LeftMouseButtonPressed = true;
-    }
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
-    {
-        // Quando o usuário soltar o botão esquerdo do mouse, atualizamos a variável abaixo para false.
-        g_LeftMouseButtonPressed = false;
-    }
-    if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
-    {
-        // Se o usuário pressionou o botão direito do mouse, guardamos a posição atual do cursor nas variáveis g_LastCursorPosX e g_LastCursorPosY.
-        // Também, setamos a variável g_RightMouseButtonPressed como true, para saber que o usuário está com o botão direito pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_RightMouseButtonPressed = true;
-    }
-    if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE)
-    {
-        // Quando o usuário soltar o botão direito do mouse, atualizamos a variável abaixo para false.
-        g_RightMouseButtonPressed = false;
-    }
-    if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS)
-    {
-        // Se o usuário pressionou o botão do meio do mouse, guardamos a posição atual do cursor nas variáveis g_LastCursorPosX e g_LastCursorPosY.
-        // Também, setamos a variável g_MiddleMouseButtonPressed como true, para saber que o usuário está com o botão do meio pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_MiddleMouseButtonPressed = true;
-    }
-    if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_RELEASE)
-    {
-        // Quando o usuário soltar o botão do meio do mouse, atualizamos a variável abaixo para false.
-        g_MiddleMouseButtonPressed = false;
-    }
+    if (g_Replaying || g_Benchmark)
+        return;
+
+    // Guardamos junto do evento a posição atual do cursor, de forma que a reprodução não dependa da janela.
+    InputEvent event = { 0, INPUT_EVENT_MOUSE_BUTTON, (uint8_t)action, (int16_t)button, 0.0, 0.0 };
+    glfwGetCursorPos(window, &event.x, &event.y);
+    g_PendingInput.push_back(event);
 }
 
 // Função callback chamada sempre que o usuário movimentar o cursor do mouse em cima da janela OpenGL.
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos)
 {
-	if (g_LeftMouseButtonPressed)
-	{
-		float dx = xpos - g_LastCursorPosX;
-		float dy = ypos - g_LastCursorPosY;
-        float sensitivity = 0.05f;
-        dx *= sensitivity;
-        dy *= sensitivity;
-
-        if (g_IsFreeCamera)
-        {
-            g_left_right_movement += dx;
-            g_up_down_movement -= dy;
-
-            if (g_up_down_movement > 89.0f)
-                g_up_down_movement = 89.0f;
-            if (g_up_down_movement < -89.0f)
-                g_up_down_movement = -89.0f;
-
-            glm::vec3 front;
-            front.x = cos(glm::radians(g_left_right_movement)) * cos(glm::radians(g_up_down_movement));
-            front.y = sin(glm::radians(g_up_down_movement));
-            front.z = sin(glm::radians(g_left_right_movement)) * cos(glm::radians(g_up_down_movement));
-            g_FreeCameraFront = front / norm(glm::vec4(front.x, front.y, front.z, 0));
-        }
-
-		g_LastCursorPosX = xpos;
-		g_LastCursorPosY = ypos;
-	}
+    if (g_Replaying || g_Benchmark)
+        return;
+
+    InputEvent event = { 0, INPUT_EVENT_CURSOR_POS, 0, 0, xpos, ypos };
+    g_PendingInput.push_back(event);
 }
 
 // Função callback chamada sempre que o usuário movimenta a "rodinha" do mouse.
@@ -1382,50 +2140,29 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
-    // Se o usuário apertar a tecla H, fazemos um "toggle" do texto informativo mostrado na tela.
+    // Se o usuário apertar a tecla H, alternamos entre o texto informativo, o painel de desempenho e nenhum dos dois.
     if (key == GLFW_KEY_H && action == GLFW_PRESS)
     {
-        g_ShowInfoText = !g_ShowInfoText;
-    }
-
-    // Se o usuário apertar a tecla F, fazemos um "toggle" do tipo de câmera.
-    if (key == GLFW_KEY_F && action == GLFW_PRESS)
-    {
-        g_IsFreeCamera = !g_IsFreeCamera;
+        if (g_ShowHud)
+            g_ShowHud = g_ShowInfoText = false;
+        else if (g_ShowInfoText)
+            g_ShowHud = true;
+        else
+            g_ShowInfoText = true;
     }
 
-    if (g_IsFreeCamera)
+    // Se o usuário apertar a tecla P, gravamos o trace dos últimos quadros no fim do quadro atual.
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
     {
-        if (key == GLFW_KEY_W)
-        {
-            g_WKeyPressed = (action != GLFW_RELEASE);
-        }
-        if (key == GLFW_KEY_S)
-        {
-            g_SKeyPressed = (action != GLFW_RELEASE);
-        }
-        if (key == GLFW_KEY_A)
-        {
-            g_AKeyPressed = (action != GLFW_RELEASE);
-        }
-        if (key == GLFW_KEY_D)
-        {
-            g_DKeyPressed = (action != GLFW_RELEASE);
-        }
+        g_TraceRequested = true;
     }
 
-    // Se o usuário apertar espaço
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
-    {
-        g_SpaceKeyPressed = true;
-    }
+    // As demais teclas afetam a simulação e são entregues a ela por Simulation_ApplyInputEvent().
+    if (g_Replaying || g_Benchmark)
+        return;
 
-    // Se o usuário apertar enter
-    if (key == GLFW_KEY_ENTER && action == GLFW_PRESS && !g_StartGame)
-    {
-        g_StartGame = true;
-        g_StartGameTime = glfwGetTime();
-    }
+    InputEvent event = { 0, INPUT_EVENT_KEY, (uint8_t)action, (int16_t)key, 0.0, 0.0 };
+    g_PendingInput.push_back(event);
 }
 
 // Definimos o callback para impressão de erros da GLFW no terminal
@@ -1441,7 +2178,7 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
         return;
 
     // Variáveis estáticas (static) mantém seus valores entre chamadas subsequentes da função!
-    static float old_seconds = (float)glfwGetTime();
+    static float old_seconds = (float)GetTime();
     static int   ellapsed_frames = 0;
     static char  buffer[20] = "?? fps";
     static int   numchars = 7;
@@ -1449,7 +2186,7 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     ellapsed_frames += 1;
 
     // Recuperamos o número de segundos que passou desde a execução do programa
-    float seconds = (float)glfwGetTime();
+    float seconds = (float)GetTime();
 
     // Número de segundos desde o último cálculo do fps
     float ellapsed_seconds = seconds - old_seconds;
@@ -1471,10 +2208,7 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
 // Escrevemos na tela o número de quadros renderizados por segundo (frames per second).
 void TextRendering_ShowStartGame(GLFWwindow* window)
 {
-    if (g_StartGame)
-        return;
-
-    static char  buffer[] = "Press ENTER to Start";
+    static const std::string buffer = "Press ENTER to Start";  // Construída uma única vez: não aloca a cada quadro
     static int   numchars = 21;
 
     float lineheight = TextRendering_LineHeight(window);
@@ -1650,22 +2384,309 @@ void PrintObjModelInfo(ObjModel* model)
   }
 }
 
-// Função que pega a matriz M e guarda a mesma no topo da pilha
-void PushMatrix(glm::mat4 M)
+// Copia do estado da simulação as transformações que variam continuamente entre os passos.
+FrameTransforms CaptureFrameTransforms(const GameState& state)
+{
+    FrameTransforms frame;
+    frame.camera_position    = state.camera_position;
+    frame.camera_orientation = glm::quatLookAt(state.camera_front, glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.ship_roll          = glm::angleAxis(state.barrel_roll_angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    frame.rocket_active      = state.started && state.rocket_active;
+    frame.rocket_position    = state.rocket_position;
+    frame.meteor_active      = state.started && state.meteor_active;
+    frame.meteor_position    = state.meteor_position;
+    frame.group_offset       = state.group_offset;
+    return frame;
+}
+
+// Interpola linearmente as posições e esfericamente (slerp) as orientações entre dois passos, com alpha em [0, 1].
+// Objetos que acabaram de surgir não são interpolados, pois não tinham posição válida no passo anterior.
+FrameTransforms InterpolateFrameTransforms(const FrameTransforms& a, const FrameTransforms& b, float alpha)
 {
-    g_MatrixStack.push(M);
+    FrameTransforms frame = b;
+    frame.camera_position    = glm::mix(a.camera_position, b.camera_position, alpha);
+    frame.camera_orientation = glm::slerp(a.camera_orientation, b.camera_orientation, alpha);
+    frame.ship_roll          = glm::slerp(a.ship_roll, b.ship_roll, alpha);
+    frame.group_offset       = glm::mix(a.group_offset, b.group_offset, alpha);
+    if (a.rocket_active && b.rocket_active)
+        frame.rocket_position = glm::mix(a.rocket_position, b.rocket_position, alpha);
+    if (a.meteor_active && b.meteor_active)
+        frame.meteor_position = glm::mix(a.meteor_position, b.meteor_position, alpha);
+    return frame;
 }
 
-// Função que remove a matriz atualmente no topo da pilha e armazena a mesma na variável M
-void PopMatrix(glm::mat4& M)
+// Gera um nível com "num_asteroids" asteroides em torno do caminho das moedas de "base" e o carrega em "level".
+// "seconds" recebe o tempo gasto na geração e no carregamento.
+void LoadStressLevel(const Level& base, uint32_t num_asteroids, Level* level, double* seconds)
 {
-    if ( g_MatrixStack.empty() )
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32_t generated;
+    if (!Stress_WriteLevel(&base, num_asteroids, g_RandomSeed, g_StressLevelFilename.c_str(), &generated, g_Jobs)
+        || !Level_Load(g_StressLevelFilename.c_str(), level))
     {
-        M = Matrix_Identity();
+        fprintf(stderr, "ERROR: Cannot generate stress level \"%s\".\n", g_StressLevelFilename.c_str());
+        std::exit(EXIT_FAILURE);
     }
+    if (generated < num_asteroids)
+        fprintf(stderr, "WARNING: Only %u of %u asteroids fit in the stress level.\n", generated, num_asteroids);
+
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Segundos desde o início do programa. Substitui glfwGetTime(), que não pode ser usada sem inicializar a GLFW (opção --offscreen).
+double GetTime()
+{
+    static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sem janela, o fim do programa é indicado por g_OffscreenShouldClose.
+bool WindowShouldClose(GLFWwindow* window)
+{
+    return (window != NULL) ? glfwWindowShouldClose(window) : g_OffscreenShouldClose;
+}
+
+void CloseWindow(GLFWwindow* window)
+{
+    if (window != NULL)
+        glfwSetWindowShouldClose(window, GL_TRUE);
     else
+        g_OffscreenShouldClose = true;
+}
+
+// Interpreta os argumentos da linha de comando:
+//   --level <arquivo.txt>              joga o nível indicado (o binário ".lvl" é gerado ao lado do texto)
+//   --compile-level <in.txt> <out.lvl> apenas converte um nível de texto para binário e termina
+//   --stream-radius <distância>        distância da nave até a qual os setores do nível ficam carregados
+//   --sim-hz <passos>                  passos de simulação por segundo (padrão 60)
+//   --max-fps <quadros>                limite de quadros desenhados por segundo (padrão 0, sem limite)
+//   --vsync <on|off|adaptive>          sincronização vertical (padrão on; o benchmark usa off)
+//   --late-latch <0|1>                 lê a orientação da câmera livre logo antes de entregar o quadro para desenho (padrão 1)
+//   --seed <semente>                   semente do gerador de números aleatórios, que sorteia os meteoros (padrão 1)
+//   --record <arquivo.inp>             grava os eventos de entrada da sessão para reprodução posterior
+//   --replay <arquivo.inp>             reproduz uma sessão gravada, ignorando o teclado e o mouse
+//   --checksums <arquivo.txt>          escreve um checksum do estado do jogo a cada passo da simulação
+//   --benchmark                        percorre o nível em um número fixo de quadros e imprime os tempos medidos
+//   --benchmark-frames <quadros>       número de quadros do benchmark (padrão 2000)
+//   --stress [máximo]                  benchmark em rodadas com níveis gerados, dobrando o número de asteroides até o máximo (padrão 1000000)
+//   --stress-start <asteroides>        número de asteroides da primeira rodada do modo stress (padrão 1000)
+//   --stress-frames <quadros>          número de quadros de cada rodada do modo stress (padrão 300)
+//   --offscreen <largura>x<altura>     desenha sem janela, em um framebuffer com a resolução indicada (implica --benchmark, exceto com --replay)
+//   --dump-frames <pasta>              com --offscreen, grava os quadros desenhados na pasta indicada (imagens PPM)
+//   --dump-every <n>                   com --dump-frames, grava apenas um a cada n quadros (padrão 1)
+//   --renderer <gl|software>           desenha a cena com a OpenGL (padrão) ou com o rasterizador por software do jogo
+//   --job-threads <n>                  threads do sistema de tarefas, usadas pela simulação, pelo desenho e pelo rasterizador por software (padrão 0, uma por núcleo)
+//   --render-thread                    desenha os quadros em uma thread dedicada, enquanto a thread principal simula o próximo
+//   --frame-latency <0|1>              com --render-thread, quadros que a simulação pode estar à frente do desenho (padrão 1)
+//   --alloc-assert                     aborta o programa se o laço principal alocar memória depois do aquecimento (exceto no carregamento)
+//   --profile-trace <arquivo.json>     grava no fim da execução (e ao apertar P) o trace dos marcadores de tempo dos últimos quadros
+//   --profile-frames <quadros>         número de quadros do trace (padrão 120)
+//   --hud                              começa mostrando o painel de desempenho (tecla H)
+//   --hitch-ms <ms>                    grava o trace e o resumo dos quadros em volta de um quadro mais lento que isso (padrão 100, 0 desliga)
+//   --hitch-dir <pasta>                pasta dos arquivos dos quadros lentos (padrão: a pasta atual)
+//   --target-frame-ms <ms>             ajusta a resolução da cena, o LOD bias e os efeitos para manter esse tempo de quadro (padrão 0, desligado)
+//   --resolution-scale <escala>        escala da resolução da cena, fixa ou inicial com --target-frame-ms (padrão 1)
+//   --shader-cache <pasta>             pasta do cache dos programas de GPU já ligados (padrão: "shadercache", na pasta atual)
+//   --no-shader-cache                  sempre compila os shaders, sem ler nem gravar o cache
+//   --gl-debug <high|medium|low|all>   imprime os erros e avisos do OpenGL informados pelo driver, a partir da gravidade indicada
+void ParseCommandLine(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
     {
-        M = g_MatrixStack.top();
-        g_MatrixStack.pop();
+        std::string arg = argv[i];
+
+        if (arg == "--level" && i + 1 < argc)
+        {
+            g_LevelTextFilename = argv[++i];
+            g_LevelBinaryFilename = Level_BinaryFilename(g_LevelTextFilename);
+        }
+        else if (arg == "--stream-radius" && i + 1 < argc)
+        {
+            g_StreamRadius = (float)atof(argv[++i]);
+        }
+        else if (arg == "--sim-hz" && i + 1 < argc)
+        {
+            g_SimulationRate = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--max-fps" && i + 1 < argc)
+        {
+            g_MaxFramesPerSecond = std::max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--late-latch" && i + 1 < argc)
+        {
+            g_LateLatch = atoi(argv[++i]) != 0;
+        }
+        else if (arg == "--vsync" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "on")
+                g_Vsync = VSYNC_ON;
+            else if (mode == "off")
+                g_Vsync = VSYNC_OFF;
+            else if (mode == "adaptive")
+                g_Vsync = VSYNC_ADAPTIVE;
+            else
+            {
+                fprintf(stderr, "ERROR: Unknown vsync mode \"%s\" (expected on, off or adaptive).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            g_RandomSeed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            g_RecordFilename = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            g_ReplayFilename = argv[++i];
+        }
+        else if (arg == "--checksums" && i + 1 < argc)
+        {
+            g_ChecksumFilename = argv[++i];
+        }
+        else if (arg == "--benchmark")
+        {
+            g_Benchmark = true;
+        }
+        else if (arg == "--benchmark-frames" && i + 1 < argc)
+        {
+            g_Benchmark = true;
+            g_BenchmarkFrames = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--stress")
+        {
+            g_StressMaxAsteroids = 1000000;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                g_StressMaxAsteroids = (uint32_t)std::max(1ul, strtoul(argv[++i], NULL, 10));
+        }
+        else if (arg == "--stress-start" && i + 1 < argc)
+        {
+            g_StressFirstAsteroids = (uint32_t)std::max(1ul, strtoul(argv[++i], NULL, 10));
+        }
+        else if (arg == "--stress-frames" && i + 1 < argc)
+        {
+            g_StressFrames = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--offscreen" && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &g_OffscreenWidth, &g_OffscreenHeight) != 2 || g_OffscreenWidth <= 0 || g_OffscreenHeight <= 0)
+            {
+                fprintf(stderr, "ERROR: Invalid resolution \"%s\" (expected <width>x<height>).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--dump-frames" && i + 1 < argc)
+        {
+            g_DumpFramesDirectory = argv[++i];
+        }
+        else if (arg == "--dump-every" && i + 1 < argc)
+        {
+            g_DumpEvery = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--renderer" && i + 1 < argc)
+        {
+            std::string renderer = argv[++i];
+            if (renderer != "gl" && renderer != "software")
+            {
+                fprintf(stderr, "ERROR: Unknown renderer \"%s\" (expected gl or software).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+            g_SoftwareRenderer = (renderer == "software");
+        }
+        else if (arg == "--job-threads" && i + 1 < argc)
+        {
+            g_JobThreads = std::max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--render-thread")
+        {
+            g_UseRenderThread = true;
+        }
+        else if (arg == "--frame-latency" && i + 1 < argc)
+        {
+            g_FrameLatency = atoi(argv[++i]);
+            if (g_FrameLatency != 0 && g_FrameLatency != 1)
+            {
+                fprintf(stderr, "ERROR: Invalid frame latency \"%s\" (expected 0 or 1).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--alloc-assert")
+        {
+            g_AllocAssert = true;
+        }
+        else if (arg == "--profile-trace" && i + 1 < argc)
+        {
+            g_TraceFilename = argv[++i];
+            g_TraceAtExit = true;
+        }
+        else if (arg == "--profile-frames" && i + 1 < argc)
+        {
+            g_TraceFrames = (uint32_t)std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--hud")
+        {
+            g_ShowHud = true;
+        }
+        else if (arg == "--hitch-ms" && i + 1 < argc)
+        {
+            g_HitchBudgetMs = std::max(0.0, atof(argv[++i]));
+        }
+        else if (arg == "--hitch-dir" && i + 1 < argc)
+        {
+            g_HitchDirectory = argv[++i];
+        }
+        else if (arg == "--target-frame-ms" && i + 1 < argc)
+        {
+            g_TargetFrameMs = std::max(0.0, atof(argv[++i]));
+        }
+        else if (arg == "--resolution-scale" && i + 1 < argc)
+        {
+            g_ResolutionScale = (float)atof(argv[++i]);
+            if (!(g_ResolutionScale > 0.0f && g_ResolutionScale <= 1.0f))
+            {
+                fprintf(stderr, "ERROR: Invalid resolution scale \"%s\" (expected a value in (0, 1]).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--shader-cache" && i + 1 < argc)
+        {
+            g_ShaderCacheDirectory = argv[++i];
+            g_ShaderCacheEnabled = true;
+        }
+        else if (arg == "--no-shader-cache")
+        {
+            g_ShaderCacheEnabled = false;
+        }
+        else if (arg == "--gl-debug" && i + 1 < argc)
+        {
+            std::string level = argv[++i];
+            if (level == "high")
+                g_GlDebugLevel = GLDEBUG_HIGH;
+            else if (level == "medium")
+                g_GlDebugLevel = GLDEBUG_MEDIUM;
+            else if (level == "low")
+                g_GlDebugLevel = GLDEBUG_LOW;
+            else if (level == "all")
+                g_GlDebugLevel = GLDEBUG_NOTIFICATION;
+            else
+            {
+                fprintf(stderr, "ERROR: Unknown OpenGL debug level \"%s\" (expected high, medium, low or all).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--compile-level" && i + 2 < argc)
+        {
+            bool ok = Level_CompileText(argv[i + 1], argv[i + 2]);
+            std::exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unknown argument \"%s\".\n", argv[i]);
+            std::exit(EXIT_FAILURE);
+        }
     }
 }
@@ -1,5 +1,16 @@
 #include "matrices.h"
 
+#include <cmath>
+#include <algorithm>
+
+// As funções Matrix_MultiplyAffine() e Matrix_BuildModels() usam
+// instruções SSE (presentes em todo processador x86-64) quando o compilador as
+// disponibiliza; caso contrário, a versão escalar equivalente.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATRICES_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 glm::mat4 Matrix(
     float m00, float m01, float m02, float m03, // LINHA 1
     float m10, float m11, float m12, float m13, // LINHA 2
@@ -44,6 +55,40 @@ glm::mat4 Matrix_Scale(float sx, float sy, float sz)
     );
 }
 
+glm::mat4 Matrix_TranslateScale(float tx, float ty, float tz, float sx, float sy, float sz)
+{
+    return Matrix(
+        sx   , 0.0f , 0.0f , tx ,
+        0.0f , sy   , 0.0f , ty ,
+        0.0f , 0.0f , sz   , tz ,
+        0.0f , 0.0f , 0.0f , 1.0f
+    );
+}
+
+// Colunas da matriz de rotação do quatérnio unitário q = (x,y,z,w), já multiplicadas pela escala.
+static void RotationScaleColumns(glm::quat q, glm::vec3 scale, glm::vec3 columns[3])
+{
+    float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+    float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+    float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+
+    columns[0] = scale.x * glm::vec3(1.0f - 2.0f*(yy + zz), 2.0f*(xy + wz), 2.0f*(xz - wy));
+    columns[1] = scale.y * glm::vec3(2.0f*(xy - wz), 1.0f - 2.0f*(xx + zz), 2.0f*(yz + wx));
+    columns[2] = scale.z * glm::vec3(2.0f*(xz + wy), 2.0f*(yz - wx), 1.0f - 2.0f*(xx + yy));
+}
+
+glm::mat4 Matrix_TRS(glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+    glm::vec3 c[3];
+    RotationScaleColumns(rotation, scale, c);
+    return glm::mat4(
+        c[0].x        , c[0].y        , c[0].z        , 0.0f , // COLUNA 1
+        c[1].x        , c[1].y        , c[1].z        , 0.0f , // COLUNA 2
+        c[2].x        , c[2].y        , c[2].z        , 0.0f , // COLUNA 3
+        translation.x , translation.y , translation.z , 1.0f   // COLUNA 4
+    );
+}
+
 glm::mat4 Matrix_Rotate_X(float angle)
 {
     float c = cos(angle);
@@ -91,14 +136,14 @@ float norm(glm::vec4 v)
 
 glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis)
 {
-    float c = cos(angle);
-    float s = sin(angle);
-
-    glm::vec4 v = axis / norm(axis);
+    return Matrix_Rotate_CosSin(cos(angle), sin(angle), axis / norm(axis));
+}
 
-    float vx = v.x;
-    float vy = v.y;
-    float vz = v.z;
+glm::mat4 Matrix_Rotate_CosSin(float c, float s, glm::vec4 unit_axis)
+{
+    float vx = unit_axis.x;
+    float vy = unit_axis.y;
+    float vz = unit_axis.z;
 
     return Matrix(
         vx*vx*(1.0f-c)+c    , vx*vy*(1.0f-c)-vz*s , vx*vz*(1-c)+vy*s , 0.0f ,
@@ -108,6 +153,170 @@ glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis)
     );
 }
 
+glm::mat4 Matrix_MultiplyAffine(const glm::mat4& A, const glm::mat4& B)
+{
+    // Coluna j de A*B = A[0]*B[j].x + A[1]*B[j].y + A[2]*B[j].z + A[3]*B[j].w, onde B[j].w
+    // é 0 nas três primeiras colunas e 1 na última.
+    glm::mat4 R;
+#ifdef MATRICES_USE_SSE
+    __m128 a0 = _mm_loadu_ps(&A[0][0]);
+    __m128 a1 = _mm_loadu_ps(&A[1][0]);
+    __m128 a2 = _mm_loadu_ps(&A[2][0]);
+    __m128 a3 = _mm_loadu_ps(&A[3][0]);
+    for (int j = 0; j < 4; ++j)
+    {
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(B[j][0])),
+                                         _mm_mul_ps(a1, _mm_set1_ps(B[j][1]))),
+                              _mm_mul_ps(a2, _mm_set1_ps(B[j][2])));
+        if (j == 3)
+            r = _mm_add_ps(r, a3);
+        _mm_storeu_ps(&R[j][0], r);
+    }
+#else
+    for (int j = 0; j < 3; ++j)
+        R[j] = A[0]*B[j].x + A[1]*B[j].y + A[2]*B[j].z;
+    R[3] = A[0]*B[3].x + A[1]*B[3].y + A[2]*B[3].z + A[3];
+#endif
+    return R;
+}
+
+// Monta a matriz do objeto i de "transforms" sem SSE (também usada para os objetos que sobram no fim do lote).
+static glm::mat4 BuildModel(const TransformArrays& transforms, uint32_t i)
+{
+    float s = (transforms.scale != NULL) ? transforms.scale[i] : 1.0f;
+    if (transforms.rotation_x == NULL)
+        return Matrix_TranslateScale(transforms.x[i], transforms.y[i], transforms.z[i], s, s, s);
+
+    glm::quat q(transforms.rotation_w[i], transforms.rotation_x[i], transforms.rotation_y[i], transforms.rotation_z[i]);
+    return Matrix_TRS(glm::vec3(transforms.x[i], transforms.y[i], transforms.z[i]), q, glm::vec3(s));
+}
+
+void Matrix_BuildModels(const TransformArrays& transforms, uint32_t count, glm::mat4* models)
+{
+    uint32_t i = 0;
+#ifdef MATRICES_USE_SSE
+    // Cada registrador guarda o mesmo coeficiente de quatro objetos. Ao final, transpomos
+    // cada grupo de quatro registradores para obter uma coluna de cada uma das quatro matrizes.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 tx = _mm_loadu_ps(transforms.x + i);
+        __m128 ty = _mm_loadu_ps(transforms.y + i);
+        __m128 tz = _mm_loadu_ps(transforms.z + i);
+        __m128 s = (transforms.scale != NULL) ? _mm_loadu_ps(transforms.scale + i) : one;
+
+        // Coeficientes rIJ (linha I, coluna J) da parte 3x3 de R*S.
+        __m128 r00, r01, r02, r10, r11, r12, r20, r21, r22;
+        if (transforms.rotation_x == NULL)
+        {
+            r00 = s; r11 = s; r22 = s;
+            r01 = r02 = r10 = r12 = r20 = r21 = zero;
+        }
+        else
+        {
+            __m128 qx = _mm_loadu_ps(transforms.rotation_x + i);
+            __m128 qy = _mm_loadu_ps(transforms.rotation_y + i);
+            __m128 qz = _mm_loadu_ps(transforms.rotation_z + i);
+            __m128 qw = _mm_loadu_ps(transforms.rotation_w + i);
+
+            __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+            __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+            __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+            __m128 s2 = _mm_mul_ps(two, s);
+
+            r00 = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(yy, zz)));
+            r11 = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, zz)));
+            r22 = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, yy)));
+            r10 = _mm_mul_ps(s2, _mm_add_ps(xy, wz));
+            r01 = _mm_mul_ps(s2, _mm_sub_ps(xy, wz));
+            r20 = _mm_mul_ps(s2, _mm_sub_ps(xz, wy));
+            r02 = _mm_mul_ps(s2, _mm_add_ps(xz, wy));
+            r21 = _mm_mul_ps(s2, _mm_add_ps(yz, wx));
+            r12 = _mm_mul_ps(s2, _mm_sub_ps(yz, wx));
+        }
+
+        __m128 c0 = r00, c1 = r10, c2 = r20, c3 = zero;
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(&models[i + 0][0][0], c0);
+        _mm_storeu_ps(&models[i + 1][0][0], c1);
+        _mm_storeu_ps(&models[i + 2][0][0], c2);
+        _mm_storeu_ps(&models[i + 3][0][0], c3);
+
+        c0 = r01; c1 = r11; c2 = r21; c3 = zero;
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(&models[i + 0][1][0], c0);
+        _mm_storeu_ps(&models[i + 1][1][0], c1);
+        _mm_storeu_ps(&models[i + 2][1][0], c2);
+        _mm_storeu_ps(&models[i + 3][1][0], c3);
+
+        c0 = r02; c1 = r12; c2 = r22; c3 = zero;
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(&models[i + 0][2][0], c0);
+        _mm_storeu_ps(&models[i + 1][2][0], c1);
+        _mm_storeu_ps(&models[i + 2][2][0], c2);
+        _mm_storeu_ps(&models[i + 3][2][0], c3);
+
+        c0 = tx; c1 = ty; c2 = tz; c3 = one;
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(&models[i + 0][3][0], c0);
+        _mm_storeu_ps(&models[i + 1][3][0], c1);
+        _mm_storeu_ps(&models[i + 2][3][0], c2);
+        _mm_storeu_ps(&models[i + 3][3][0], c3);
+    }
+#endif
+    for (; i < count; ++i)
+        models[i] = BuildModel(transforms, i);
+}
+
+bool Matrix_CheckBuildModels()
+{
+    // Onze objetos: dois lotes de quatro (SSE) e três que sobram (versão escalar), com translações, escalas e
+    // rotações diferentes.
+    const uint32_t count = 11;
+    float x[count], y[count], z[count], scale[count], qx[count], qy[count], qz[count], qw[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        x[i] = 10.0f * i - 40.0f;
+        y[i] = 3.5f * i;
+        z[i] = -25.0f * i;
+        scale[i] = 0.25f + 0.5f * i;
+        glm::quat q = glm::angleAxis(0.7f * i - 2.0f, glm::normalize(glm::vec3(1.0f + i, 2.0f - i, 0.5f * i - 1.0f)));
+        qx[i] = q.x; qy[i] = q.y; qz[i] = q.z; qw[i] = q.w;
+    }
+
+    const TransformArrays cases[3] =
+    {
+        { x, y, z, scale, NULL, NULL, NULL, NULL },  // Translação e escala, como os asteroides do nível
+        { x, y, z, scale, qx, qy, qz, qw },          // Com rotação
+        { x, y, z, NULL, qx, qy, qz, qw },           // Com rotação, sem escala
+    };
+
+    bool ok = true;
+    for (int c = 0; c < 3; ++c)
+    {
+        glm::mat4 models[count];
+        Matrix_BuildModels(cases[c], count, models);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            glm::mat4 expected = BuildModel(cases[c], i);
+            for (int col = 0; col < 4; ++col)
+                for (int row = 0; row < 4; ++row)
+                {
+                    float error = std::fabs(models[i][col][row] - expected[col][row]);
+                    if (error > 1e-5f * std::max(1.0f, std::fabs(expected[col][row])))
+                    {
+                        fprintf(stderr, "ERROR: Matrix_BuildModels() case %d, object %u, [%d][%d]: %f (scalar: %f)\n",
+                                c, i, col, row, models[i][col][row], expected[col][row]);
+                        ok = false;
+                    }
+                }
+        }
+    }
+    return ok;
+}
+
 glm::vec4 crossproduct(glm::vec4 u, glm::vec4 v)
 {
     float u1 = u.x;
@@ -0,0 +1,272 @@
+#include "memtrack.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+#if defined(MEMTRACK)
+#if !defined(__GLIBC__)
+#error "O modo de instrumentação (MEMTRACK) precisa da glibc."
+#endif
+#include <malloc.h>
+
+// Implementações da glibc, chamadas pelas nossas versões de malloc, free, ...
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* memory, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* memory);
+}
+#endif
+
+std::atomic<uint64_t> g_HeapAllocations(0);
+
+static std::atomic<bool> g_Armed(false);
+
+// Inicializadas com constantes: podem ser lidas dentro de malloc(), mesmo antes de main() ou no início de uma thread.
+static thread_local MemTag t_Tag = MEMTAG_OTHER;
+static thread_local bool   t_Reporting = false;
+
+bool MemTrack_Enabled()
+{
+#if defined(MEMTRACK)
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* MemTrack_TagName(MemTag tag)
+{
+    switch (tag)
+    {
+        case MEMTAG_LOADING:    return "carregamento";
+        case MEMTAG_SIMULATION: return "simulação";
+        case MEMTAG_RENDER:     return "desenho";
+        case MEMTAG_TEXT:       return "texto";
+        default:                return "outros";
+    }
+}
+
+MemTag MemTrack_Tag()
+{
+    return t_Tag;
+}
+
+MemTag MemTrack_SetTag(MemTag tag)
+{
+    MemTag previous = t_Tag;
+    t_Tag = tag;
+    return previous;
+}
+
+void MemTrack_Arm(bool armed)
+{
+    g_Armed.store(armed, std::memory_order_relaxed);
+}
+
+#if defined(MEMTRACK)
+
+// Os bytes contados são os utilizáveis de cada bloco (malloc_usable_size), um pouco acima do pedido,
+// para que free() desconte exatamente o que foi somado.
+static std::atomic<uint64_t> g_TagAllocations[MEMTAG_COUNT];
+static std::atomic<uint64_t> g_TagBytes[MEMTAG_COUNT];
+static std::atomic<int64_t>  g_LiveBytes;
+static std::atomic<int64_t>  g_PeakBytes;
+
+static void RecordAllocation(void* memory)
+{
+    if (memory == NULL)
+        return;
+
+    int64_t size = (int64_t)malloc_usable_size(memory);
+    MemTag tag = t_Tag;
+    g_TagAllocations[tag].fetch_add(1, std::memory_order_relaxed);
+    g_TagBytes[tag].fetch_add(size, std::memory_order_relaxed);
+
+    int64_t live = g_LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = g_PeakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+static void RecordFree(void* memory)
+{
+    if (memory != NULL)
+        g_LiveBytes.fetch_sub((int64_t)malloc_usable_size(memory), std::memory_order_relaxed);
+}
+
+void MemTrack_Snapshot(MemStats* stats)
+{
+    stats->allocations = 0;
+    stats->bytes = 0;
+    for (int i = 0; i < MEMTAG_COUNT; ++i)
+    {
+        stats->tags[i].allocations = g_TagAllocations[i].load(std::memory_order_relaxed);
+        stats->tags[i].bytes = g_TagBytes[i].load(std::memory_order_relaxed);
+        stats->allocations += stats->tags[i].allocations;
+        stats->bytes += stats->tags[i].bytes;
+    }
+    stats->live_bytes = g_LiveBytes.load(std::memory_order_relaxed);
+    stats->peak_bytes = g_PeakBytes.load(std::memory_order_relaxed);
+}
+
+void MemTrack_ResetPeak()
+{
+    g_PeakBytes.store(g_LiveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+extern "C"
+{
+
+void* malloc(size_t size)
+{
+    void* memory = __libc_malloc(size);
+    RecordAllocation(memory);
+    return memory;
+}
+
+void* calloc(size_t count, size_t size)
+{
+    void* memory = __libc_calloc(count, size);
+    RecordAllocation(memory);
+    return memory;
+}
+
+void* realloc(void* memory, size_t size)
+{
+    RecordFree(memory);
+    void* result = __libc_realloc(memory, size);
+    // Se a realocação falhar, o bloco original continua em uso.
+    RecordAllocation(result != NULL || size == 0 ? result : memory);
+    return result;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    void* memory = __libc_memalign(alignment, size);
+    RecordAllocation(memory);
+    return memory;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    void* memory = memalign(alignment, size);
+    if (memory == NULL)
+        return ENOMEM;
+    *result = memory;
+    return 0;
+}
+
+void free(void* memory)
+{
+    RecordFree(memory);
+    __libc_free(memory);
+}
+
+} // extern "C"
+
+#else
+
+void MemTrack_Snapshot(MemStats* stats)
+{
+    *stats = MemStats();
+}
+
+void MemTrack_ResetPeak()
+{
+}
+
+#endif // MEMTRACK
+
+// Alocação proibida: mostramos a pilha de chamadas e abortamos. Sem a opção -rdynamic
+// do ligador (adicionada por "make MEMTRACK=1") a pilha mostra apenas endereços.
+static void ReportAllocation(size_t size)
+{
+    t_Reporting = true;
+    fprintf(stderr, "ERROR: Heap allocation of %zu bytes (%s) inside the main loop after warm-up.\n", size, MemTrack_TagName(t_Tag));
+#if defined(__GLIBC__)
+    void* frames[64];
+    int count = backtrace(frames, 64);
+    backtrace_symbols_fd(frames, count, STDERR_FILENO);
+#endif
+    abort();
+}
+
+static void* CountedAllocate(size_t size)
+{
+    g_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (g_Armed.load(std::memory_order_relaxed) && t_Tag != MEMTAG_LOADING && !t_Reporting)
+        ReportAllocation(size);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size)
+{
+    void* memory = CountedAllocate(size);
+    if (memory == NULL)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    void* memory = CountedAllocate(size);
+    if (memory == NULL)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    free(memory);
+}
@@ -0,0 +1,303 @@
+#include "offscreen.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+
+// Subconjunto da API da EGL usado abaixo. Os tipos e constantes são os de <EGL/egl.h> e <EGL/eglext.h>,
+// repetidos aqui porque a biblioteca é carregada em tempo de execução.
+typedef void*        EGLDisplay;
+typedef void*        EGLConfig;
+typedef void*        EGLSurface;
+typedef void*        EGLContext;
+typedef int          EGLint;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+
+#define EGL_NONE                              0x3038
+#define EGL_EXTENSIONS                        0x3055
+#define EGL_VENDOR                            0x3053
+#define EGL_VERSION                           0x3054
+#define EGL_SURFACE_TYPE                      0x3033
+#define EGL_PBUFFER_BIT                       0x0001
+#define EGL_RENDERABLE_TYPE                   0x3040
+#define EGL_OPENGL_BIT                        0x0008
+#define EGL_RED_SIZE                          0x3024
+#define EGL_GREEN_SIZE                        0x3023
+#define EGL_BLUE_SIZE                         0x3022
+#define EGL_DEPTH_SIZE                        0x3025
+#define EGL_WIDTH                             0x3057
+#define EGL_HEIGHT                            0x3056
+#define EGL_OPENGL_API                        0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION             0x3098
+#define EGL_CONTEXT_MINOR_VERSION             0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK       0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT   0x0001
+#define EGL_CONTEXT_FLAGS_KHR                 0x30FC
+#define EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR      0x0001
+#define EGL_PLATFORM_SURFACELESS_MESA         0x31DD
+
+typedef void*      (*PFN_eglGetProcAddress)(const char* name);
+typedef EGLDisplay (*PFN_eglGetDisplay)(void* native_display);
+typedef EGLDisplay (*PFN_eglGetPlatformDisplayEXT)(EGLenum platform, void* native_display, const EGLint* attributes);
+typedef EGLBoolean (*PFN_eglInitialize)(EGLDisplay display, EGLint* major, EGLint* minor);
+typedef EGLBoolean (*PFN_eglTerminate)(EGLDisplay display);
+typedef const char* (*PFN_eglQueryString)(EGLDisplay display, EGLint name);
+typedef EGLBoolean (*PFN_eglBindAPI)(EGLenum api);
+typedef EGLBoolean (*PFN_eglChooseConfig)(EGLDisplay display, const EGLint* attributes, EGLConfig* configs, EGLint size, EGLint* count);
+typedef EGLSurface (*PFN_eglCreatePbufferSurface)(EGLDisplay display, EGLConfig config, const EGLint* attributes);
+typedef EGLBoolean (*PFN_eglDestroySurface)(EGLDisplay display, EGLSurface surface);
+typedef EGLContext (*PFN_eglCreateContext)(EGLDisplay display, EGLConfig config, EGLContext share, const EGLint* attributes);
+typedef EGLBoolean (*PFN_eglDestroyContext)(EGLDisplay display, EGLContext context);
+typedef EGLBoolean (*PFN_eglMakeCurrent)(EGLDisplay display, EGLSurface draw, EGLSurface read, EGLContext context);
+
+static PFN_eglGetProcAddress egl_GetProcAddress = NULL;
+
+// Carregador usado pela glad. Com a Mesa (e a EGL 1.5) eglGetProcAddress() também retorna as funções do OpenGL 1.x.
+void* Offscreen_GetProcAddress(const char* name)
+{
+    return egl_GetProcAddress(name);
+}
+
+static bool HasExtension(const char* extensions, const char* name)
+{
+    size_t length = strlen(name);
+    for (const char* p = extensions; p != NULL && (p = strstr(p, name)) != NULL; p += length)
+    {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+bool Offscreen_Init(Offscreen* offscreen, int width, int height, bool debug_context)
+{
+    offscreen->width = width;
+    offscreen->height = height;
+    offscreen->library = offscreen->display = offscreen->config = offscreen->surface = offscreen->context = NULL;
+    offscreen->framebuffer = offscreen->color_buffer = offscreen->depth_buffer = 0;
+
+    offscreen->library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (offscreen->library == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot load libEGL.so.1: %s\n", dlerror());
+        return false;
+    }
+
+    // Uma libEGL incompleta é tratada como a falta da biblioteca. As funções usadas por Offscreen_MakeCurrent() e
+    // Offscreen_Shutdown() também são verificadas aqui.
+    #define LOAD(name) PFN_##name egl_##name = (PFN_##name)dlsym(offscreen->library, #name); \
+                       if (egl_##name == NULL) { fprintf(stderr, "ERROR: libEGL.so.1 has no %s().\n", #name); return false; }
+    LOAD(eglGetProcAddress);
+    LOAD(eglGetDisplay);
+    LOAD(eglInitialize);
+    LOAD(eglTerminate);
+    LOAD(eglQueryString);
+    LOAD(eglBindAPI);
+    LOAD(eglChooseConfig);
+    LOAD(eglCreatePbufferSurface);
+    LOAD(eglDestroySurface);
+    LOAD(eglCreateContext);
+    LOAD(eglDestroyContext);
+    LOAD(eglMakeCurrent);
+    #undef LOAD
+    egl_GetProcAddress = egl_eglGetProcAddress;
+
+    // Preferimos a plataforma "surfaceless", que não precisa de nenhum servidor gráfico.
+    const char* client_extensions = egl_eglQueryString(NULL, EGL_EXTENSIONS);
+    PFN_eglGetPlatformDisplayEXT egl_GetPlatformDisplayEXT = (PFN_eglGetPlatformDisplayEXT)egl_GetProcAddress("eglGetPlatformDisplayEXT");
+    if (egl_GetPlatformDisplayEXT != NULL && HasExtension(client_extensions, "EGL_MESA_platform_surfaceless"))
+        offscreen->display = egl_GetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, NULL, NULL);
+    if (offscreen->display == NULL)
+        offscreen->display = egl_eglGetDisplay(NULL);
+
+    EGLint major, minor;
+    if (offscreen->display == NULL || !egl_eglInitialize(offscreen->display, &major, &minor))
+    {
+        fprintf(stderr, "ERROR: eglInitialize() failed.\n");
+        return false;
+    }
+    printf("EGL %s (%s)\n", egl_eglQueryString(offscreen->display, EGL_VERSION), egl_eglQueryString(offscreen->display, EGL_VENDOR));
+
+    if (!egl_eglBindAPI(EGL_OPENGL_API))
+    {
+        fprintf(stderr, "ERROR: EGL does not support desktop OpenGL.\n");
+        return false;
+    }
+
+    // Sem EGL_KHR_surfaceless_context precisamos de uma superfície: uma pbuffer mínima, já que desenhamos no framebuffer object.
+    bool surfaceless = HasExtension(egl_eglQueryString(offscreen->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    EGLint config_attributes[] =
+    {
+        EGL_SURFACE_TYPE,    surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,        8,
+        EGL_GREEN_SIZE,      8,
+        EGL_BLUE_SIZE,       8,
+        EGL_NONE
+    };
+    EGLint num_configs = 0;
+    if (!egl_eglChooseConfig(offscreen->display, config_attributes, &offscreen->config, 1, &num_configs) || num_configs == 0)
+    {
+        fprintf(stderr, "ERROR: No suitable EGL config.\n");
+        return false;
+    }
+
+    if (!surfaceless)
+    {
+        EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        offscreen->surface = egl_eglCreatePbufferSurface(offscreen->display, offscreen->config, pbuffer_attributes);
+        if (offscreen->surface == NULL)
+        {
+            fprintf(stderr, "ERROR: eglCreatePbufferSurface() failed.\n");
+            return false;
+        }
+    }
+
+    // Mesmo contexto pedido à GLFW no modo com janela: OpenGL 3.3, perfil "core".
+    EGLint context_attributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION,       3,
+        EGL_CONTEXT_MINOR_VERSION,       3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_FLAGS_KHR,           debug_context ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+        EGL_NONE
+    };
+    offscreen->context = egl_eglCreateContext(offscreen->display, offscreen->config, NULL, context_attributes);
+    if (offscreen->context == NULL || !egl_eglMakeCurrent(offscreen->display, offscreen->surface, offscreen->surface, offscreen->context))
+    {
+        fprintf(stderr, "ERROR: Cannot create an OpenGL 3.3 core context with EGL.\n");
+        return false;
+    }
+
+    gladLoadGLLoader((GLADloadproc) Offscreen_GetProcAddress);
+
+    // Framebuffer onde todos os quadros são desenhados.
+    glGenRenderbuffers(1, &offscreen->color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen->color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &offscreen->depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen->depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &offscreen->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreen->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen->color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen->depth_buffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: Offscreen framebuffer is incomplete.\n");
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    return true;
+}
+
+#else // _WIN32
+
+// A EGL só é usada no Linux: no Windows o jogo sempre abre uma janela.
+bool Offscreen_Init(Offscreen* offscreen, int width, int height, bool debug_context)
+{
+    offscreen->width = width;
+    offscreen->height = height;
+    offscreen->library = offscreen->display = offscreen->config = offscreen->surface = offscreen->context = NULL;
+    offscreen->framebuffer = offscreen->color_buffer = offscreen->depth_buffer = 0;
+    fprintf(stderr, "ERROR: --offscreen requires EGL and is only supported on Linux.\n");
+    return false;
+}
+
+void* Offscreen_GetProcAddress(const char* name)
+{
+    return NULL;
+}
+
+#endif // _WIN32
+
+bool Offscreen_SaveFrame(Offscreen* offscreen, const char* filename)
+{
+    int width = offscreen->width;
+    int height = offscreen->height;
+    offscreen->pixels.resize((size_t)width * height * 3);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &offscreen->pixels[0]);
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write frame \"%s\".\n", filename);
+        return false;
+    }
+
+    // O OpenGL lê as linhas de baixo para cima; o PPM as espera de cima para baixo.
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; --y)
+        fwrite(&offscreen->pixels[(size_t)y * width * 3], 1, (size_t)width * 3, file);
+    fclose(file);
+    return true;
+}
+
+void Offscreen_EndFrame(Offscreen* offscreen)
+{
+    glFlush();
+}
+
+#ifndef _WIN32
+
+void Offscreen_MakeCurrent(Offscreen* offscreen, bool current)
+{
+    PFN_eglMakeCurrent egl_MakeCurrent = (PFN_eglMakeCurrent)dlsym(offscreen->library, "eglMakeCurrent");
+    if (current)
+        egl_MakeCurrent(offscreen->display, offscreen->surface, offscreen->surface, offscreen->context);
+    else
+        egl_MakeCurrent(offscreen->display, NULL, NULL, NULL);
+}
+
+void Offscreen_Shutdown(Offscreen* offscreen)
+{
+    if (offscreen->library == NULL)
+        return;
+
+    if (offscreen->context != NULL)
+    {
+        glDeleteFramebuffers(1, &offscreen->framebuffer);
+        glDeleteRenderbuffers(1, &offscreen->color_buffer);
+        glDeleteRenderbuffers(1, &offscreen->depth_buffer);
+    }
+
+    PFN_eglMakeCurrent egl_MakeCurrent = (PFN_eglMakeCurrent)dlsym(offscreen->library, "eglMakeCurrent");
+    PFN_eglDestroyContext egl_DestroyContext = (PFN_eglDestroyContext)dlsym(offscreen->library, "eglDestroyContext");
+    PFN_eglDestroySurface egl_DestroySurface = (PFN_eglDestroySurface)dlsym(offscreen->library, "eglDestroySurface");
+    PFN_eglTerminate egl_Terminate = (PFN_eglTerminate)dlsym(offscreen->library, "eglTerminate");
+
+    if (offscreen->display != NULL)
+    {
+        egl_MakeCurrent(offscreen->display, NULL, NULL, NULL);
+        if (offscreen->context != NULL)
+            egl_DestroyContext(offscreen->display, offscreen->context);
+        if (offscreen->surface != NULL)
+            egl_DestroySurface(offscreen->display, offscreen->surface);
+        egl_Terminate(offscreen->display);
+    }
+
+    // A libEGL não é descarregada: alguns drivers registram funções de finalização que ainda seriam chamadas na saída do programa.
+    offscreen->library = NULL;
+    offscreen->context = NULL;
+}
+
+#else // _WIN32
+
+void Offscreen_MakeCurrent(Offscreen* offscreen, bool current)
+{
+}
+
+void Offscreen_Shutdown(Offscreen* offscreen)
+{
+}
+
+#endif // _WIN32
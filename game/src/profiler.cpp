@@ -0,0 +1,181 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "memtrack.h"
+
+// Buffers de todas as threads que já gravaram eventos. Nunca são liberados: uma thread
+// pode terminar enquanto o trace é escrito, e o número de threads do jogo é pequeno.
+static std::atomic<ProfileThread*> g_ProfileThreads[PROFILER_MAX_THREADS];
+static std::atomic<uint32_t>       g_NumProfileThreads(0);
+static thread_local ProfileThread* t_ProfileThread = NULL;
+static thread_local bool           t_ProfileFull = false;  // Sem buffer livre: a thread não grava eventos
+
+// Inícios dos últimos quadros, escritos e lidos apenas pela thread principal.
+static uint64_t g_FrameStarts[PROFILER_MAX_FRAMES];
+static uint32_t g_FrameNumbers[PROFILER_MAX_FRAMES];
+static uint32_t g_NumFrames = 0;
+
+uint64_t Profiler_Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Cria um buffer, ou retorna NULL se todos estiverem em uso.
+static ProfileThread* RegisterThread()
+{
+    uint32_t index = g_NumProfileThreads.fetch_add(1);
+    if (index >= PROFILER_MAX_THREADS)
+        return NULL;
+
+    // Alocado uma única vez por thread, como no carregamento.
+    MEMTRACK_SCOPE(MEMTAG_LOADING);
+    ProfileThread* thread = new ProfileThread;
+    thread->head.store(0);
+    snprintf(thread->name, sizeof(thread->name), "Thread %u", index);
+    g_ProfileThreads[index].store(thread, std::memory_order_release);
+    return thread;
+}
+
+static ProfileThread* CurrentThread()
+{
+    if (t_ProfileThread != NULL || t_ProfileFull)
+        return t_ProfileThread;
+
+    t_ProfileThread = RegisterThread();
+    t_ProfileFull = (t_ProfileThread == NULL);
+    return t_ProfileThread;
+}
+
+ProfileThread* Profiler_CreateTrack(const char* name)
+{
+    ProfileThread* track = RegisterThread();
+    if (track != NULL)
+        snprintf(track->name, sizeof(track->name), "%s", name);
+    return track;
+}
+
+void Profiler_SetThreadName(const char* name)
+{
+    ProfileThread* thread = CurrentThread();
+    if (thread != NULL)
+        snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+void Profiler_Record(const char* name, uint64_t begin, uint64_t end)
+{
+    Profiler_RecordTrack(CurrentThread(), name, begin, end);
+}
+
+void Profiler_RecordTrack(ProfileThread* thread, const char* name, uint64_t begin, uint64_t end)
+{
+    if (thread == NULL)
+        return;
+
+    // O evento é escrito antes de "head" avançar: quem lê "head" vê os eventos anteriores completos.
+    uint64_t head = thread->head.load(std::memory_order_relaxed);
+    ProfileEvent& event = thread->events[head & (PROFILER_EVENTS_PER_THREAD - 1)];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    thread->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler_BeginFrame(uint32_t frame)
+{
+    g_FrameStarts[g_NumFrames % PROFILER_MAX_FRAMES] = Profiler_Now();
+    g_FrameNumbers[g_NumFrames % PROFILER_MAX_FRAMES] = frame;
+    g_NumFrames += 1;
+}
+
+// Escreve "text" como uma string JSON, entre aspas: os nomes dos marcadores e das threads podem ter aspas e barras.
+static void WriteJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(file, "\\%c", *c);
+        else if (*c < 0x20)
+            fprintf(file, "\\u%04x", *c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+bool Profiler_WriteTrace(const char* filename, uint32_t num_frames)
+{
+#ifdef PROFILER_DISABLE
+    fprintf(stderr, "ERROR: Cannot write \"%s\": the game was compiled without the profiler (PROFILER_DISABLE).\n", filename);
+    return false;
+#endif
+
+    // Gravar o trace é uma operação de depuração, que pode alocar a qualquer momento.
+    MEMTRACK_SCOPE(MEMTAG_LOADING);
+
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open trace file \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    // Os eventos começam no início do quadro mais antigo pedido.
+    uint32_t frames = num_frames;
+    if (frames > g_NumFrames)
+        frames = g_NumFrames;
+    if (frames > PROFILER_MAX_FRAMES)
+        frames = PROFILER_MAX_FRAMES;
+    uint32_t first_frame = g_NumFrames - frames;
+    uint64_t start = frames > 0 ? g_FrameStarts[first_frame % PROFILER_MAX_FRAMES] : 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Jogo\"}}");
+
+    for (uint32_t f = first_frame; f < g_NumFrames; ++f)
+    {
+        uint32_t slot = f % PROFILER_MAX_FRAMES;
+        fprintf(file, ",\n{\"name\":\"Quadro %u\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+                g_FrameNumbers[slot], (g_FrameStarts[slot] - start) / 1000.0);
+    }
+
+    std::vector<ProfileEvent> events;
+    uint32_t num_threads = g_NumProfileThreads.load();
+    for (uint32_t t = 0; t < num_threads && t < PROFILER_MAX_THREADS; ++t)
+    {
+        ProfileThread* thread = g_ProfileThreads[t].load(std::memory_order_acquire);
+        if (thread == NULL)
+            continue;
+
+        // Copiamos os eventos e depois descartamos os que a thread pode ter sobrescrito durante a cópia.
+        uint64_t head = thread->head.load(std::memory_order_acquire);
+        uint64_t first = head > PROFILER_EVENTS_PER_THREAD ? head - PROFILER_EVENTS_PER_THREAD : 0;
+        events.resize((size_t)(head - first));
+        for (uint64_t i = first; i < head; ++i)
+            events[(size_t)(i - first)] = thread->events[i & (PROFILER_EVENTS_PER_THREAD - 1)];
+        uint64_t head_after = thread->head.load(std::memory_order_acquire);
+        uint64_t valid = head_after >= PROFILER_EVENTS_PER_THREAD ? head_after - PROFILER_EVENTS_PER_THREAD + 1 : 0;
+
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", t + 1);
+        WriteJsonString(file, thread->name);
+        fprintf(file, "}}");
+        for (uint64_t i = (valid > first ? valid : first); i < head; ++i)
+        {
+            const ProfileEvent& event = events[(size_t)(i - first)];
+            if (event.end < start)
+                continue;
+            fprintf(file, ",\n{\"name\":");
+            WriteJsonString(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    t + 1, ((int64_t)event.begin - (int64_t)start) / 1000.0, (event.end - event.begin) / 1000.0);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("Trace dos últimos %u quadros gravado em \"%s\".\n", frames, filename);
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "renderthread.h"
+
+#include "profiler.h"
+
+static void RenderThreadMain(RenderThread* rt, std::function<void()> attach, std::function<void()> detach)
+{
+    PROFILE_THREAD_NAME("Desenho");
+    attach();
+
+    std::unique_lock<std::mutex> lock(rt->mutex);
+    for (;;)
+    {
+        rt->wakeup.wait(lock, [&] { return rt->quit || rt->call || rt->completed < rt->submitted; });
+
+        if (rt->call)
+        {
+            lock.unlock();
+            rt->call();
+            lock.lock();
+            rt->call = std::function<void()>();
+            rt->done.notify_all();
+            continue;
+        }
+        if (rt->completed < rt->submitted)
+        {
+            // A thread principal só submete um novo pacote depois que este terminar (veja RenderThread_Submit).
+            int packet = rt->render_packet;
+            lock.unlock();
+            rt->render(packet);
+            lock.lock();
+            rt->completed += 1;
+            rt->done.notify_all();
+            continue;
+        }
+        if (rt->quit)
+            break;
+    }
+    lock.unlock();
+
+    detach();
+}
+
+void RenderThread_Start(RenderThread* rt, int max_latency, const std::function<void(int packet)>& render, const std::function<void()>& attach, const std::function<void()>& detach)
+{
+    rt->max_latency = max_latency;
+    rt->write_packet = 0;
+    rt->render_packet = 0;
+    rt->submitted = rt->completed = 0;
+    rt->render = render;
+    rt->call = std::function<void()>();
+    rt->quit = false;
+    rt->thread = std::thread(RenderThreadMain, rt, attach, detach);
+}
+
+int RenderThread_WritePacket(const RenderThread* rt)
+{
+    return rt->write_packet;
+}
+
+void RenderThread_Submit(RenderThread* rt)
+{
+    std::unique_lock<std::mutex> lock(rt->mutex);
+
+    // O pacote anterior precisa terminar antes: ele é o próximo a ser preenchido.
+    rt->done.wait(lock, [&] { return rt->completed == rt->submitted; });
+    rt->render_packet = rt->write_packet;
+    rt->submitted += 1;
+    rt->write_packet ^= 1;
+    rt->wakeup.notify_all();
+
+    if (rt->max_latency == 0)
+        rt->done.wait(lock, [&] { return rt->completed == rt->submitted; });
+}
+
+void RenderThread_Call(RenderThread* rt, const std::function<void()>& function)
+{
+    std::unique_lock<std::mutex> lock(rt->mutex);
+    rt->done.wait(lock, [&] { return rt->completed == rt->submitted && !rt->call; });
+    rt->call = function;
+    rt->wakeup.notify_all();
+    rt->done.wait(lock, [&] { return !rt->call; });
+}
+
+void RenderThread_Stop(RenderThread* rt)
+{
+    {
+        std::lock_guard<std::mutex> lock(rt->mutex);
+        rt->quit = true;
+    }
+    rt->wakeup.notify_all();
+    rt->thread.join();
+}
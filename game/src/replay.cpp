@@ -0,0 +1,208 @@
+#include "replay.h"
+
+#include <cstring>
+
+#include "level.h"
+
+static void WriteVarint(FILE* file, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool ReadVarint(FILE* file, uint32_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int byte = fgetc(file);
+        if (byte == EOF)
+            return false;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool Replay_StartRecording(InputLog* log, const char* filename, uint32_t seed, uint32_t simulation_rate,
+                           uint64_t level_hash, float stream_radius)
+{
+    log->file = fopen(filename, "wb");
+    if (log->file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write input log \"%s\".\n", filename);
+        return false;
+    }
+
+    memset(&log->header, 0, sizeof(log->header));
+    memcpy(log->header.magic, INPUT_LOG_MAGIC, 4);
+    log->header.version = INPUT_LOG_VERSION;
+    log->header.seed = seed;
+    log->header.simulation_rate = simulation_rate;
+    log->header.level_hash = level_hash;
+    log->header.stream_radius = stream_radius;
+    log->last_tick = 0;
+    log->num_events = 0;
+    fwrite(&log->header, sizeof(log->header), 1, log->file);
+    return true;
+}
+
+void Replay_RecordEvent(InputLog* log, const InputEvent& event)
+{
+    if (log->file == NULL)
+        return;
+
+    fputc(event.type, log->file);
+    WriteVarint(log->file, event.tick - log->last_tick);
+    log->last_tick = event.tick;
+    log->num_events += 1;
+
+    switch (event.type)
+    {
+    case INPUT_EVENT_KEY:
+        fwrite(&event.code, sizeof(int16_t), 1, log->file);
+        fputc(event.action, log->file);
+        break;
+    case INPUT_EVENT_MOUSE_BUTTON:
+        fputc((uint8_t)event.code, log->file);
+        fputc(event.action, log->file);
+        fwrite(&event.x, sizeof(double), 1, log->file);
+        fwrite(&event.y, sizeof(double), 1, log->file);
+        break;
+    case INPUT_EVENT_CURSOR_POS:
+        fwrite(&event.x, sizeof(double), 1, log->file);
+        fwrite(&event.y, sizeof(double), 1, log->file);
+        break;
+    }
+}
+
+void Replay_StopRecording(InputLog* log, uint32_t last_tick)
+{
+    if (log->file == NULL)
+        return;
+
+    InputEvent end = { last_tick, INPUT_EVENT_END, 0, 0, 0.0, 0.0 };
+    Replay_RecordEvent(log, end);
+    fclose(log->file);
+    log->file = NULL;
+}
+
+bool Replay_Load(const char* filename, InputLog* log)
+{
+    log->file = NULL;
+    log->events.clear();
+    log->next = 0;
+    log->end_tick = 0;
+
+    FILE* in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open input log \"%s\".\n", filename);
+        return false;
+    }
+
+    bool ok = fread(&log->header, sizeof(log->header), 1, in) == 1
+           && memcmp(log->header.magic, INPUT_LOG_MAGIC, 4) == 0
+           && log->header.version == INPUT_LOG_VERSION
+           && log->header.simulation_rate > 0;
+
+    uint32_t tick = 0;
+    bool ended = false;
+    while (ok && !ended)
+    {
+        InputEvent event = { 0, 0, 0, 0, 0.0, 0.0 };
+        int type = fgetc(in);
+        uint32_t delta;
+        if (type == EOF || !ReadVarint(in, &delta))
+        {
+            ok = false;
+            break;
+        }
+        tick += delta;
+        event.tick = tick;
+        event.type = (uint8_t)type;
+
+        switch (type)
+        {
+        case INPUT_EVENT_KEY:
+            ok = fread(&event.code, sizeof(int16_t), 1, in) == 1;
+            event.action = (uint8_t)fgetc(in);
+            break;
+        case INPUT_EVENT_MOUSE_BUTTON:
+            event.code = (int16_t)fgetc(in);
+            event.action = (uint8_t)fgetc(in);
+            ok = fread(&event.x, sizeof(double), 1, in) == 1 && fread(&event.y, sizeof(double), 1, in) == 1;
+            break;
+        case INPUT_EVENT_CURSOR_POS:
+            ok = fread(&event.x, sizeof(double), 1, in) == 1 && fread(&event.y, sizeof(double), 1, in) == 1;
+            break;
+        case INPUT_EVENT_END:
+            log->end_tick = tick;
+            ended = true;
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (ok && !ended)
+            log->events.push_back(event);
+    }
+    fclose(in);
+
+    // Uma gravação interrompida (sem o evento END) ainda pode ser reproduzida até o último evento.
+    if (!ended && !log->events.empty() && log->header.version == INPUT_LOG_VERSION)
+    {
+        fprintf(stderr, "WARNING: Input log \"%s\" is truncated.\n", filename);
+        log->end_tick = log->events.back().tick;
+        ok = true;
+    }
+
+    if (!ok)
+        fprintf(stderr, "ERROR: Invalid input log \"%s\".\n", filename);
+    return ok;
+}
+
+uint64_t Replay_LevelHash(const Level& level)
+{
+    uint64_t hash = REPLAY_HASH_SEED;
+    hash = Replay_Hash(level.asteroids, level.num_asteroids * sizeof(LevelAsteroid), hash);
+    hash = Replay_Hash(level.group, level.num_group_members * sizeof(LevelGroupMember), hash);
+    hash = Replay_Hash(level.coins, level.num_coins * sizeof(LevelCoin), hash);
+    hash = Replay_Hash(level.group_origin, sizeof(level.group_origin), hash);
+    hash = Replay_Hash(&level.group_speed, sizeof(level.group_speed), hash);
+    hash = Replay_Hash(&level.sector_length, sizeof(level.sector_length), hash);
+    return hash;
+}
+
+bool Replay_CheckLevel(const InputLog& log, const char* filename, uint64_t level_hash, float stream_radius)
+{
+    if (log.header.level_hash != level_hash)
+    {
+        fprintf(stderr, "ERROR: Input log \"%s\" was recorded with another level; use the same --level.\n", filename);
+        return false;
+    }
+    if (log.header.stream_radius != stream_radius)
+    {
+        fprintf(stderr, "ERROR: Input log \"%s\" was recorded with --stream-radius %g (current: %g).\n", filename,
+                log.header.stream_radius, stream_radius);
+        return false;
+    }
+    return true;
+}
+
+uint64_t Replay_Hash(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,72 @@
+#include "scenegraph.h"
+
+#include <algorithm>
+
+void SceneGraph_Init(SceneGraph* graph)
+{
+    graph->parent.clear();
+    graph->local.clear();
+    graph->world.clear();
+    graph->dirty.clear();
+    graph->updated.clear();
+    graph->update_serial = 0;
+    graph->first_dirty = 0;
+    graph->num_updated = 0;
+}
+
+int32_t SceneGraph_AddNode(SceneGraph* graph, int32_t parent, const glm::mat4& local)
+{
+    int32_t node = (int32_t)graph->parent.size();
+    if (parent >= node)
+    {
+        fprintf(stderr, "ERROR: Scene graph node %d added before its parent %d.\n", node, parent);
+        std::exit(EXIT_FAILURE);
+    }
+
+    graph->parent.push_back(parent);
+    graph->local.push_back(local);
+    graph->world.push_back(local);
+    graph->dirty.push_back(1);
+    graph->updated.push_back(0);
+    graph->first_dirty = std::min(graph->first_dirty, (uint32_t)node);
+    return node;
+}
+
+void SceneGraph_SetLocal(SceneGraph* graph, int32_t node, const glm::mat4& local)
+{
+    // Se a matriz não mudou, o nó (e a sua subárvore) continua limpo.
+    if (local == graph->local[node])
+        return;
+    graph->local[node] = local;
+    graph->dirty[node] = 1;
+    graph->first_dirty = std::min(graph->first_dirty, (uint32_t)node);
+}
+
+void SceneGraph_Update(SceneGraph* graph)
+{
+    uint32_t count = (uint32_t)graph->parent.size();
+    graph->num_updated = 0;
+    if (graph->first_dirty >= count)
+        return;
+
+    // Um nó é recalculado se estiver sujo ou se o seu pai foi recalculado nesta mesma atualização
+    // (o pai tem índice menor, então já foi visitado). Nós antes do primeiro sujo não mudam.
+    graph->update_serial += 1;
+    uint32_t serial = graph->update_serial;
+    for (uint32_t i = graph->first_dirty; i < count; ++i)
+    {
+        int32_t parent = graph->parent[i];
+        bool parent_updated = (parent >= 0 && graph->updated[parent] == serial);
+        if (!graph->dirty[i] && !parent_updated)
+            continue;
+
+        if (parent >= 0)
+            graph->world[i] = Matrix_MultiplyAffine(graph->world[parent], graph->local[i]);
+        else
+            graph->world[i] = graph->local[i];
+        graph->dirty[i] = 0;
+        graph->updated[i] = serial;
+        graph->num_updated += 1;
+    }
+    graph->first_dirty = count;
+}
@@ -0,0 +1,102 @@
+#include "scenetarget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "gldebug.h"
+
+void SceneTarget_Init(SceneTarget* target)
+{
+    target->framebuffer = 0;
+    target->color_buffer = 0;
+    target->depth_buffer = 0;
+    target->width = target->height = 0;
+    target->target_framebuffer = 0;
+    target->target_width = target->target_height = 0;
+    target->scene_width = target->scene_height = 0;
+    target->active = false;
+}
+
+void SceneTarget_Shutdown(SceneTarget* target)
+{
+    if (target->framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &target->framebuffer);
+        glDeleteRenderbuffers(1, &target->color_buffer);
+        glDeleteRenderbuffers(1, &target->depth_buffer);
+    }
+    SceneTarget_Init(target);
+}
+
+void SceneTarget_Size(int width, int height, float scale, int* scene_width, int* scene_height)
+{
+    *scene_width = std::max(1, (int)std::lround(width * scale));
+    *scene_height = std::max(1, (int)std::lround(height * scale));
+}
+
+// Cria (ou recria, com outro tamanho) o framebuffer da cena.
+static void Allocate(SceneTarget* target, int width, int height)
+{
+    if (target->framebuffer == 0)
+    {
+        glGenFramebuffers(1, &target->framebuffer);
+        glGenRenderbuffers(1, &target->color_buffer);
+        glGenRenderbuffers(1, &target->depth_buffer);
+    }
+
+    glBindRenderbuffer(GL_RENDERBUFFER, target->color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, target->depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target->depth_buffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: Scene framebuffer (%dx%d) is incomplete.\n", width, height);
+        std::exit(EXIT_FAILURE);
+    }
+    GL_LABEL(GL_FRAMEBUFFER, target->framebuffer, "Cena");
+    GL_LABEL(GL_RENDERBUFFER, target->color_buffer, "Cena (cor)");
+    GL_LABEL(GL_RENDERBUFFER, target->depth_buffer, "Cena (profundidade)");
+
+    target->width = width;
+    target->height = height;
+}
+
+void SceneTarget_Begin(SceneTarget* target, int width, int height, float scale)
+{
+    target->target_width = width;
+    target->target_height = height;
+    SceneTarget_Size(width, height, scale, &target->scene_width, &target->scene_height);
+    target->active = (target->scene_width < width || target->scene_height < height);
+    if (!target->active)
+    {
+        glViewport(0, 0, width, height);
+        return;
+    }
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target->target_framebuffer);
+    if (target->width != width || target->height != height)
+        Allocate(target, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glViewport(0, 0, target->scene_width, target->scene_height);
+}
+
+void SceneTarget_Resolve(SceneTarget* target)
+{
+    if (!target->active)
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->target_framebuffer);
+    glBlitFramebuffer(0, 0, target->scene_width, target->scene_height,
+                      0, 0, target->target_width, target->target_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->target_framebuffer);
+    glViewport(0, 0, target->target_width, target->target_height);
+    target->active = false;
+}
@@ -0,0 +1,377 @@
+#include "shadercache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "replay.h"
+#include "gldebug.h"
+
+// Funções e constantes de GL_ARB_get_program_binary (OpenGL 4.1) e de GL_KHR_parallel_shader_compile, que não
+// fazem parte da glad do projeto (OpenGL 3.3).
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+typedef void (APIENTRYP PFN_glGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFN_glProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFN_glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFN_glMaxShaderCompilerThreads)(GLuint count);
+
+#define SHADERCACHE_MAGIC 0x43444853u  // "SHDC"
+
+// Cabeçalho de cada arquivo do cache, seguido de "length" bytes do binário.
+struct CacheHeader
+{
+    uint32_t magic;
+    uint32_t format;    // Formato do binário, escolhido pelo driver
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t key;       // Confere que o arquivo é mesmo deste programa
+};
+
+// Programa entregue ao driver por ShaderCache_SubmitProgram(), cujo resultado ainda não foi consultado.
+struct PendingProgram
+{
+    GLuint             program;
+    GLuint             vertex_shader;     // 0 se o programa veio do cache
+    GLuint             fragment_shader;
+    uint64_t           key;
+    std::string        name;
+    std::string        vertex_source;     // Para compilar o programa caso o driver recuse o binário do cache
+    std::string        fragment_source;
+    ShaderProgramReady ready;
+    void*              data;
+};
+
+static struct
+{
+    bool                   enabled;
+    bool                   parallel;     // O driver compila em threads próprias (GL_KHR_parallel_shader_compile)
+    std::string            directory;
+    uint64_t               driver_hash;  // Hash das strings do driver, usado como semente do hash de cada programa
+    PFN_glGetProgramBinary GetProgramBinary;
+    PFN_glProgramBinary    ProgramBinary;
+    PFN_glProgramParameteri ProgramParameteri;
+    std::vector<PendingProgram> pending;
+    ShaderCacheStats       stats;
+} g_ShaderCache;
+
+static bool HasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static uint64_t HashString(const char* string, uint64_t hash)
+{
+    if (string == NULL)
+        string = "";
+    // O '\0' também entra no hash: "ab" + "c" e "a" + "bc" são diferentes.
+    return Replay_Hash(string, strlen(string) + 1, hash);
+}
+
+bool ShaderCache_Init(const char* directory, GLADloadproc load)
+{
+    memset(&g_ShaderCache.stats, 0, sizeof(g_ShaderCache.stats));
+    g_ShaderCache.enabled = false;
+
+    // O número de threads de compilação fica a critério do driver.
+    PFN_glMaxShaderCompilerThreads MaxShaderCompilerThreads = NULL;
+    if (HasExtension("GL_KHR_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreads)load("glMaxShaderCompilerThreadsKHR");
+    else if (HasExtension("GL_ARB_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreads)load("glMaxShaderCompilerThreadsARB");
+    g_ShaderCache.parallel = MaxShaderCompilerThreads != NULL;
+    if (g_ShaderCache.parallel)
+        MaxShaderCompilerThreads(0xFFFFFFFFu);
+
+    if (directory == NULL)
+        return false;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 41 && !HasExtension("GL_ARB_get_program_binary"))
+    {
+        printf("Cache de shaders desligado: o driver não tem GL_ARB_get_program_binary.\n");
+        return false;
+    }
+    g_ShaderCache.GetProgramBinary = (PFN_glGetProgramBinary)load("glGetProgramBinary");
+    g_ShaderCache.ProgramBinary = (PFN_glProgramBinary)load("glProgramBinary");
+    g_ShaderCache.ProgramParameteri = (PFN_glProgramParameteri)load("glProgramParameteri");
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (g_ShaderCache.GetProgramBinary == NULL || g_ShaderCache.ProgramBinary == NULL ||
+        g_ShaderCache.ProgramParameteri == NULL || formats <= 0)
+    {
+        printf("Cache de shaders desligado: o driver não grava programas em formato binário.\n");
+        return false;
+    }
+
+#ifdef _WIN32
+    _mkdir(directory);
+#else
+    mkdir(directory, 0755);
+#endif
+    g_ShaderCache.directory = directory;
+
+    uint64_t hash = REPLAY_HASH_SEED;
+    hash = HashString((const char*)glGetString(GL_VENDOR), hash);
+    hash = HashString((const char*)glGetString(GL_RENDERER), hash);
+    hash = HashString((const char*)glGetString(GL_VERSION), hash);
+    hash = HashString((const char*)glGetString(GL_SHADING_LANGUAGE_VERSION), hash);
+    g_ShaderCache.driver_hash = hash;
+    g_ShaderCache.enabled = true;
+    return true;
+}
+
+static std::string CacheFilename(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return g_ShaderCache.directory + name;
+}
+
+// Lê o binário do programa do cache e o entrega ao driver. Retorna false se não houver arquivo; se o driver
+// recusar o binário, só saberemos ao consultar o estado da ligação.
+static bool LoadProgram(GLuint program_id, uint64_t key)
+{
+    FILE* file = fopen(CacheFilename(key).c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    CacheHeader header;
+    std::vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == SHADERCACHE_MAGIC && header.key == key;
+    if (ok)
+    {
+        binary.resize(header.length);
+        ok = header.length > 0 && fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (ok)
+        g_ShaderCache.ProgramBinary(program_id, header.format, binary.data(), (GLsizei)binary.size());
+    return ok;
+}
+
+// Grava o binário de um programa recém-ligado. O arquivo é escrito com outro nome e renomeado no fim, de forma
+// que outra execução do jogo nunca lê um arquivo pela metade.
+static void StoreProgram(GLuint program_id, uint64_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    g_ShaderCache.GetProgramBinary(program_id, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    CacheHeader header = { SHADERCACHE_MAGIC, (uint32_t)format, (uint32_t)written, 0, key };
+    std::string filename = CacheFilename(key);
+    std::string temporary = filename + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open shader cache file \"%s\" for writing.\n", temporary.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = (fclose(file) == 0) && ok;
+    remove(filename.c_str());
+    if (!ok || rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        fprintf(stderr, "ERROR: Cannot write shader cache file \"%s\".\n", filename.c_str());
+        remove(temporary.c_str());
+    }
+}
+
+// Entrega o código de um shader ao driver, sem esperar pela compilação.
+static GLuint CompileShader(GLenum type, const char* source)
+{
+    GLuint shader_id = glCreateShader(type);
+    glShaderSource(shader_id, 1, &source, NULL);
+    glCompileShader(shader_id);
+    return shader_id;
+}
+
+// Liga os shaders ao programa, sem esperar pela ligação.
+static void LinkProgram(GLuint program_id, GLuint vertex_shader_id, GLuint fragment_shader_id)
+{
+    glAttachShader(program_id, vertex_shader_id);
+    glAttachShader(program_id, fragment_shader_id);
+
+    // Pedimos ao driver que guarde o binário do programa, que lemos depois com glGetProgramBinary().
+    if (g_ShaderCache.enabled)
+        g_ShaderCache.ProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program_id);
+}
+
+// Imprime no terminal qualquer erro ou "warning" de compilação de um shader.
+static void CheckShader(GLuint shader_id, GLenum type, const char* name)
+{
+    GLint compiled_ok;
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+    GLint log_length = 0;
+    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length > 1)
+    {
+        std::vector<GLchar> log(log_length);
+        glGetShaderInfoLog(shader_id, log_length, NULL, log.data());
+        fprintf(stderr, "%s: OpenGL compilation of the %s shader of \"%s\"%s.\n== Start of compilation log\n%s== End of compilation log\n",
+                compiled_ok ? "WARNING" : "ERROR", type == GL_VERTEX_SHADER ? "vertex" : "fragment", name,
+                compiled_ok ? "" : " failed", log.data());
+    }
+}
+
+GLuint ShaderCache_SubmitProgram(const char* name, const char* vertex_source, const char* fragment_source,
+                                 ShaderProgramReady ready, void* data)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    PendingProgram pending;
+    pending.program = glCreateProgram();
+    GL_LABEL(GL_PROGRAM, pending.program, name);
+    pending.vertex_shader = pending.fragment_shader = 0;
+    pending.key = 0;
+    pending.name = name;
+    pending.vertex_source = vertex_source;
+    pending.fragment_source = fragment_source;
+    pending.ready = ready;
+    pending.data = data;
+
+    bool cached = false;
+    if (g_ShaderCache.enabled)
+    {
+        pending.key = HashString(fragment_source, HashString(vertex_source, g_ShaderCache.driver_hash));
+        cached = LoadProgram(pending.program, pending.key);
+    }
+    if (!cached)
+    {
+        pending.vertex_shader = CompileShader(GL_VERTEX_SHADER, vertex_source);
+        pending.fragment_shader = CompileShader(GL_FRAGMENT_SHADER, fragment_source);
+        LinkProgram(pending.program, pending.vertex_shader, pending.fragment_shader);
+    }
+    g_ShaderCache.pending.push_back(pending);
+
+    g_ShaderCache.stats.total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return pending.program;
+}
+
+// Consulta o resultado de um programa pendente. É aqui que esperamos o driver terminar a compilação e a ligação.
+static void FinishProgram(PendingProgram& pending)
+{
+    ShaderCacheStats& stats = g_ShaderCache.stats;
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &linked_ok);
+
+    if (pending.vertex_shader == 0)
+    {
+        if (linked_ok)
+        {
+            stats.hits += 1;
+            if (pending.ready != NULL)
+                pending.ready(pending.program, pending.data);
+            return;
+        }
+
+        // O driver recusou o binário: compilamos o mesmo programa a partir do código, agora esperando o resultado.
+        stats.rejected += 1;
+        pending.vertex_shader = CompileShader(GL_VERTEX_SHADER, pending.vertex_source.c_str());
+        pending.fragment_shader = CompileShader(GL_FRAGMENT_SHADER, pending.fragment_source.c_str());
+        LinkProgram(pending.program, pending.vertex_shader, pending.fragment_shader);
+        glGetProgramiv(pending.program, GL_LINK_STATUS, &linked_ok);
+    }
+
+    stats.misses += 1;
+    CheckShader(pending.vertex_shader, GL_VERTEX_SHADER, pending.name.c_str());
+    CheckShader(pending.fragment_shader, GL_FRAGMENT_SHADER, pending.name.c_str());
+    if (linked_ok == GL_FALSE)
+    {
+        GLint log_length = 0;
+        glGetProgramiv(pending.program, GL_INFO_LOG_LENGTH, &log_length);
+        std::vector<GLchar> log(log_length + 1, '\0');
+        glGetProgramInfoLog(pending.program, log_length, NULL, log.data());
+        fprintf(stderr, "ERROR: OpenGL linking of program \"%s\" failed.\n== Start of link log\n%s\n== End of link log\n",
+                pending.name.c_str(), log.data());
+    }
+    else if (g_ShaderCache.enabled)
+    {
+        StoreProgram(pending.program, pending.key);
+    }
+
+    // Os "Shader Objects" podem ser marcados para deleção após serem linkados
+    glDetachShader(pending.program, pending.vertex_shader);
+    glDetachShader(pending.program, pending.fragment_shader);
+    glDeleteShader(pending.vertex_shader);
+    glDeleteShader(pending.fragment_shader);
+
+    if (pending.ready != NULL)
+        pending.ready(pending.program, pending.data);
+}
+
+void ShaderCache_FinishAll()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<PendingProgram>& pending = g_ShaderCache.pending;
+
+    // Com a compilação em paralelo, terminamos primeiro os programas que o driver já ligou, sem esperar por ele.
+    if (g_ShaderCache.parallel)
+    {
+        for (size_t i = 0; i < pending.size(); )
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pending[i].program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (completed)
+            {
+                FinishProgram(pending[i]);
+                pending.erase(pending.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+    for (size_t i = 0; i < pending.size(); ++i)
+        FinishProgram(pending[i]);
+    pending.clear();
+
+    g_ShaderCache.stats.total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const ShaderCacheStats& ShaderCache_Stats()
+{
+    return g_ShaderCache.stats;
+}
+
+void ShaderCache_Report()
+{
+    const ShaderCacheStats& stats = g_ShaderCache.stats;
+    const char* parallel = g_ShaderCache.parallel ? ", compilação em paralelo pelo driver" : "";
+    if (g_ShaderCache.enabled)
+        printf("Programas de GPU: %u lidos do cache, %u compilados (%u recusados pelo driver), %.1f ms%s.\n",
+               stats.hits, stats.misses, stats.rejected, stats.total_ms, parallel);
+    else
+        printf("Programas de GPU: %u compilados, %.1f ms%s.\n", stats.misses, stats.total_ms, parallel);
+}
@@ -0,0 +1,467 @@
+#include "simulation.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>  // Somente as constantes de teclas e botões, usadas em Simulation_ApplyInputEvent()
+
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/common.hpp>
+
+#include "collisions.h"
+#include "memtrack.h"
+#include "profiler.h"
+
+// Gerador congruente linear com a mesma faixa de valores de rand() (0 a 32767), mas com o estado
+// guardado em cada partida: o sorteio dos meteoros de uma partida não interfere no das outras.
+static int Random(GameState& state)
+{
+    state.random = state.random * 1103515245u + 12345u;
+    return (int)((state.random >> 16) & 0x7FFF);
+}
+
+// Graus de rotação da câmera por pixel de arrasto do mouse.
+#define LOOK_SENSITIVITY 0.05f
+
+// Direção da câmera livre a partir dos seus ângulos, em graus.
+static glm::vec3 CameraFront(float yaw, float pitch)
+{
+    glm::vec3 front;
+    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    return glm::normalize(front);
+}
+
+// Testes de colisão dos asteroides dos setores ativos, divididos por setor. Cada setor
+// escreve apenas os seus resultados, de forma que os setores podem ser testados em paralelo.
+struct SectorCollisions
+{
+    const GameState*                    state;
+    const std::vector<StreamedSector*>* sectors;
+    BoundingSphere                      ship;
+    bool                                rocket_active;
+    BoundingCube                        rocket;
+    std::vector<std::vector<uint32_t>>  destroyed;  // Asteroides de cada setor atingidos pelo míssil neste passo
+    std::vector<uint8_t>                ship_hit;   // Se algum asteroide de cada setor atingiu a nave
+};
+
+static void CollideSectors(void* data, uint32_t begin, uint32_t end)
+{
+    PROFILE_SCOPE("Colisões");
+    SectorCollisions* collisions = (SectorCollisions*)data;
+    for (uint32_t s = begin; s < end; ++s)
+    {
+        const StreamedSector* sector = (*collisions->sectors)[s];
+        for (uint32_t i = 0; i < sector->asteroids.size(); ++i)
+        {
+            uint32_t id = sector->first_asteroid + i;
+            if (collisions->state->destroyed_asteroids.count(id))
+                continue;
+
+            const LevelAsteroid& asteroid = sector->asteroids[i];
+            BoundingSphere asteroidBoundingSphere = { glm::vec3(asteroid.x, asteroid.y, asteroid.z), asteroid.radius };
+
+            // verifica foguete vs asteroide
+            if (collisions->rocket_active && checkSphereCubeCollision(asteroidBoundingSphere, collisions->rocket))
+            {
+                collisions->destroyed[s].push_back(id); //'deleta' a esfera
+                continue;
+            }
+
+            // verifica nave vs asteroide
+            if (checkSphereSphereCollision(collisions->ship, asteroidBoundingSphere))
+                collisions->ship_hit[s] = 1;
+        }
+    }
+}
+
+void Simulation_Init(GameState& state, const Level& level, uint32_t seed, bool endless)
+{
+    state.tick = 0;
+    state.time = 0.0;
+    state.random = seed;
+    state.endless = endless;
+    Simulation_Reset(state, level);
+}
+
+void Simulation_Reset(GameState& state, const Level& level)
+{
+    state.started = false;
+    state.start_time = 0.0;
+    state.next_coin = 0;
+    state.coin_collected.assign(level.num_coins, false);
+    state.destroyed_asteroids.clear();
+    state.destroyed_members.assign(level.num_group_members, false);
+
+    state.free_camera = true;
+    state.camera_position = glm::vec3(0.0f, 0.0f, 0.0f);
+    state.camera_front = glm::vec3(0.0f, 0.0f, -1.0f);
+    state.camera_yaw = -90.0f;
+    state.camera_pitch = 0.0f;
+    state.camera_speed = 0.5f;
+    state.last_pressed_key = 0;
+
+    state.barrel_roll_angle = 0.0f;
+    state.is_rolling = false;
+    state.barrel_roll_direction = 1;
+
+    state.rocket_active = false;
+    state.rocket_start_time = 0.0;
+    state.rocket_origin = glm::vec3(0.0f, 0.0f, 0.0f);
+    state.rocket_direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    state.rocket_position = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    state.meteor_active = false;
+    state.meteor_start_time = 0.0;
+    state.meteor_duration = 0.0f;
+    state.meteor_color = 4;
+    for (int i = 0; i < 4; ++i)
+        state.meteor_control_points[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    state.meteor_position = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    state.group_offset = 0.0f;
+}
+
+int Simulation_Tick(GameState& state, GameInput& input, const Level& level, LevelStreamer* streamer, float dt, SimulationStats* stats, JobSystem* jobs)
+{
+    MEMTRACK_SCOPE(MEMTAG_SIMULATION);
+
+    state.tick += 1;
+    state.time += dt;
+
+    // Consumimos os eventos ocorridos desde o último passo.
+    bool fire = input.fire;
+    float look_yaw = input.look_yaw;
+    float look_pitch = input.look_pitch;
+    if (input.toggle_camera)
+        state.free_camera = !state.free_camera;
+    if (input.start && !state.started)
+    {
+        state.started = true;
+        state.start_time = state.time;
+    }
+    input.fire = input.start = input.toggle_camera = false;
+    input.look_yaw = input.look_pitch = 0.0f;
+
+    if (state.free_camera)
+    {
+        PROFILE_SCOPE("Câmera");
+        state.camera_yaw += look_yaw;
+        state.camera_pitch = glm::clamp(state.camera_pitch + look_pitch, -89.0f, 89.0f);
+        state.camera_front = CameraFront(state.camera_yaw, state.camera_pitch);
+
+        bool moving = input.forward || input.backward || input.roll_left || input.roll_right;
+        if (moving)
+        {
+            state.camera_speed = std::min(state.camera_speed + CAMERA_ACCELERATION * dt, MAX_CAMERA_SPEED);
+        }
+        else
+        {
+            state.camera_speed = std::max(state.camera_speed - CAMERA_ACCELERATION * dt * 2.0f, 0.0f);
+        }
+
+        if (input.forward)
+            state.last_pressed_key = 'W';
+        if (input.backward)
+            state.last_pressed_key = 'S';
+
+        // Sem nenhuma tecla pressionada, a nave segue por inércia no sentido do último movimento.
+        if (input.forward || (!moving && state.last_pressed_key == 'W'))
+            state.camera_position += state.camera_speed * state.camera_front * dt;
+        if (input.backward || (!moving && state.last_pressed_key == 'S'))
+            state.camera_position -= state.camera_speed * state.camera_front * dt;
+
+        if (!state.is_rolling && (input.roll_left || input.roll_right))
+        {
+            state.is_rolling = true;
+            state.barrel_roll_angle = 0.0f;
+            state.barrel_roll_direction = input.roll_left ? -1 : 1;
+        }
+
+        if (state.is_rolling)
+        {
+            state.barrel_roll_angle += dt * BARREL_ROLL_SPEED * state.barrel_roll_direction;
+
+            if ((state.barrel_roll_direction == 1 && TARGET_ANGLE - state.barrel_roll_angle <= 0.01f)
+                || (state.barrel_roll_direction == -1 && glm::abs(TARGET_ANGLE - state.barrel_roll_angle) >= 12.56f))
+            {
+                state.is_rolling = false;
+                state.barrel_roll_angle = 0.0f;
+            }
+        }
+    }
+
+    // Atualizamos os setores do nível ativos em torno da nave.
+    std::chrono::steady_clock::time_point streamingStart = std::chrono::steady_clock::now();
+    LevelStreamer_Update(streamer, state.camera_position.z);
+    if (stats != NULL)
+        stats->streaming_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - streamingStart).count();
+
+    if (!state.started)
+        return GAME_PLAYING;
+
+    {
+        PROFILE_SCOPE("Meteoro e míssil");
+
+        // Míssil: sai da nave no sentido da câmera e dura ROCKET_DURATION segundos.
+        if (state.rocket_active && state.time - state.rocket_start_time >= ROCKET_DURATION)
+        {
+            state.rocket_active = false;
+        }
+        else if (!state.rocket_active && fire && state.free_camera)
+        {
+            state.rocket_active = true;
+            state.rocket_start_time = state.time;
+            state.rocket_direction = state.camera_front;
+            state.rocket_origin = state.camera_position + state.camera_front * 18.0f;
+        }
+        if (state.rocket_active)
+        {
+            state.rocket_position = state.rocket_origin + state.rocket_direction * (ROCKET_SPEED * (float)(state.time - state.rocket_start_time));
+        }
+
+        // Meteoro: percorre uma curva de Bézier sorteada, e ao terminar é sorteado um novo.
+        if (state.meteor_active && state.time - state.meteor_start_time >= state.meteor_duration)
+        {
+            state.meteor_active = false;
+        }
+        else if (!state.meteor_active)
+        {
+            state.meteor_active = true;
+            state.meteor_start_time = state.time;
+            state.meteor_duration = 2 + (Random(state) % 5);  // sorteia entre 2 e 6 segundos
+            state.meteor_color = 4 + (Random(state) % 2);     // sorteia entre REDBALL(4) e BLUEBALL(5)
+            state.meteor_control_points[0] = glm::vec4(-200 + Random(state) % 500, 300, -300.0f, 1);
+            state.meteor_control_points[1] = glm::vec4(-200 + Random(state) % 500, 100.0f, -300.0f, 1);
+            state.meteor_control_points[2] = glm::vec4(-200 + Random(state) % 500, -100.0f, -300.0f, 1);
+            state.meteor_control_points[3] = glm::vec4(-200 + Random(state) % 500, -300.0f, -300.0f, 1);
+        }
+        if (state.meteor_active)
+        {
+            float t = (1/state.meteor_duration)*(float)(state.time-state.meteor_start_time); // mapeia o intervalo [início, início + duração] -> [0, 1]
+            const glm::vec4* p = state.meteor_control_points;
+            glm::vec4 point_on_curve = (float)(pow(1-t,3))*p[0] + (float)(3*t*pow(1-t,2))*p[1] + (float)(3*pow(t,2)*(1-t))*p[2] + (float)(pow(t,3))*p[3];
+            state.meteor_position = glm::vec3(point_on_curve);
+        }
+    }
+
+    state.group_offset = (float)(state.time - state.start_time) * level.group_speed;
+
+    float offsetValue = -1.5; //nave eh maior pra tras que pra frente,
+    glm::vec3 shipPosition = state.camera_position + state.camera_front * 18.0f + state.camera_front * offsetValue;
+    BoundingSphere shipBoundingSphere = { shipPosition, 4.0f };
+
+    std::chrono::steady_clock::time_point collisionsStart = std::chrono::steady_clock::now();
+
+    // Os vetores de resultados são mantidos entre os passos (um por thread: o executável headless simula
+    // várias partidas ao mesmo tempo), para não alocar memória a cada passo.
+    static thread_local SectorCollisions collisions;
+    collisions.state = &state;
+    collisions.sectors = &streamer->active;
+    collisions.ship = shipBoundingSphere;
+    collisions.rocket_active = state.rocket_active;
+    glm::vec3 cubeDimensions = glm::vec3(5.0f, 5.0f, 5.0f);
+    collisions.rocket.lowerBackLeft = state.rocket_position - cubeDimensions * 0.5f;
+    collisions.rocket.upperFrontRight = state.rocket_position + cubeDimensions * 0.5f;
+    // Reservamos espaço para todos os setores do nível: o número de setores ativos varia durante a partida.
+    if (collisions.ship_hit.capacity() < level.num_sectors)
+    {
+        collisions.destroyed.reserve(level.num_sectors);
+        collisions.ship_hit.reserve(level.num_sectors);
+    }
+    collisions.destroyed.resize(streamer->active.size());
+    for (size_t s = 0; s < collisions.destroyed.size(); ++s)
+        collisions.destroyed[s].clear();
+    collisions.ship_hit.assign(streamer->active.size(), 0);
+
+    uint32_t num_sectors = (uint32_t)streamer->active.size();
+    if (jobs != NULL && num_sectors > 1)
+    {
+        JobCounter counter;
+        Jobs_ParallelFor(jobs, num_sectors, 1, CollideSectors, &collisions, &counter);
+        Jobs_Wait(jobs, &counter);
+    }
+    else
+    {
+        CollideSectors(&collisions, 0, num_sectors);
+    }
+
+    // Os asteroides destruídos pelo míssil são aplicados na ordem dos setores, como em uma única thread.
+    bool lost = false;
+    for (uint32_t s = 0; s < num_sectors; ++s)
+    {
+        state.destroyed_asteroids.insert(collisions.destroyed[s].begin(), collisions.destroyed[s].end());
+        lost = lost || collisions.ship_hit[s];
+    }
+
+    // Os membros do grupo de asteroides são poucos, e são testados depois dos setores, nesta thread.
+    glm::vec3 groupOrigin = glm::vec3(level.group_origin[0] + state.group_offset, level.group_origin[1], level.group_origin[2]);
+    for (uint32_t i = 0; i < level.num_group_members; ++i)
+    {
+        if (state.destroyed_members[i])
+            continue;
+
+        const LevelGroupMember& member = level.group[i];
+        BoundingSphere memberBoundingSphere = { groupOrigin + glm::vec3(member.x, member.y, member.z), GROUP_MEMBER_RADIUS_PER_SCALE * member.scale };
+        if (collisions.rocket_active && checkSphereCubeCollision(memberBoundingSphere, collisions.rocket))
+        {
+            state.destroyed_members[i] = true;
+            continue;
+        }
+        if (checkSphereSphereCollision(shipBoundingSphere, memberBoundingSphere))
+            lost = true;
+    }
+    if (stats != NULL)
+        stats->collisions_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - collisionsStart).count();
+    if (lost && !state.endless)
+        return GAME_LOST;
+
+    if (state.next_coin < level.num_coins)
+    {
+        // verifica nave vs próxima moeda
+        const LevelCoin& coin = level.coins[state.next_coin];
+        BoundingCircle coinBoundingCircle = { glm::vec3(coin.x, coin.y, coin.z), coin.radius, glm::vec3(0, 0, 0) };
+        if (checkSphereCircleCollision(shipBoundingSphere, coinBoundingCircle))
+        {
+            state.coin_collected[state.next_coin] = true;
+            state.next_coin++;
+        }
+    }
+    else if (!state.endless)
+    {
+        // se coletou todas as moedas, jogo termina
+        return GAME_WON;
+    }
+    return GAME_PLAYING;
+}
+
+void Simulation_ApplyInputEvent(GameInput& input, const InputEvent& event)
+{
+    if (event.type == INPUT_EVENT_MOUSE_BUTTON)
+    {
+        int button = event.code;
+        int action = event.action;
+
+        // Ao pressionar qualquer botão guardamos a posição atual do cursor, a partir da qual o arrasto é medido.
+        if (action == GLFW_PRESS && (button == GLFW_MOUSE_BUTTON_LEFT || button == GLFW_MOUSE_BUTTON_RIGHT || button == GLFW_MOUSE_BUTTON_MIDDLE))
+        {
+            input.last_cursor_x = event.x;
+            input.last_cursor_y = event.y;
+        }
+
+        // Somente o botão esquerdo gira a câmera.
+        if (button == GLFW_MOUSE_BUTTON_LEFT)
+        {
+            input.look_dragging = (action == GLFW_PRESS);
+        }
+    }
+    else if (event.type == INPUT_EVENT_CURSOR_POS)
+    {
+        if (input.look_dragging)
+        {
+            float dx = event.x - input.last_cursor_x;
+            float dy = event.y - input.last_cursor_y;
+            dx *= LOOK_SENSITIVITY;
+            dy *= LOOK_SENSITIVITY;
+
+            // A simulação aplica o movimento acumulado no seu próximo passo.
+            input.look_yaw += dx;
+            input.look_pitch -= dy;
+
+            input.last_cursor_x = event.x;
+            input.last_cursor_y = event.y;
+        }
+    }
+    else if (event.type == INPUT_EVENT_KEY)
+    {
+        int key = event.code;
+        int action = event.action;
+
+        // Se o usuário apertar a tecla F, fazemos um "toggle" do tipo de câmera.
+        if (key == GLFW_KEY_F && action == GLFW_PRESS)
+        {
+            input.toggle_camera = true;
+        }
+
+        if (key == GLFW_KEY_W)
+        {
+            input.forward = (action != GLFW_RELEASE);
+        }
+        if (key == GLFW_KEY_S)
+        {
+            input.backward = (action != GLFW_RELEASE);
+        }
+        if (key == GLFW_KEY_A)
+        {
+            input.roll_left = (action != GLFW_RELEASE);
+        }
+        if (key == GLFW_KEY_D)
+        {
+            input.roll_right = (action != GLFW_RELEASE);
+        }
+
+        // Se o usuário apertar espaço
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+        {
+            input.fire = true;
+        }
+
+        // Se o usuário apertar enter
+        if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
+        {
+            input.start = true;
+        }
+    }
+}
+
+glm::vec3 Simulation_LatestCameraFront(const GameState& state, const GameInput& input, double cursor_x, double cursor_y)
+{
+    float look_yaw = input.look_yaw;
+    float look_pitch = input.look_pitch;
+    if (input.look_dragging)
+    {
+        // Mesmo cálculo de Simulation_ApplyInputEvent(), para um evento de movimento do cursor que ainda não chegou.
+        float dx = cursor_x - input.last_cursor_x;
+        float dy = cursor_y - input.last_cursor_y;
+        look_yaw += dx * LOOK_SENSITIVITY;
+        look_pitch -= dy * LOOK_SENSITIVITY;
+    }
+    return CameraFront(state.camera_yaw + look_yaw, glm::clamp(state.camera_pitch + look_pitch, -89.0f, 89.0f));
+}
+
+uint64_t Simulation_Checksum(const GameState& state)
+{
+    uint64_t hash = REPLAY_HASH_SEED;
+    hash = Replay_Hash(&state.tick, sizeof(state.tick), hash);
+    hash = Replay_Hash(&state.time, sizeof(state.time), hash);
+    hash = Replay_Hash(&state.random, sizeof(state.random), hash);
+    hash = Replay_Hash(&state.started, sizeof(state.started), hash);
+    hash = Replay_Hash(&state.start_time, sizeof(state.start_time), hash);
+    hash = Replay_Hash(&state.next_coin, sizeof(state.next_coin), hash);
+    hash = Replay_Hash(&state.free_camera, sizeof(state.free_camera), hash);
+    hash = Replay_Hash(&state.camera_position, sizeof(state.camera_position), hash);
+    hash = Replay_Hash(&state.camera_front, sizeof(state.camera_front), hash);
+    hash = Replay_Hash(&state.camera_speed, sizeof(state.camera_speed), hash);
+    hash = Replay_Hash(&state.barrel_roll_angle, sizeof(state.barrel_roll_angle), hash);
+    hash = Replay_Hash(&state.rocket_active, sizeof(state.rocket_active), hash);
+    hash = Replay_Hash(&state.rocket_position, sizeof(state.rocket_position), hash);
+    hash = Replay_Hash(&state.meteor_active, sizeof(state.meteor_active), hash);
+    hash = Replay_Hash(&state.meteor_position, sizeof(state.meteor_position), hash);
+    hash = Replay_Hash(&state.group_offset, sizeof(state.group_offset), hash);
+
+    for (size_t i = 0; i < state.destroyed_members.size(); ++i)
+    {
+        uint8_t destroyed = state.destroyed_members[i];
+        hash = Replay_Hash(&destroyed, sizeof(destroyed), hash);
+    }
+
+    // A ordem de iteração de um unordered_set não é definida: combinamos os asteroides destruídos de forma comutativa.
+    uint64_t destroyed = 0;
+    for (std::unordered_set<uint32_t>::const_iterator it = state.destroyed_asteroids.begin(); it != state.destroyed_asteroids.end(); ++it)
+        destroyed += Replay_Hash(&*it, sizeof(uint32_t));
+    return Replay_Hash(&destroyed, sizeof(destroyed), hash);
+}
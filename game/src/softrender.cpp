@@ -0,0 +1,955 @@
+#include "softrender.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
+
+#include "benchmark.h"
+#include "profiler.h"
+#include "shadercache.h"
+#include "gldebug.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTRENDER_SSE2
+#endif
+
+// Identificadores de objeto, como em shader_fragment.glsl.
+#define SPHERE 0
+#define SPACESHIP 1
+#define ASTEROID 2
+#define COIN 3
+#define REDBALL 4
+#define BLUEBALL 5
+#define ROCKET 6
+
+#define M_PI   3.14159265358979323846
+
+// Os triângulos são recortados contra os planos near e far e, para limitar as
+// coordenadas usadas pelas funções de aresta, contra uma "guard band" de
+// GUARD_BAND vezes o tamanho da tela. Fora dela a rasterização apenas limita a
+// caixa envolvente à tela, sem recortar.
+#define GUARD_BAND 4.0f
+
+// Unidade de textura usada para apresentar o quadro (o texto usa a 31).
+#define PRESENT_TEXTURE_UNIT 30
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Quatro floats processados juntos: registradores SSE2 ou, sem eles, um laço comum.
+
+#ifdef SOFTRENDER_SSE2
+struct Float4
+{
+    __m128 v;
+    Float4() {}
+    Float4(__m128 x) : v(x) {}
+    Float4(float x) : v(_mm_set1_ps(x)) {}
+};
+static inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+static inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+static inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+static inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+static inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+static inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }  // Max(NaN, b) == b
+static inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+static inline int Greater(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+static inline int GreaterEqual(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+static inline int Less(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+static inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+static inline void Store(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+static inline Float4 Ramp() { return _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); }
+#else
+struct Float4
+{
+    float v[4];
+    Float4() {}
+    Float4(float x) { v[0] = v[1] = v[2] = v[3] = x; }
+};
+#define FLOAT4_FUNCTION(name, expression) \
+    static inline Float4 name(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (expression); return r; }
+#define FLOAT4_COMPARISON(name, op) \
+    static inline int name(Float4 a, Float4 b) { int r = 0; for (int i = 0; i < 4; ++i) r |= (a.v[i] op b.v[i]) << i; return r; }
+FLOAT4_FUNCTION(operator+, a.v[i] + b.v[i])
+FLOAT4_FUNCTION(operator-, a.v[i] - b.v[i])
+FLOAT4_FUNCTION(operator*, a.v[i] * b.v[i])
+FLOAT4_FUNCTION(operator/, a.v[i] / b.v[i])
+FLOAT4_FUNCTION(Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+FLOAT4_FUNCTION(Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+FLOAT4_COMPARISON(Greater, >)
+FLOAT4_COMPARISON(GreaterEqual, >=)
+FLOAT4_COMPARISON(Less, <)
+static inline Float4 Sqrt(Float4 a) { for (int i = 0; i < 4; ++i) a.v[i] = sqrtf(a.v[i]); return a; }
+static inline Float4 Load(const float* p) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+static inline void Store(float* p, Float4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+static inline Float4 Ramp() { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = i + 0.5f; return r; }
+#endif
+
+struct Vec3x4
+{
+    Float4 x, y, z;
+};
+
+static inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b)
+{
+    Vec3x4 r = { a.x - b.x, a.y - b.y, a.z - b.z };
+    return r;
+}
+
+static inline Float4 Dot(const Vec3x4& a, const Vec3x4& b)
+{
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static inline Vec3x4 Normalize(const Vec3x4& a)
+{
+    Float4 inverse = Float4(1.0f) / Sqrt(Dot(a, a));
+    Vec3x4 r = { a.x*inverse, a.y*inverse, a.z*inverse };
+    return r;
+}
+
+// pow(x, 10), pow(x, 20) e pow(x, 30), os expoentes especulares dos shaders, por multiplicações.
+static inline Float4 Pow10(Float4 x)
+{
+    Float4 x2 = x*x;
+    Float4 x4 = x2*x2;
+    return x4*x4*x2;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversões de cor.
+
+static float   g_SrgbToLinear[256];      // Leitura de uma textura GL_SRGB8
+static uint8_t g_LinearToSrgb[65536];    // Geração dos mipmaps
+static uint8_t g_LinearToGamma[65536];   // pow(c, 1/2.2), a correção gamma feita no fim de shader_fragment.glsl
+
+static void InitColorTables()
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        float c = i / 255.0f;
+        g_SrgbToLinear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < 65536; ++i)
+    {
+        float c = i / 65535.0f;
+        float srgb = (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        g_LinearToSrgb[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+        g_LinearToGamma[i] = (uint8_t)(powf(c, 1.0f / 2.2f) * 255.0f + 0.5f);
+    }
+}
+
+static inline int ColorIndex(float c)
+{
+    return (int)(std::min(std::max(c, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Texturas.
+
+// Amostragem bilinear de um nível, com GL_CLAMP_TO_EDGE. Retorna a cor linear.
+static void SampleBilinear(const SoftTexture& texture, int level, float u, float v, float* rgb)
+{
+    int width = texture.widths[level];
+    int height = texture.heights[level];
+    const uint32_t* texels = &texture.levels[level][0];
+
+    // Fora de [0, 1] a amostra é a da borda; o teste também descarta NaN.
+    if (!(u >= 0.0f)) u = 0.0f;
+    if (!(u <= 1.0f)) u = 1.0f;
+    if (!(v >= 0.0f)) v = 0.0f;
+    if (!(v <= 1.0f)) v = 1.0f;
+
+    float x = u * width - 0.5f;
+    float y = v * height - 0.5f;
+    float fx = floorf(x), fy = floorf(y);
+    float ax = x - fx, ay = y - fy;
+    int x0 = std::max((int)fx, 0), x1 = std::min((int)fx + 1, width - 1);
+    int y0 = std::max((int)fy, 0), y1 = std::min((int)fy + 1, height - 1);
+
+    uint32_t t00 = texels[y0 * width + x0], t10 = texels[y0 * width + x1];
+    uint32_t t01 = texels[y1 * width + x0], t11 = texels[y1 * width + x1];
+    for (int c = 0; c < 3; ++c)
+    {
+        int shift = 8 * c;
+        float c00 = g_SrgbToLinear[(t00 >> shift) & 0xFF], c10 = g_SrgbToLinear[(t10 >> shift) & 0xFF];
+        float c01 = g_SrgbToLinear[(t01 >> shift) & 0xFF], c11 = g_SrgbToLinear[(t11 >> shift) & 0xFF];
+        float bottom = c00 + (c10 - c00) * ax;
+        float top = c01 + (c11 - c01) * ax;
+        rgb[c] = bottom + (top - bottom) * ay;
+    }
+}
+
+// Nível de mipmap para um triângulo: o mais próximo do tamanho de um pixel em texels.
+static int MipLevel(const SoftTexture& texture, float lod)
+{
+    float level = lod + texture.log2_size;
+    if (!(level > 0.0f))
+        return 0;
+    return std::min((int)(level + 0.5f), (int)texture.levels.size() - 1);
+}
+
+// Lê a textura "unit" (TextureImage<unit>) nos quatro pixels. Uma textura não carregada é preta, como na OpenGL.
+static Vec3x4 SampleTexture(const SoftRenderer* renderer, uint32_t unit, float lod, Float4 u, Float4 v)
+{
+    float us[4], vs[4], r[4] = { 0.0f }, g[4] = { 0.0f }, b[4] = { 0.0f };
+    if (unit < renderer->textures.size())
+    {
+        const SoftTexture& texture = renderer->textures[unit];
+        int level = MipLevel(texture, lod);
+        Store(us, u);
+        Store(vs, v);
+        for (int i = 0; i < 4; ++i)
+        {
+            float rgb[3];
+            SampleBilinear(texture, level, us[i], vs[i], rgb);
+            r[i] = rgb[0];
+            g[i] = rgb[1];
+            b[i] = rgb[2];
+        }
+    }
+    Vec3x4 color = { Load(r), Load(g), Load(b) };
+    return color;
+}
+
+// Coordenadas de textura da esfera (objeto SPHERE de shader_fragment.glsl) a partir da posição no sistema do modelo.
+static void SphereTexcoords(const glm::vec4& bbox_center, float px, float py, float pz, float* u, float* v)
+{
+    float dx = px - bbox_center.x, dy = py - bbox_center.y, dz = pz - bbox_center.z;
+    float raio = sqrtf(dx*dx + dy*dy + dz*dz);
+    float theta = atan2f(px, pz);
+    float phi = asinf(std::min(std::max(py / raio, -1.0f), 1.0f));
+    *u = (float)((theta + M_PI) / (2 * M_PI));
+    *v = (float)((phi + M_PI / 2) / M_PI);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Vértices e triângulos.
+
+struct SoftVertex
+{
+    glm::vec4 clip;
+    float     attributes[SOFTRENDER_ATTRIBUTES];
+};
+
+// Equivalente a shader_vertex.glsl.
+static void ShadeVertex(const SoftRenderer* renderer, const SoftDraw& draw, const glm::mat4& mvp, const glm::mat4& normal_matrix, uint32_t vertex, SoftVertex* out)
+{
+    const SoftMesh& mesh = renderer->meshes[draw.mesh];
+    glm::vec4 position(mesh.positions[3*vertex + 0], mesh.positions[3*vertex + 1], mesh.positions[3*vertex + 2], 1.0f);
+    glm::vec4 normal(0.0f, 0.0f, 0.0f, 0.0f);
+    if (!mesh.normals.empty())
+        normal = glm::vec4(mesh.normals[3*vertex + 0], mesh.normals[3*vertex + 1], mesh.normals[3*vertex + 2], 0.0f);
+    float u = 0.0f, v = 0.0f;
+    if (!mesh.texcoords.empty())
+    {
+        u = mesh.texcoords[2*vertex + 0];
+        v = mesh.texcoords[2*vertex + 1];
+    }
+
+    out->clip = mvp * position;
+    glm::vec4 world = draw.model * position;
+    normal = normal_matrix * normal;
+    normal.w = 0.0f;
+
+    float* a = out->attributes;
+    a[SOFTRENDER_POSITION_WORLD + 0] = world.x;
+    a[SOFTRENDER_POSITION_WORLD + 1] = world.y;
+    a[SOFTRENDER_POSITION_WORLD + 2] = world.z;
+    a[SOFTRENDER_NORMAL + 0] = normal.x;
+    a[SOFTRENDER_NORMAL + 1] = normal.y;
+    a[SOFTRENDER_NORMAL + 2] = normal.z;
+    a[SOFTRENDER_TEXCOORDS + 0] = u;
+    a[SOFTRENDER_TEXCOORDS + 1] = v;
+    a[SOFTRENDER_POSITION_MODEL + 0] = position.x;
+    a[SOFTRENDER_POSITION_MODEL + 1] = position.y;
+    a[SOFTRENDER_POSITION_MODEL + 2] = position.z;
+    a[SOFTRENDER_COLOR_GOURAUD + 0] = 0.0f;
+    a[SOFTRENDER_COLOR_GOURAUD + 1] = 0.0f;
+    a[SOFTRENDER_COLOR_GOURAUD + 2] = 0.0f;
+
+    // O foguete é iluminado por vértice (Gouraud), com uma luz direcional fixa e a textura TextureImage5 no nível 0.
+    if (draw.object_id == ROCKET)
+    {
+        glm::vec3 n = glm::normalize(glm::vec3(normal));
+        glm::vec3 l = glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f));
+        glm::vec3 view = glm::normalize(glm::vec3(draw.camera_position - world));
+        glm::vec3 r = -l + 2.0f*n*glm::dot(n, l);
+
+        float kd1[3] = { 0.0f, 0.0f, 0.0f };
+        if (renderer->textures.size() > 5)
+            SampleBilinear(renderer->textures[5], 0, u, v, kd1);
+
+        float lambert = 0.5f * std::max(0.0f, glm::dot(n, l));
+        float ambient = 0.2f;
+        float specular = powf(std::max(0.0f, glm::dot(r, view)), 10.0f);
+        for (int c = 0; c < 3; ++c)
+            a[SOFTRENDER_COLOR_GOURAUD + c] = kd1[c] * (lambert + ambient + specular);
+    }
+}
+
+// Distância com sinal até um dos planos de recorte (positiva do lado de dentro).
+static float ClipDistance(const glm::vec4& c, int plane)
+{
+    switch (plane)
+    {
+        case 0:  return c.z + c.w;                // near
+        case 1:  return c.w - c.z;                // far
+        case 2:  return GUARD_BAND * c.w + c.x;
+        case 3:  return GUARD_BAND * c.w - c.x;
+        case 4:  return GUARD_BAND * c.w + c.y;
+        default: return GUARD_BAND * c.w - c.y;
+    }
+}
+
+static void LerpVertex(const SoftVertex& a, const SoftVertex& b, float t, SoftVertex* out)
+{
+    out->clip = a.clip + (b.clip - a.clip) * t;
+    for (int i = 0; i < SOFTRENDER_ATTRIBUTES; ++i)
+        out->attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+}
+
+// Recorta o polígono contra os planos indicados por "planes" (Sutherland-Hodgman). Retorna o número de vértices.
+static int ClipPolygon(SoftVertex* polygon, int count, int planes)
+{
+    SoftVertex buffer[9];
+    for (int plane = 0; plane < 6 && count > 0; ++plane)
+    {
+        if (!(planes & (1 << plane)))
+            continue;
+
+        int n = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const SoftVertex& a = polygon[i];
+            const SoftVertex& b = polygon[(i + 1) % count];
+            float da = ClipDistance(a.clip, plane);
+            float db = ClipDistance(b.clip, plane);
+            if (da >= 0.0f)
+                buffer[n++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+                LerpVertex(a, b, da / (da - db), &buffer[n++]);
+        }
+        count = n;
+        std::copy(buffer, buffer + n, polygon);
+    }
+    return count;
+}
+
+// Prepara um triângulo já recortado e o acrescenta às listas dos ladrilhos que ele cobre.
+static void SetupTriangle(SoftRenderer* renderer, uint32_t batch, uint32_t draw_index, const SoftDraw& draw, const SoftVertex* v0, const SoftVertex* v1, const SoftVertex* v2)
+{
+    const SoftVertex* v[3] = { v0, v1, v2 };
+    float x[3], y[3], z[3], inv_w[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!(v[i]->clip.w > 0.0f))
+            return;
+        inv_w[i] = 1.0f / v[i]->clip.w;
+        x[i] = (v[i]->clip.x * inv_w[i] * 0.5f + 0.5f) * renderer->width;
+        y[i] = (v[i]->clip.y * inv_w[i] * 0.5f + 0.5f) * renderer->height;
+        z[i] = v[i]->clip.z * inv_w[i] * 0.5f + 0.5f;
+    }
+
+    // Área com sinal (o dobro): positiva para triângulos anti-horários, isto é, de frente.
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0f || !(area == area) || (draw.cull && area < 0.0f))
+        return;
+    if (area < 0.0f)
+    {
+        std::swap(v[1], v[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        std::swap(inv_w[1], inv_w[2]);
+        area = -area;
+    }
+
+    // Pixels cujos centros estão dentro da caixa envolvente, limitados à tela.
+    float min_x = std::min(std::min(x[0], x[1]), x[2]), max_x = std::max(std::max(x[0], x[1]), x[2]);
+    float min_y = std::min(std::min(y[0], y[1]), y[2]), max_y = std::max(std::max(y[0], y[1]), y[2]);
+    int px0 = std::max((int)ceilf(min_x - 0.5f), 0), px1 = std::min((int)floorf(max_x - 0.5f), renderer->width - 1);
+    int py0 = std::max((int)ceilf(min_y - 0.5f), 0), py1 = std::min((int)floorf(max_y - 0.5f), renderer->height - 1);
+    if (px0 > px1 || py0 > py1)
+        return;
+
+    ArenaVector<SoftTriangle>& triangles = renderer->triangles[batch];
+    triangles.push_back(SoftTriangle());
+    SoftTriangle& t = triangles.back();
+    t.origin_x = x[0];
+    t.origin_y = y[0];
+    t.min_x = px0;
+    t.min_y = py0;
+    t.max_x = px1;
+    t.max_y = py1;
+    t.draw = draw_index;
+    t.top_left = 0;
+
+    // Aresta oposta ao vértice i, de v[i+1] a v[i+2]: E(x, y) = (x2-x1)*(y-y1) - (y2-y1)*(x-x1), positiva dentro.
+    float barycentric[3][2];
+    for (int i = 0; i < 3; ++i)
+    {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        float dx = x[i2] - x[i1], dy = y[i2] - y[i1];
+        t.edges[i][0] = -dy;
+        t.edges[i][1] = dx;
+        t.edges[i][2] = dx * (y[0] - y[i1]) - dy * (x[0] - x[i1]);
+        if (dy < 0.0f || (dy == 0.0f && dx < 0.0f))
+            t.top_left |= 1u << i;
+        barycentric[i][0] = -dy / area;
+        barycentric[i][1] = dx / area;
+    }
+
+    // Plano que vale values[i] no vértice i, relativo ao vértice 0.
+    #define PLANE(plane, v0, v1, v2) \
+        do { \
+            plane[0] = (v0) * barycentric[0][0] + (v1) * barycentric[1][0] + (v2) * barycentric[2][0]; \
+            plane[1] = (v0) * barycentric[0][1] + (v1) * barycentric[1][1] + (v2) * barycentric[2][1]; \
+            plane[2] = (v0); \
+        } while (0)
+    PLANE(t.depth, z[0], z[1], z[2]);
+    PLANE(t.inv_w, inv_w[0], inv_w[1], inv_w[2]);
+    for (int a = 0; a < SOFTRENDER_ATTRIBUTES; ++a)
+        PLANE(t.attributes[a], v[0]->attributes[a] * inv_w[0], v[1]->attributes[a] * inv_w[1], v[2]->attributes[a] * inv_w[2]);
+    #undef PLANE
+
+    // Tamanho de um pixel em unidades de textura: raiz da razão entre as áreas do triângulo na textura e na tela.
+    float u[3], w[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const float* a = v[i]->attributes;
+        if (draw.object_id == SPHERE)
+            SphereTexcoords((draw.bbox_min + draw.bbox_max) / 2.0f, a[SOFTRENDER_POSITION_MODEL], a[SOFTRENDER_POSITION_MODEL + 1], a[SOFTRENDER_POSITION_MODEL + 2], &u[i], &w[i]);
+        else
+        {
+            u[i] = a[SOFTRENDER_TEXCOORDS];
+            w[i] = a[SOFTRENDER_TEXCOORDS + 1];
+        }
+    }
+    if (draw.object_id == SPHERE)
+    {
+        // Na costura da esfera u passa de 1 para 0; usamos a menor distância.
+        float u_max = std::max(std::max(u[0], u[1]), u[2]);
+        for (int i = 0; i < 3; ++i)
+            if (u_max - u[i] > 0.5f)
+                u[i] += 1.0f;
+    }
+    float texture_area = fabsf((u[1] - u[0]) * (w[2] - w[0]) - (u[2] - u[0]) * (w[1] - w[0]));
+    t.lod = (texture_area > 0.0f) ? 0.5f * log2f(texture_area / area) : -100.0f;
+
+    // Listas dos ladrilhos cobertos pela caixa envolvente.
+    int num_tiles = renderer->tiles_x * renderer->tiles_y;
+    uint32_t index = (uint32_t)triangles.size() - 1;
+    for (int ty = py0 / SOFTRENDER_TILE_SIZE; ty <= py1 / SOFTRENDER_TILE_SIZE; ++ty)
+        for (int tx = px0 / SOFTRENDER_TILE_SIZE; tx <= px1 / SOFTRENDER_TILE_SIZE; ++tx)
+            renderer->bins[batch * num_tiles + ty * renderer->tiles_x + tx].push_back(index);
+}
+
+// Fase de geometria: transforma, recorta e distribui os triângulos de um lote.
+static void GeometryTask(SoftRenderer* renderer, uint32_t batch)
+{
+    PROFILE_SCOPE("Geometria");
+    int num_tiles = renderer->tiles_x * renderer->tiles_y;
+
+    // Recomeçamos as listas do lote na arena vazia, com a capacidade do quadro anterior.
+    Arena* arena = &renderer->arenas[batch];
+    Arena_Reset(arena);
+    size_t previous = renderer->triangles[batch].size();
+    renderer->triangles[batch] = ArenaVector<SoftTriangle>(ArenaAllocator<SoftTriangle>(arena));
+    renderer->triangles[batch].reserve(previous);
+    for (int tile = 0; tile < num_tiles; ++tile)
+    {
+        ArenaVector<uint32_t>& bin = renderer->bins[batch * num_tiles + tile];
+        previous = bin.size();
+        bin = ArenaVector<uint32_t>(ArenaAllocator<uint32_t>(arena));
+        bin.reserve(previous);
+    }
+
+    const std::vector<uint32_t>& offsets = renderer->draw_offsets;
+    uint32_t total = offsets.back();
+    uint32_t first = (uint32_t)((uint64_t)total * batch / renderer->num_batches);
+    uint32_t last = (uint32_t)((uint64_t)total * (batch + 1) / renderer->num_batches);
+
+    size_t d = std::upper_bound(offsets.begin(), offsets.end(), first) - offsets.begin() - 1;
+    for (uint32_t triangle = first; triangle < last; ++d)
+    {
+        if (offsets[d + 1] <= triangle)
+            continue;
+
+        const SoftDraw& draw = renderer->draws[d];
+        glm::mat4 mvp = draw.projection * draw.view * draw.model;
+        glm::mat4 normal_matrix = glm::inverse(glm::transpose(draw.model));
+
+        uint32_t end = std::min(last, offsets[d + 1]);
+        for (; triangle < end; ++triangle)
+        {
+            SoftVertex polygon[9];
+            uint32_t vertex = draw.first_vertex + 3 * (triangle - offsets[d]);
+            for (int i = 0; i < 3; ++i)
+                ShadeVertex(renderer, draw, mvp, normal_matrix, vertex + i, &polygon[i]);
+
+            // Descartamos triângulos inteiramente fora de um plano e recortamos os que cruzam algum.
+            int outside_all = 0x3F, outside_any = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                int outside = 0;
+                for (int plane = 0; plane < 6; ++plane)
+                    if (ClipDistance(polygon[i].clip, plane) < 0.0f)
+                        outside |= 1 << plane;
+                outside_all &= outside;
+                outside_any |= outside;
+            }
+            if (outside_all)
+                continue;
+
+            int count = 3;
+            if (outside_any)
+                count = ClipPolygon(polygon, 3, outside_any);
+            for (int i = 1; i + 1 < count; ++i)
+                SetupTriangle(renderer, batch, (uint32_t)d, draw, &polygon[0], &polygon[i], &polygon[i + 1]);
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rasterização.
+
+// Equivalente a shader_fragment.glsl, para quatro pixels. Retorna a cor antes da correção gamma.
+static Vec3x4 ShadeFragments(const SoftRenderer* renderer, const SoftDraw& draw, float lod, const Float4* a)
+{
+    Vec3x4 p = { a[SOFTRENDER_POSITION_WORLD], a[SOFTRENDER_POSITION_WORLD + 1], a[SOFTRENDER_POSITION_WORLD + 2] };
+    Vec3x4 normal = { a[SOFTRENDER_NORMAL], a[SOFTRENDER_NORMAL + 1], a[SOFTRENDER_NORMAL + 2] };
+    Vec3x4 camera = { Float4(draw.camera_position.x), Float4(draw.camera_position.y), Float4(draw.camera_position.z) };
+    Float4 zero(0.0f);
+
+    // A luz está na posição da câmera, então os vetores l e v são iguais.
+    Vec3x4 n = Normalize(normal);
+    Vec3x4 l = Normalize(camera - p);
+    Float4 n_dot_l = Dot(n, l);
+    Float4 lambert = Max(n_dot_l, zero);
+
+    Vec3x4 color = { zero, zero, zero };
+    switch (draw.object_id)
+    {
+        case SPHERE:
+        {
+            glm::vec4 bbox_center = (draw.bbox_min + draw.bbox_max) / 2.0f;
+            float px[4], py[4], pz[4], us[4], vs[4];
+            Store(px, a[SOFTRENDER_POSITION_MODEL]);
+            Store(py, a[SOFTRENDER_POSITION_MODEL + 1]);
+            Store(pz, a[SOFTRENDER_POSITION_MODEL + 2]);
+            for (int i = 0; i < 4; ++i)
+                SphereTexcoords(bbox_center, px[i], py[i], pz[i], &us[i], &vs[i]);
+
+            Vec3x4 kd = SampleTexture(renderer, 0, lod, Load(us), Load(vs));
+            Float4 k = lambert + Float4(0.8f);
+            color.x = kd.x * k;
+            color.y = kd.y * k;
+            color.z = kd.z * k;
+            break;
+        }
+        case SPACESHIP:
+        {
+            Float4 u = a[SOFTRENDER_TEXCOORDS], v = a[SOFTRENDER_TEXCOORDS + 1];
+            Vec3x4 kd1 = SampleTexture(renderer, 1, lod, u, v);
+            Vec3x4 kd2 = SampleTexture(renderer, 2, lod, u, v);
+
+            // r = -l + 2n(n.l); com v == l, dot(r, v) = 2(n.l)^2 - 1.
+            Float4 r_dot_v = Float4(2.0f) * n_dot_l * n_dot_l - Float4(1.0f);
+            Float4 p10 = Pow10(Max(r_dot_v, zero));
+            Float4 specular = Float4(0.6f) * p10 * p10 * p10 + Float4(0.2f * 0.2f);
+            Float4 half_lambert = Float4(0.5f) * lambert;
+            color.x = (kd1.x + kd2.x) * half_lambert + specular;
+            color.y = (kd1.y + kd2.y) * half_lambert + specular;
+            color.z = (kd1.z + kd2.z) * half_lambert + specular;
+            break;
+        }
+        case COIN:
+        {
+            Vec3x4 kd = SampleTexture(renderer, 4, lod, a[SOFTRENDER_TEXCOORDS], a[SOFTRENDER_TEXCOORDS + 1]);
+            color.x = kd.x * lambert;
+            color.y = kd.y * lambert;
+            color.z = kd.z * lambert;
+            break;
+        }
+        case REDBALL:
+        case BLUEBALL:
+        {
+            Vec3x4 kd = SampleTexture(renderer, 3, lod, a[SOFTRENDER_TEXCOORDS], a[SOFTRENDER_TEXCOORDS + 1]);
+            bool red = (draw.object_id == REDBALL);
+            color.x = kd.x * lambert + Float4(red ? 0.5f : 0.0f);
+            color.y = kd.y * lambert;
+            color.z = kd.z * lambert + Float4(red ? 0.0f : 0.2f);
+            break;
+        }
+        case ROCKET:
+        {
+            color.x = a[SOFTRENDER_COLOR_GOURAUD];
+            color.y = a[SOFTRENDER_COLOR_GOURAUD + 1];
+            color.z = a[SOFTRENDER_COLOR_GOURAUD + 2];
+            break;
+        }
+        case ASTEROID:
+        {
+            // Blinn-Phong com h = normalize(l + v) == l.
+            Vec3x4 kd = SampleTexture(renderer, 3, lod, a[SOFTRENDER_TEXCOORDS], a[SOFTRENDER_TEXCOORDS + 1]);
+            Float4 p10 = Pow10(lambert);
+            Float4 specular = Float4(0.3f) * p10 * p10;
+            color.x = kd.x * lambert + specular;
+            color.y = kd.y * lambert + specular;
+            color.z = kd.z * lambert + specular;
+            break;
+        }
+    }
+    return color;
+}
+
+// Desenha a parte de um triângulo contida no retângulo [x0, x1) x [y0, y1) de um ladrilho, quatro pixels por vez.
+static void RasterTriangle(SoftRenderer* renderer, const SoftTriangle& t, int x0, int y0, int x1, int y1)
+{
+    const SoftDraw& draw = renderer->draws[t.draw];
+    int min_x = std::max(t.min_x, x0), max_x = std::min(t.max_x, x1 - 1);
+    int min_y = std::max(t.min_y, y0), max_y = std::min(t.max_y, y1 - 1);
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    Float4 zero(0.0f);
+    Float4 ramp = Ramp();
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        float dy = y + 0.5f - t.origin_y;
+        Float4 edge_row[3];
+        for (int i = 0; i < 3; ++i)
+            edge_row[i] = Float4(t.edges[i][1] * dy + t.edges[i][2]);
+        Float4 depth_row(t.depth[1] * dy + t.depth[2]);
+        Float4 inv_w_row(t.inv_w[1] * dy + t.inv_w[2]);
+
+        for (int x = min_x & ~3; x <= max_x; x += 4)
+        {
+            // Pixels do bloco dentro da caixa envolvente.
+            int lanes = 0xF;
+            if (x < min_x)
+                lanes &= 0xF << (min_x - x);
+            if (x + 3 > max_x)
+                lanes &= 0xF >> (x + 3 - max_x);
+
+            Float4 dx = Float4(x - t.origin_x) + ramp;
+            for (int i = 0; i < 3 && lanes; ++i)
+            {
+                Float4 edge = edge_row[i] + Float4(t.edges[i][0]) * dx;
+                lanes &= (t.top_left & (1u << i)) ? GreaterEqual(edge, zero) : Greater(edge, zero);
+            }
+            if (!lanes)
+                continue;
+
+            float* depth = &renderer->depth[y * renderer->stride + x];
+            Float4 z = depth_row + Float4(t.depth[0]) * dx;
+            if (draw.depth_test)
+            {
+                lanes &= Less(z, Load(depth));
+                if (!lanes)
+                    continue;
+            }
+
+            // Atributos com correção de perspectiva: (atributo/w) / (1/w).
+            Float4 w = Float4(1.0f) / (inv_w_row + Float4(t.inv_w[0]) * dx);
+            Float4 attributes[SOFTRENDER_ATTRIBUTES];
+            for (int a = 0; a < SOFTRENDER_ATTRIBUTES; ++a)
+                attributes[a] = (Float4(t.attributes[a][1] * dy + t.attributes[a][2]) + Float4(t.attributes[a][0]) * dx) * w;
+
+            Vec3x4 color = ShadeFragments(renderer, draw, t.lod, attributes);
+
+            float r[4], g[4], b[4], zs[4];
+            Store(r, color.x);
+            Store(g, color.y);
+            Store(b, color.z);
+            Store(zs, z);
+            uint32_t* pixels = &renderer->color[y * renderer->stride + x];
+            for (int i = 0; i < 4; ++i)
+            {
+                if (!(lanes & (1 << i)))
+                    continue;
+                pixels[i] = (uint32_t)g_LinearToGamma[ColorIndex(r[i])]
+                          | (uint32_t)g_LinearToGamma[ColorIndex(g[i])] << 8
+                          | (uint32_t)g_LinearToGamma[ColorIndex(b[i])] << 16
+                          | 0xFF000000u;
+                if (draw.depth_test)
+                    depth[i] = zs[i];
+            }
+        }
+    }
+}
+
+// Fase de rasterização: limpa um ladrilho e desenha seus triângulos, na ordem dos draws.
+static void RasterTask(SoftRenderer* renderer, uint32_t tile)
+{
+    PROFILE_SCOPE("Rasterização");
+    int x0 = (tile % renderer->tiles_x) * SOFTRENDER_TILE_SIZE;
+    int y0 = (tile / renderer->tiles_x) * SOFTRENDER_TILE_SIZE;
+    int x1 = std::min(x0 + SOFTRENDER_TILE_SIZE, renderer->width);
+    int y1 = std::min(y0 + SOFTRENDER_TILE_SIZE, renderer->height);
+
+    int clear_x1 = std::min(x0 + SOFTRENDER_TILE_SIZE, renderer->stride);
+    for (int y = y0; y < y1; ++y)
+    {
+        std::fill(&renderer->color[y * renderer->stride + x0], &renderer->color[y * renderer->stride + clear_x1], renderer->clear_color);
+        std::fill(&renderer->depth[y * renderer->stride + x0], &renderer->depth[y * renderer->stride + clear_x1], 1.0f);
+    }
+
+    int num_tiles = renderer->tiles_x * renderer->tiles_y;
+    for (uint32_t batch = 0; batch < renderer->num_batches; ++batch)
+    {
+        const ArenaVector<SoftTriangle>& triangles = renderer->triangles[batch];
+        const ArenaVector<uint32_t>& bin = renderer->bins[batch * num_tiles + tile];
+        for (size_t i = 0; i < bin.size(); ++i)
+            RasterTriangle(renderer, triangles[bin[i]], x0, y0, x1, y1);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Execução das fases no sistema de tarefas.
+
+static void GeometryJob(void* data, uint32_t begin, uint32_t end)
+{
+    for (uint32_t batch = begin; batch < end; ++batch)
+        GeometryTask((SoftRenderer*)data, batch);
+}
+
+static void RasterJob(void* data, uint32_t begin, uint32_t end)
+{
+    for (uint32_t tile = begin; tile < end; ++tile)
+        RasterTask((SoftRenderer*)data, tile);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Apresentação com a OpenGL: um triângulo que cobre a tela, com o buffer de cor como textura.
+
+static const GLchar* const present_vertex_shader_source = ""
+"#version 330\n"
+"out vec2 texcoords;\n"
+"void main()\n"
+"{\n"
+    "texcoords = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "gl_Position = vec4(texcoords * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n"
+"\0";
+
+static const GLchar* const present_fragment_shader_source = ""
+"#version 330\n"
+"uniform sampler2D image;\n"
+"in vec2 texcoords;\n"
+"out vec4 color;\n"
+"void main()\n"
+"{\n"
+    "color = texture(image, texcoords);\n"
+"}\n"
+"\0";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Chamada por ShaderCache_FinishAll() quando o programa de GPU da apresentação está ligado.
+static void SetPresentUniforms(GLuint program, void* data)
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "image"), PRESENT_TEXTURE_UNIT);
+    glUseProgram(0);
+}
+
+void SoftRender_Init(SoftRenderer* renderer, JobSystem* jobs)
+{
+    InitColorTables();
+
+    renderer->width = renderer->height = renderer->stride = 0;
+    renderer->tiles_x = renderer->tiles_y = 0;
+    renderer->num_batches = 0;
+    renderer->clear_color = 0xFFFFFFFFu;
+
+    renderer->jobs = jobs;
+
+    renderer->program = ShaderCache_SubmitProgram("softrender", present_vertex_shader_source, present_fragment_shader_source,
+                                                  SetPresentUniforms, NULL);
+
+    glGenVertexArrays(1, &renderer->vertex_array);
+    glGenTextures(1, &renderer->texture);
+    glGenSamplers(1, &renderer->sampler);
+    glSamplerParameteri(renderer->sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(renderer->sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(renderer->sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(renderer->sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);  // Quadros em resolução menor são ampliados
+    glBindSampler(PRESENT_TEXTURE_UNIT, renderer->sampler);
+    renderer->texture_width = renderer->texture_height = 0;
+
+    printf("Rasterizador por software: %d threads, ladrilhos de %dx%d pixels.\n", jobs->num_threads, SOFTRENDER_TILE_SIZE, SOFTRENDER_TILE_SIZE);
+}
+
+uint32_t SoftRender_AddMesh(SoftRenderer* renderer, const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<float>& texcoords)
+{
+    size_t num_vertices = positions.size() / 4;
+    SoftMesh mesh;
+    mesh.positions.resize(3 * num_vertices);
+    if (!normals.empty())
+        mesh.normals.resize(3 * num_vertices);
+    for (size_t i = 0; i < num_vertices; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mesh.positions[3*i + c] = positions[4*i + c];
+            if (!normals.empty())
+                mesh.normals[3*i + c] = normals[4*i + c];
+        }
+    }
+    if (texcoords.size() == 2 * num_vertices)
+        mesh.texcoords = texcoords;
+
+    renderer->meshes.push_back(mesh);
+    return (uint32_t)renderer->meshes.size() - 1;
+}
+
+uint32_t SoftRender_AddTexture(SoftRenderer* renderer, const unsigned char* rgb, int width, int height)
+{
+    renderer->textures.push_back(SoftTexture());
+    SoftTexture& texture = renderer->textures.back();
+    texture.log2_size = 0.5f * log2f((float)width * height);
+
+    texture.widths.push_back(width);
+    texture.heights.push_back(height);
+    texture.levels.push_back(std::vector<uint32_t>((size_t)width * height));
+    uint32_t* texels = &texture.levels[0][0];
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+        texels[i] = rgb[3*i] | (uint32_t)rgb[3*i + 1] << 8 | (uint32_t)rgb[3*i + 2] << 16 | 0xFF000000u;
+
+    // Mipmaps: média de 2x2 texels do nível anterior, calculada em espaço linear, como glGenerateMipmap() em uma textura sRGB.
+    while (width > 1 || height > 1)
+    {
+        int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+        std::vector<uint32_t> level((size_t)w * h);
+        const std::vector<uint32_t>& previous = texture.levels.back();
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                int sx0 = std::min(2*x, width - 1), sx1 = std::min(2*x + 1, width - 1);
+                int sy0 = std::min(2*y, height - 1), sy1 = std::min(2*y + 1, height - 1);
+                uint32_t t[4] = { previous[sy0 * width + sx0], previous[sy0 * width + sx1], previous[sy1 * width + sx0], previous[sy1 * width + sx1] };
+                uint32_t texel = 0xFF000000u;
+                for (int c = 0; c < 3; ++c)
+                {
+                    float sum = 0.0f;
+                    for (int k = 0; k < 4; ++k)
+                        sum += g_SrgbToLinear[(t[k] >> (8 * c)) & 0xFF];
+                    texel |= (uint32_t)g_LinearToSrgb[ColorIndex(sum * 0.25f)] << (8 * c);
+                }
+                level[(size_t)y * w + x] = texel;
+            }
+        }
+        texture.widths.push_back(w);
+        texture.heights.push_back(h);
+        texture.levels.push_back(std::vector<uint32_t>());
+        texture.levels.back().swap(level);
+        width = w;
+        height = h;
+    }
+
+    return (uint32_t)renderer->textures.size() - 1;
+}
+
+void SoftRender_BeginFrame(SoftRenderer* renderer, int width, int height)
+{
+    if (width != renderer->width || height != renderer->height)
+    {
+        renderer->width = width;
+        renderer->height = height;
+        renderer->stride = (width + 3) & ~3;
+        renderer->tiles_x = (width + SOFTRENDER_TILE_SIZE - 1) / SOFTRENDER_TILE_SIZE;
+        renderer->tiles_y = (height + SOFTRENDER_TILE_SIZE - 1) / SOFTRENDER_TILE_SIZE;
+
+        // Os ladrilhos são limpos a cada quadro: só precisamos de memória nova quando o quadro é maior que todos os anteriores.
+        size_t pixels = (size_t)renderer->stride * height;
+        if (renderer->color.size() < pixels)
+        {
+            MEMTRACK_SCOPE(MEMTAG_LOADING);
+            renderer->color.resize(pixels);
+            renderer->depth.resize(pixels);
+        }
+    }
+    renderer->draws.clear();
+}
+
+void SoftRender_Draw(SoftRenderer* renderer, const SoftDraw& draw)
+{
+    // A posição da câmera só muda quando muda a matriz view, o que acontece poucas vezes por quadro.
+    glm::vec4 camera_position;
+    if (!renderer->draws.empty() && renderer->draws.back().view == draw.view)
+        camera_position = renderer->draws.back().camera_position;
+    else
+        camera_position = glm::inverse(draw.view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    renderer->draws.push_back(draw);
+    renderer->draws.back().camera_position = camera_position;
+}
+
+void SoftRender_EndFrame(SoftRenderer* renderer)
+{
+    renderer->draw_offsets.resize(renderer->draws.size() + 1);
+    renderer->draw_offsets[0] = 0;
+    for (size_t i = 0; i < renderer->draws.size(); ++i)
+        renderer->draw_offsets[i + 1] = renderer->draw_offsets[i] + renderer->draws[i].num_vertices / 3;
+
+    uint32_t total = renderer->draw_offsets.back();
+    renderer->num_batches = std::max(1u, (total + SOFTRENDER_TRIANGLES_PER_BATCH - 1) / SOFTRENDER_TRIANGLES_PER_BATCH);
+    int num_tiles = renderer->tiles_x * renderer->tiles_y;
+    while (renderer->arenas.size() < renderer->num_batches)
+    {
+        renderer->arenas.push_back(Arena());
+        Arena_Init(&renderer->arenas.back(), 64 * 1024);
+    }
+    if (renderer->triangles.size() < renderer->num_batches)
+        renderer->triangles.resize(renderer->num_batches);
+    if (renderer->bins.size() < (size_t)renderer->num_batches * num_tiles)
+        renderer->bins.resize((size_t)renderer->num_batches * num_tiles);
+
+    // A rasterização de cada ladrilho depende de todos os lotes da fase de geometria.
+    Jobs_ParallelFor(renderer->jobs, renderer->num_batches, 1, GeometryJob, renderer, &renderer->geometry);
+    Jobs_ParallelFor(renderer->jobs, num_tiles, 1, RasterJob, renderer, &renderer->raster, &renderer->geometry);
+    Jobs_Wait(renderer->jobs, &renderer->raster);
+}
+
+void SoftRender_Present(SoftRenderer* renderer)
+{
+    glActiveTexture(GL_TEXTURE0 + PRESENT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, renderer->texture);
+    if (renderer->texture_width != renderer->width || renderer->texture_height != renderer->height)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderer->width, renderer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        GL_LABEL(GL_TEXTURE, renderer->texture, "Rasterizador por software (quadro)");
+        renderer->texture_width = renderer->width;
+        renderer->texture_height = renderer->height;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, renderer->stride);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderer->width, renderer->height, GL_RGBA, GL_UNSIGNED_BYTE, &renderer->color[0]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(renderer->program);
+    glBindVertexArray(renderer->vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    g_RenderCounters.draw_calls += 1;
+    g_RenderCounters.triangles += 1;
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void SoftRender_Shutdown(SoftRenderer* renderer)
+{
+    glDeleteProgram(renderer->program);
+    glDeleteVertexArrays(1, &renderer->vertex_array);
+    glDeleteTextures(1, &renderer->texture);
+    glDeleteSamplers(1, &renderer->sampler);
+    for (size_t i = 0; i < renderer->arenas.size(); ++i)
+        Arena_Shutdown(&renderer->arenas[i]);
+}
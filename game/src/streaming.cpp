@@ -0,0 +1,197 @@
+#include "streaming.h"
+
+#include <cmath>
+
+#include "memtrack.h"
+#include "profiler.h"
+
+// Estados possíveis de cada setor em LevelStreamer::state.
+#define SECTOR_UNLOADED  0
+#define SECTOR_REQUESTED 1
+#define SECTOR_ACTIVE    2
+
+// Distância, no eixo Z, entre a nave e a fatia coberta pelo setor.
+static float SectorDistance(const Level* level, uint32_t sector, float ship_z)
+{
+    float z_min = level->sectors[sector].cell * level->sector_length;
+    float z_max = z_min + level->sector_length;
+
+    if (ship_z < z_min)
+        return z_min - ship_z;
+    if (ship_z > z_max)
+        return ship_z - z_max;
+    return 0.0f;
+}
+
+// Lê do arquivo mapeado os registros de um setor. É aqui que as páginas do
+// arquivo são efetivamente trazidas do disco, por isso esta função é
+// executada pela thread de carregamento.
+static StreamedSector* LoadSector(const Level* level, uint32_t sector)
+{
+    PROFILE_SCOPE("Carregar setor");
+    const LevelSector& info = level->sectors[sector];
+
+    StreamedSector* loaded = new StreamedSector;
+    loaded->sector = sector;
+    loaded->first_asteroid = info.first_asteroid;
+    loaded->asteroids.assign(level->asteroids + info.first_asteroid,
+                             level->asteroids + info.first_asteroid + info.num_asteroids);
+    return loaded;
+}
+
+static void ReleaseSector(LevelStreamer* streamer, StreamedSector* loaded)
+{
+    const LevelSector& info = streamer->level->sectors[loaded->sector];
+    Level_ReleaseAsteroids(streamer->level, info.first_asteroid, info.num_asteroids);
+
+    streamer->state[loaded->sector] = SECTOR_UNLOADED;
+    delete loaded;
+}
+
+static void WorkerLoop(LevelStreamer* streamer)
+{
+    MemTrack_SetTag(MEMTAG_LOADING);
+    PROFILE_THREAD_NAME("Carregamento");
+
+    std::unique_lock<std::mutex> lock(streamer->mutex);
+    while (true)
+    {
+        streamer->wakeup.wait(lock, [streamer] { return streamer->quit || !streamer->requests.empty(); });
+        if (streamer->quit)
+            return;
+
+        uint32_t sector = streamer->requests.front();
+        streamer->requests.pop_front();
+
+        lock.unlock();
+        StreamedSector* loaded = LoadSector(streamer->level, sector);
+        lock.lock();
+
+        streamer->ready.push_back(loaded);
+    }
+}
+
+void LevelStreamer_Init(LevelStreamer* streamer, const Level* level, float radius, int max_changes, bool threaded)
+{
+    streamer->level = level;
+    streamer->radius = radius;
+    streamer->max_changes = max_changes;
+    streamer->active.clear();
+    streamer->state.assign(level->num_sectors, SECTOR_UNLOADED);
+    streamer->threaded = threaded;
+    streamer->quit = false;
+
+    if (threaded)
+        streamer->worker = std::thread(WorkerLoop, streamer);
+}
+
+void LevelStreamer_Update(LevelStreamer* streamer, float ship_z)
+{
+    // Ativar e aposentar setores aloca e libera memória: é carregamento, permitido a qualquer momento.
+    MEMTRACK_SCOPE(MEMTAG_LOADING);
+    PROFILE_SCOPE("Setores");
+
+    const Level* level = streamer->level;
+    const float retire_distance = streamer->radius + level->sector_length; // Histerese: evita carregar/descarregar o mesmo setor repetidamente
+    int changes = 0;
+
+    // 1. Ativamos os setores que a thread de carregamento terminou de ler.
+    if (streamer->threaded)
+    {
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+        while (!streamer->ready.empty() && changes < streamer->max_changes)
+        {
+            StreamedSector* loaded = streamer->ready.front();
+            streamer->ready.pop_front();
+
+            if (SectorDistance(level, loaded->sector, ship_z) <= retire_distance)
+            {
+                streamer->state[loaded->sector] = SECTOR_ACTIVE;
+                streamer->active.push_back(loaded);
+                changes += 1;
+            }
+            else
+            {
+                ReleaseSector(streamer, loaded);
+            }
+        }
+    }
+
+    // 2. Aposentamos os setores ativos que ficaram longe da nave.
+    for (size_t i = 0; i < streamer->active.size() && changes < streamer->max_changes; )
+    {
+        StreamedSector* loaded = streamer->active[i];
+        if (SectorDistance(level, loaded->sector, ship_z) > retire_distance)
+        {
+            streamer->active[i] = streamer->active.back();
+            streamer->active.pop_back();
+            ReleaseSector(streamer, loaded);
+            changes += 1;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    // 3. Requisitamos os setores dentro do raio que ainda não foram carregados.
+    //    Os setores estão ordenados por "cell" decrescente, então buscamos o
+    //    primeiro setor que pode estar dentro do raio e percorremos a partir dele.
+    int32_t cell_max = (int32_t)floorf((ship_z + streamer->radius) / level->sector_length);
+    int32_t cell_min = (int32_t)floorf((ship_z - streamer->radius) / level->sector_length);
+
+    uint32_t lo = 0;
+    uint32_t hi = level->num_sectors;
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (level->sectors[mid].cell > cell_max)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (uint32_t sector = lo; sector < level->num_sectors && level->sectors[sector].cell >= cell_min; ++sector)
+    {
+        if (streamer->state[sector] != SECTOR_UNLOADED)
+            continue;
+
+        if (streamer->threaded)
+        {
+            streamer->state[sector] = SECTOR_REQUESTED;
+            std::lock_guard<std::mutex> lock(streamer->mutex);
+            streamer->requests.push_back(sector);
+        }
+        else if (changes < streamer->max_changes)
+        {
+            streamer->state[sector] = SECTOR_ACTIVE;
+            streamer->active.push_back(LoadSector(level, sector));
+            changes += 1;
+        }
+    }
+
+    if (streamer->threaded)
+        streamer->wakeup.notify_one();
+}
+
+void LevelStreamer_Shutdown(LevelStreamer* streamer)
+{
+    if (streamer->threaded)
+    {
+        {
+            std::lock_guard<std::mutex> lock(streamer->mutex);
+            streamer->quit = true;
+        }
+        streamer->wakeup.notify_one();
+        streamer->worker.join();
+
+        for (size_t i = 0; i < streamer->ready.size(); ++i)
+            delete streamer->ready[i];
+        streamer->ready.clear();
+        streamer->requests.clear();
+    }
+
+    for (size_t i = 0; i < streamer->active.size(); ++i)
+        delete streamer->active[i];
+    streamer->active.clear();
+}
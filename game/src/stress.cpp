@@ -0,0 +1,220 @@
+#include "stress.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+
+// Fatia do tubo, no intervalo [z_min, z_max) do eixo Z.
+struct StressSlab
+{
+    float                    z_min, z_max;
+    uint32_t                 target;     // Quantos asteroides a fatia deve receber
+    std::vector<LevelAsteroid> samples;
+
+    // Grade de busca: para cada célula, o último asteroide inserido nela; "next" encadeia os demais.
+    std::unordered_map<uint64_t, uint32_t> cells;
+    std::vector<uint32_t>                  next;
+};
+
+struct StressPath
+{
+    std::vector<LevelCoin> points;  // Origem seguida das moedas
+    float                  z_top, z_bottom;
+};
+
+#define NO_SAMPLE 0xFFFFFFFFu
+
+// Centro do tubo na coordenada z: interpolamos o primeiro segmento do caminho que contém z.
+static void PathCenter(const StressPath& path, float z, float* x, float* y)
+{
+    const std::vector<LevelCoin>& p = path.points;
+    for (size_t i = 0; i + 1 < p.size(); ++i)
+    {
+        float z0 = p[i].z, z1 = p[i + 1].z;
+        if ((z <= z0 && z >= z1) || (z >= z0 && z <= z1))
+        {
+            float t = (z1 != z0) ? (z - z0) / (z1 - z0) : 0.0f;
+            *x = p[i].x + t * (p[i + 1].x - p[i].x);
+            *y = p[i].y + t * (p[i + 1].y - p[i].y);
+            return;
+        }
+    }
+    *x = p.back().x;
+    *y = p.back().y;
+}
+
+static int32_t CellCoord(float v, float cell_size)
+{
+    return (int32_t)floorf(v / cell_size);
+}
+
+static uint64_t CellKey(int32_t ix, int32_t iy, int32_t iz)
+{
+    return ((uint64_t)((ix + (1 << 20)) & 0x1FFFFF) << 42)
+         | ((uint64_t)((iy + (1 << 20)) & 0x1FFFFF) << 21)
+         |  (uint64_t)((iz + (1 << 20)) & 0x1FFFFF);
+}
+
+// Verifica se algum asteroide da fatia está a menos de "min_distance" do ponto.
+static bool HasNeighbor(const StressSlab& slab, float x, float y, float z, float min_distance)
+{
+    if (slab.samples.empty())
+        return false;
+
+    float min_distance2 = min_distance * min_distance;
+    int32_t cx = CellCoord(x, min_distance), cy = CellCoord(y, min_distance), cz = CellCoord(z, min_distance);
+    for (int dx = -1; dx <= 1; ++dx)
+    for (int dy = -1; dy <= 1; ++dy)
+    for (int dz = -1; dz <= 1; ++dz)
+    {
+        uint64_t key = CellKey(cx + dx, cy + dy, cz + dz);
+        std::unordered_map<uint64_t, uint32_t>::const_iterator it = slab.cells.find(key);
+        if (it == slab.cells.end())
+            continue;
+
+        for (uint32_t i = it->second; i != NO_SAMPLE; i = slab.next[i])
+        {
+            const LevelAsteroid& a = slab.samples[i];
+            float ex = a.x - x, ey = a.y - y, ez = a.z - z;
+            if (ex * ex + ey * ey + ez * ez < min_distance2)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Amostragem por "dart throwing": sorteia candidatos dentro da fatia e aceita
+// os que respeitam a distância mínima até os asteroides já aceitos, nesta
+// fatia e nas vizinhas.
+static void GenerateSlab(const StressPath& path, std::vector<StressSlab>& slabs, size_t index, float min_distance, uint32_t seed)
+{
+    StressSlab& slab = slabs[index];
+    const StressSlab* below = (index > 0) ? &slabs[index - 1] : NULL;
+    const StressSlab* above = (index + 1 < slabs.size()) ? &slabs[index + 1] : NULL;
+
+    std::mt19937 rng(seed * 2654435761u + (uint32_t)index);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    const float inner2 = STRESS_TUBE_INNER_RADIUS * STRESS_TUBE_INNER_RADIUS;
+    const float outer2 = STRESS_TUBE_OUTER_RADIUS * STRESS_TUBE_OUTER_RADIUS;
+    const float max_scale = std::max(1.0f, std::min(2.0f, min_distance));  // Raio 0.5*escala nunca passa de min_distance/2
+
+    slab.samples.reserve(slab.target);
+    slab.next.reserve(slab.target);
+
+    uint64_t attempts = 50ull * slab.target + 100;
+    while (slab.samples.size() < slab.target && attempts-- > 0)
+    {
+        float z = slab.z_min + uniform(rng) * (slab.z_max - slab.z_min);
+        float rho = sqrtf(inner2 + uniform(rng) * (outer2 - inner2));   // Uniforme na área do anel
+        float theta = uniform(rng) * 6.2831853f;
+
+        float cx, cy;
+        PathCenter(path, z, &cx, &cy);
+        float x = cx + rho * cosf(theta);
+        float y = cy + rho * sinf(theta);
+
+        if (HasNeighbor(slab, x, y, z, min_distance)
+            || (below != NULL && z - below->z_max < min_distance && HasNeighbor(*below, x, y, z, min_distance))
+            || (above != NULL && above->z_min - z < min_distance && HasNeighbor(*above, x, y, z, min_distance)))
+            continue;
+
+        float scale = 1.0f + uniform(rng) * (max_scale - 1.0f);
+        LevelAsteroid asteroid = { x, y, z, 0.5f * scale, scale / 300.0f };
+
+        uint32_t id = (uint32_t)slab.samples.size();
+        uint64_t key = CellKey(CellCoord(x, min_distance), CellCoord(y, min_distance), CellCoord(z, min_distance));
+        std::unordered_map<uint64_t, uint32_t>::iterator it = slab.cells.find(key);
+        slab.next.push_back(it != slab.cells.end() ? it->second : NO_SAMPLE);
+        slab.cells[key] = id;
+        slab.samples.push_back(asteroid);
+    }
+}
+
+// Tarefas de uma fase da geração: o índice k da tarefa é a fatia first + 2k.
+struct StressPhase
+{
+    const StressPath*        path;
+    std::vector<StressSlab>* slabs;
+    size_t                   first;
+    float                    min_distance;
+    uint32_t                 seed;
+};
+
+static void GenerateSlabs(void* data, uint32_t begin, uint32_t end)
+{
+    StressPhase* phase = (StressPhase*)data;
+    for (uint32_t k = begin; k < end; ++k)
+        GenerateSlab(*phase->path, *phase->slabs, phase->first + 2 * k, phase->min_distance, phase->seed);
+}
+
+uint32_t Stress_GenerateAsteroids(const Level* level, uint32_t count, uint32_t seed, std::vector<LevelAsteroid>* asteroids, JobSystem* jobs)
+{
+    asteroids->clear();
+    if (count == 0)
+        return 0;
+
+    StressPath path;
+    LevelCoin origin = { 0.0f, 0.0f, 0.0f, 0.0f };
+    path.points.push_back(origin);
+    path.points.insert(path.points.end(), level->coins, level->coins + level->num_coins);
+    if (path.points.size() < 2)
+    {
+        LevelCoin end = { 0.0f, 0.0f, -500.0f, 0.0f };
+        path.points.push_back(end);
+    }
+
+    path.z_top = path.z_bottom = 0.0f;
+    for (size_t i = 0; i < path.points.size(); ++i)
+    {
+        path.z_top = std::max(path.z_top, path.points[i].z);
+        path.z_bottom = std::min(path.z_bottom, path.points[i].z);
+    }
+    float length = std::max(path.z_top - path.z_bottom, 1.0f);
+
+    // Distância mínima tal que "count" amostras ocupem cerca de metade da
+    // densidade máxima alcançável por dart throwing, mantendo alta a taxa de aceitação.
+    float volume = length * 3.14159265f * (STRESS_TUBE_OUTER_RADIUS * STRESS_TUBE_OUTER_RADIUS - STRESS_TUBE_INNER_RADIUS * STRESS_TUBE_INNER_RADIUS);
+    float min_distance = cbrtf(0.35f * volume / count);
+
+    // As fatias têm pelo menos "min_distance" de espessura, para que fatias de mesma paridade nunca sejam vizinhas.
+    size_t num_slabs = std::max<size_t>(1, std::min<size_t>(256, (size_t)(length / min_distance)));
+    std::vector<StressSlab> slabs(num_slabs);
+    for (size_t i = 0; i < num_slabs; ++i)
+    {
+        slabs[i].z_min = path.z_bottom + length * i / num_slabs;
+        slabs[i].z_max = path.z_bottom + length * (i + 1) / num_slabs;
+        slabs[i].target = (uint32_t)((uint64_t)count * (i + 1) / num_slabs - (uint64_t)count * i / num_slabs);
+    }
+
+    // As fatias ímpares só começam depois de todas as pares, das quais dependem.
+    StressPhase even = { &path, &slabs, 0, min_distance, seed };
+    StressPhase odd = { &path, &slabs, 1, min_distance, seed };
+    JobCounter evenDone, oddDone;
+    Jobs_ParallelFor(jobs, (uint32_t)((num_slabs + 1) / 2), 1, GenerateSlabs, &even, &evenDone);
+    Jobs_ParallelFor(jobs, (uint32_t)(num_slabs / 2), 1, GenerateSlabs, &odd, &oddDone, &evenDone);
+    Jobs_Wait(jobs, &oddDone);
+    Jobs_Wait(jobs, &evenDone);
+
+    size_t total = 0;
+    for (size_t i = 0; i < num_slabs; ++i)
+        total += slabs[i].samples.size();
+
+    asteroids->reserve(total);
+    for (size_t i = 0; i < num_slabs; ++i)
+        asteroids->insert(asteroids->end(), slabs[i].samples.begin(), slabs[i].samples.end());
+
+    return (uint32_t)total;
+}
+
+bool Stress_WriteLevel(const Level* level, uint32_t count, uint32_t seed, const char* binary_filename, uint32_t* generated, JobSystem* jobs)
+{
+    std::vector<LevelAsteroid> asteroids;
+    *generated = Stress_GenerateAsteroids(level, count, seed, &asteroids, jobs);
+
+    std::vector<LevelGroupMember> group(level->group, level->group + level->num_group_members);
+    std::vector<LevelCoin> coins(level->coins, level->coins + level->num_coins);
+    return Level_WriteBinary(binary_filename, asteroids, group, coins, level->group_origin, level->group_speed, level->sector_length);
+}
@@ -8,10 +8,10 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 
-#include "utils.h"
+#include "gldebug.h"
 #include "dejavufont.h"
-
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+#include "benchmark.h"
+#include "shadercache.h"
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -35,58 +35,21 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-    // Define o código do shader, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, NULL);
-
-    // Compila o código do shader (em tempo de execução)
-    glCompileShader(shader_id);
-
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
-}
-
 GLuint textVAO;
 GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+#define TEXT_TEXTURE_UNIT 31
+
+// Chamada por ShaderCache_FinishAll() quando o programa de GPU do texto está ligado.
+static void SetTextUniforms(GLuint program_id, void* data)
+{
+    glUseProgram(program_id);
+    glUniform1i(glGetUniformLocation(program_id, "tex"), TEXT_TEXTURE_UNIT);
+    glUseProgram(0);
+}
+
 void TextRendering_Init()
 {
     GLuint sampler;
@@ -99,30 +62,15 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glCheckError();
-
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
 
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
+    textprogram_id = ShaderCache_SubmitProgram("textrendering", textvertexshader_source, textfragmentshader_source,
+                                               SetTextUniforms, NULL);
 
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
-    glCheckError();
-
-    GLuint texttex_uniform;
-    texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
-    glCheckError();
-
-    GLuint textureunit = 31;
+    GLuint textureunit = TEXT_TEXTURE_UNIT;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texttexture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
     glBindSampler(textureunit, sampler);
-    glCheckError();
 
     glBindVertexArray(textVAO);
 
@@ -130,25 +78,37 @@ void TextRendering_Init()
     glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
-    glCheckError();
-
-    glUseProgram(textprogram_id);
-    glUniform1i(texttex_uniform, textureunit);
-    glUseProgram(0);
-    glCheckError();
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-    glCheckError();
+
+    // Nomes dos objetos nas mensagens do driver (opção --gl-debug).
+    GL_LABEL(GL_BUFFER, textVBO, "Texto (vértices)");
+    GL_LABEL(GL_VERTEX_ARRAY, textVAO, "Texto");
+    GL_LABEL(GL_TEXTURE, texttexture_id, "Texto (fonte)");
 }
 
 float textscale = 1.5f;
 
+// Tamanho da área de desenho. Sem janela (opção --offscreen) usamos o viewport, que cobre todo o framebuffer.
+static void GetDrawableSize(GLFWwindow* window, int* width, int* height)
+{
+    if (window != NULL)
+    {
+        glfwGetWindowSize(window, width, height);
+        return;
+    }
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    *width = viewport[2];
+    *height = viewport[3];
+}
+
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
 {
     scale *= textscale;
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    GetDrawableSize(window, &width, &height);
     float sx = scale / width;
     float sy = scale / height;
 
@@ -200,6 +160,9 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         glBindVertexArray(textVAO);
 
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        g_RenderCounters.draw_calls += 1;
+        g_RenderCounters.triangles += 2;
+        g_RenderCounters.state_changes += 2;  // Programa do texto e de volta
 
         glBindVertexArray(0);
         glUseProgram(0);
@@ -211,17 +174,59 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     }
 }
 
+// Posição (x0, y0, x1, y1) e coordenadas de textura (s0, t0, s1, t1) de cada caractere de "str", em grupos de 8
+// valores, para quem desenha texto junto com outras coisas em um único draw call (veja "include/hud.h"). "sx" e "sy"
+// convertem pixels da fonte para as coordenadas de "x" e "y". Retorna o número de caracteres escritos em "quads".
+int TextRendering_LayoutString(const char* str, float x, float y, float sx, float sy, float* quads, int max_quads)
+{
+    int count = 0;
+    for (const char* c = str; *c != '\0' && count < max_quads; ++c)
+    {
+        texture_glyph_t *glyph = 0;
+        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+        {
+            if (dejavufont.glyphs[j].codepoint == (uint32_t)*c)
+            {
+                glyph = &dejavufont.glyphs[j];
+                break;
+            }
+        }
+        if (!glyph) {
+            continue;
+        }
+        x += glyph->kerning[0].kerning;
+        float* quad = quads + 8 * count;
+        quad[0] = x + glyph->offset_x * sx;
+        quad[1] = y + glyph->offset_y * sy;
+        quad[2] = quad[0] + glyph->width * sx;
+        quad[3] = quad[1] - glyph->height * sy;
+        quad[4] = glyph->s0 - 0.5f/dejavufont.tex_width;
+        quad[5] = glyph->t0 - 0.5f/dejavufont.tex_height;
+        quad[6] = glyph->s1 - 0.5f/dejavufont.tex_width;
+        quad[7] = glyph->t1 - 0.5f/dejavufont.tex_height;
+        x += glyph->advance_x * sx;
+        count += 1;
+    }
+    return count;
+}
+
+// Altura de uma linha da fonte, em pixels, sem a escala do texto.
+float TextRendering_FontHeight()
+{
+    return dejavufont.height;
+}
+
 float TextRendering_LineHeight(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    GetDrawableSize(window, &width, &height);
     return dejavufont.height / height * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    GetDrawableSize(window, &width, &height);
     return dejavufont.glyphs[32].advance_x / width * textscale;
 }
 